@@ -0,0 +1,394 @@
+#include "stdafx.h"
+
+// Finds the code in ROMs without running them: a listing of the basic blocks
+// reachable from the start address, and a JSON map of the blocks, the edges
+// between them, subroutines and stores.  Given a number of frames, each ROM is
+// also run to find code the static analysis missed and code that is
+// executed after being written over.
+
+namespace po = boost::program_options;
+
+namespace {
+
+	// What running a ROM showed, by address
+	struct Run {
+		int frames = 0;
+		long long cycles = 0;
+		std::vector<uint16_t> unreached;	// Executed, but not found statically
+		std::vector<uint16_t> modified;		// Executed after being written over
+		std::string error;
+	};
+}
+
+static po::variables_map processCommandLine(int argc, char* argv[]) {
+
+	po::options_description poOptionsDescription("Allowed options");
+
+	poOptionsDescription.add_options()
+		("processor-type",				po::value<std::string>()->default_value("schip"),		"Processor type.  Can be one of chip, schip or xochip")
+		("allow-misaligned-opcodes",	po::value<bool>(),										"Allow instuctions to be loaded from odd addresses")
+		("rom",							po::value<std::vector<std::string>>(),					"ROMs to analyse")
+		("listing",						po::value<std::string>(),								"Write the listing to a file rather than standard output (one ROM only)")
+		("map",							po::value<std::string>(),								"Write the block map as JSON to a file (one ROM only)")
+		("frames",						po::value<int>()->default_value(0),						"Also run each ROM for this many frames, checking what it executes")
+		("chip8-shifts",				po::value<bool>()->default_value(false),				"use chip8 shifts (uses VY)")
+		("chip8-load-save",				po::value<bool>()->default_value(false),				"use chip8 load and save (modifies I)")
+		("chip8-indexed-jumps",			po::value<bool>()->default_value(false),				"use chip8 indexed jumps (uses V0)")
+	;
+
+	po::positional_options_description poPositionalOptions;
+	poPositionalOptions.add("rom", -1);
+
+	po::command_line_parser poCommandLineParser(argc, argv);
+
+	po::variables_map options;
+	try {
+		po::store(poCommandLineParser.options(poOptionsDescription).positional(poPositionalOptions).run(), options);
+		po::notify(options);
+	} catch (std::exception& error) {
+		std::cerr << error.what() << std::endl;
+		options.clear();
+	}
+
+	return options;
+}
+
+static Configuration buildConfiguration(const po::variables_map& options) {
+
+	auto processorTypeOption = options["processor-type"].as<std::string>();
+	Configuration configuration;
+	if (processorTypeOption == "schip") {
+		configuration = Configuration::buildSuperChipConfiguration();
+	} else if (processorTypeOption == "xochip") {
+		configuration = Configuration::buildXoChipConfiguration();
+	}
+
+	auto allowMisalignedOpCodesOption = options["allow-misaligned-opcodes"];
+	if (!allowMisalignedOpCodesOption.empty()) {
+		configuration.setAllowMisalignedOpcodes(allowMisalignedOpCodesOption.as<bool>());
+	}
+
+	configuration.setChip8Shifts(options["chip8-shifts"].as<bool>());
+	configuration.setChip8LoadAndSave(options["chip8-load-save"].as<bool>());
+	configuration.setChip8IndexedJumps(options["chip8-indexed-jumps"].as<bool>());
+
+	return configuration;
+}
+
+static const char* getProcessorName(const Configuration& configuration) {
+	switch (configuration.getType()) {
+	case chip8:
+		return "chip";
+	case superChip:
+		return "schip";
+	default:
+		return "xochip";
+	}
+}
+
+static std::unique_ptr<Chip8> loadProcessor(const Configuration& configuration, const std::string& rom) {
+	std::unique_ptr<Chip8> processor(ProcessorFactory::buildProcessor(configuration));
+	processor->initialise();
+	processor->loadGame(rom);
+	return processor;
+}
+
+static Run run(const Configuration& configuration, const std::string& rom, const ControlFlowGraph& graph, const int frames) {
+
+	Run result;
+	auto processor = loadProcessor(configuration, rom);
+
+	const auto& memory = processor->memory();
+	std::vector<uint8_t> original(memory.size());
+	memory.get(0, original.data(), original.size());
+
+	std::vector<bool> executed(memory.size());
+	std::vector<bool> modified(memory.size());
+	processor->EmulatingCycle.connect([&](const InstructionEventArgs& event) {
+		const auto address = event.getProgramCounter();
+		executed[address] = true;
+		const auto loaded = (original[address] << 8) | original[(address + 1) % original.size()];
+		if (event.getInstruction() != loaded)
+			modified[address] = true;
+	});
+
+	try {
+		while (!processor->getFinished() && (result.frames < frames)) {
+			result.cycles += processor->runFrame();
+			processor->updateTimers();
+			processor->setDrawNeeded(false);	// As if presented
+			++result.frames;
+		}
+	} catch (std::exception& error) {
+		result.error = error.what();
+	}
+
+	for (int address = 0; address < memory.size(); ++address) {
+		if (executed[address] && !graph.isInstruction(address))
+			result.unreached.push_back((uint16_t)address);
+		if (modified[address])
+			result.modified.push_back((uint16_t)address);
+	}
+
+	return result;
+}
+
+static void writeAddresses(std::ostream& output, const std::vector<uint16_t>& addresses) {
+	output << '[';
+	for (size_t index = 0; index < addresses.size(); ++index)
+		output << (index == 0 ? "" : ", ") << addresses[index];
+	output << ']';
+}
+
+static void writeListing(std::ostream& output, const std::string& rom, const Chip8& processor, const ControlFlowGraph& graph, const Run* run) {
+
+	const auto& configuration = processor.configuration();
+	const auto& blocks = graph.blocks();
+	const auto& subroutines = graph.subroutines();
+
+	output
+		<< boost::format("; %s: %s, starting at %04X\n") % rom % getProcessorName(configuration) % graph.getStartAddress()
+		<< boost::format("; %d blocks, %d instructions (%d bytes), %d subroutines, self-modifying: %s\n")
+			% blocks.size() % graph.getInstructionCount() % graph.getCodeBytes() % subroutines.size() % ControlFlowGraph::getName(graph.getSelfModification());
+	if (run != nullptr) {
+		output
+			<< boost::format("; ran %d frames (%d instructions): %d addresses executed that weren't found, %d executed after being written over%s\n")
+				% run->frames % run->cycles % run->unreached.size() % run->modified.size() % (run->error.empty() ? "" : ", stopped: " + run->error);
+	}
+
+	// Stores that land on code, by the address of the instruction
+	std::map<uint16_t, const ControlFlowGraph::Store*> codeWrites;
+	for (const auto& store : graph.stores()) {
+		if (store.writesCode)
+			codeWrites[store.address] = &store;
+	}
+
+	Disassembler disassembler;
+	char disassembly[Disassembler::BufferSize];
+	auto previousEnd = -1;
+	for (const auto& entry : blocks) {
+		const auto& block = entry.second;
+
+		output << '\n';
+		if ((previousEnd >= 0) && (block.start > previousEnd))
+			output << boost::format("; not reached: %04X-%04X\n\n") % previousEnd % (block.start - 1);
+		previousEnd = std::max(previousEnd, block.end);
+
+		output << boost::format("; block %04X-%04X") % block.start % (block.end - 1);
+		const auto subroutine = subroutines.find(block.start);
+		if (subroutine != subroutines.end()) {
+			output << ", subroutine called from";
+			for (const auto call : subroutine->second.calls)
+				output << boost::format(" %04X") % call;
+		}
+		if (!block.predecessors.empty()) {
+			output << ", entered from";
+			for (const auto predecessor : block.predecessors)
+				output << boost::format(" %04X") % predecessor;
+		}
+		if (block.start == graph.getStartAddress())
+			output << ", start";
+		output << '\n';
+
+		for (const auto address : block.instructions) {
+			const auto instruction = processor.memory().getWord(address);
+			if (Disassembler::getMnemomicFormat(instruction, processor) == nullptr) {
+				output << boost::format("%04X  %04X  ???\n") % address % instruction;
+				continue;
+			}
+			disassembler.disassemble(TraceRecord::capture(address, instruction, processor), configuration, disassembly);
+			output << boost::format("%04X  %04X  ") % address % instruction;
+			const auto write = codeWrites.find(address);
+			if (write == codeWrites.end())
+				output << disassembly;
+			else
+				output << boost::format("%-20s; writes code at %04X-%04X") % disassembly % write->second->target % (write->second->target + write->second->length - 1);
+			output << '\n';
+		}
+
+		switch (block.ending) {
+		case ControlFlowGraph::Exits:
+			output << "; exits\n";
+			break;
+		case ControlFlowGraph::Unresolved:
+			output << "; jump target unknown\n";
+			break;
+		case ControlFlowGraph::Invalid:
+			output << (block.instructions.empty() ? "; misaligned\n" : "; invalid instruction\n");
+			break;
+		case ControlFlowGraph::Truncated:
+			output << "; runs off the end of memory\n";
+			break;
+		default:
+			if (!block.successors.empty()) {
+				output << ";";
+				for (const auto& edge : block.successors)
+					output << boost::format(" -> %04X (%s)") % edge.target % ControlFlowGraph::getName(edge.kind);
+				output << '\n';
+			}
+			break;
+		}
+	}
+}
+
+static void writeMap(std::ostream& output, const std::string& rom, const Chip8& processor, const ControlFlowGraph& graph, const Run* run) {
+
+	// Paths are the only strings that might need escaping
+	std::string name;
+	for (const auto character : rom) {
+		if ((character == '"') || (character == '\\'))
+			name += '\\';
+		name += character;
+	}
+
+	output
+		<< "{\n"
+		<< "\t\"rom\": \"" << name << "\",\n"
+		<< "\t\"processor\": \"" << getProcessorName(processor.configuration()) << "\",\n"
+		<< "\t\"start\": " << graph.getStartAddress() << ",\n"
+		<< "\t\"instructions\": " << graph.getInstructionCount() << ",\n"
+		<< "\t\"codeBytes\": " << graph.getCodeBytes() << ",\n"
+		<< "\t\"selfModifying\": \"" << ControlFlowGraph::getName(graph.getSelfModification()) << "\",\n";
+
+	output << "\t\"blocks\": [";
+	auto first = true;
+	for (const auto& entry : graph.blocks()) {
+		const auto& block = entry.second;
+		output
+			<< (first ? "\n" : ",\n")
+			<< "\t\t{ \"start\": " << block.start
+			<< ", \"end\": " << block.end
+			<< ", \"ending\": \"" << ControlFlowGraph::getName(block.ending) << '"'
+			<< ", \"instructions\": ";
+		writeAddresses(output, block.instructions);
+		output << ", \"successors\": [";
+		for (size_t index = 0; index < block.successors.size(); ++index) {
+			const auto& edge = block.successors[index];
+			output << (index == 0 ? "" : ", ") << "{ \"target\": " << edge.target << ", \"kind\": \"" << ControlFlowGraph::getName(edge.kind) << "\" }";
+		}
+		output << "], \"predecessors\": ";
+		writeAddresses(output, block.predecessors);
+		output << " }";
+		first = false;
+	}
+	output << "\n\t],\n";
+
+	output << "\t\"subroutines\": [";
+	first = true;
+	for (const auto& entry : graph.subroutines()) {
+		output << (first ? "\n" : ",\n") << "\t\t{ \"entry\": " << entry.first << ", \"calls\": ";
+		writeAddresses(output, entry.second.calls);
+		output << ", \"returns\": ";
+		writeAddresses(output, entry.second.returns);
+		output << " }";
+		first = false;
+	}
+	output << "\n\t],\n";
+
+	output << "\t\"stores\": [";
+	first = true;
+	for (const auto& store : graph.stores()) {
+		output << (first ? "\n" : ",\n") << "\t\t{ \"address\": " << store.address << ", \"target\": ";
+		if (store.known)
+			output << store.target;
+		else
+			output << "null";
+		output << ", \"length\": " << store.length << ", \"writesCode\": " << (store.writesCode ? "true" : "false") << " }";
+		first = false;
+	}
+	output << "\n\t]";
+
+	if (run != nullptr) {
+		output << ",\n\t\"run\": { \"frames\": " << run->frames << ", \"cycles\": " << run->cycles << ", \"unreached\": ";
+		writeAddresses(output, run->unreached);
+		output << ", \"modified\": ";
+		writeAddresses(output, run->modified);
+		output << " }";
+	}
+
+	output << "\n}\n";
+}
+
+int main(int argc, char* argv[]) {
+
+	auto options = processCommandLine(argc, argv);
+	if (options.empty()) {
+		return 1;
+	}
+
+	if (options["rom"].empty()) {
+		std::cerr << "Nothing to analyse: give one or more ROMs" << std::endl;
+		return 1;
+	}
+	const auto roms = options["rom"].as<std::vector<std::string>>();
+
+	auto listingOption = options["listing"];
+	auto mapOption = options["map"];
+	if ((roms.size() > 1) && (!listingOption.empty() || !mapOption.empty())) {
+		std::cerr << "A listing or map can only be written for one ROM at a time" << std::endl;
+		return 1;
+	}
+
+	const auto configuration = buildConfiguration(options);
+	const auto frames = options["frames"].as<int>();
+
+	// One ROM: its listing.  Several: a line for each.
+	boost::format row("%-40s %7d %7d %6d %10d %7d %-9s %s");
+	if (roms.size() > 1)
+		std::cout << boost::format("%-40s %7s %7s %6s %10s %7s %-9s %s") % "ROM" % "Blocks" % "Instrs" % "Subs" % "Unresolved" % "Invalid" % "Self-mod" % "Run" << "\n";
+
+	auto failures = 0;
+	for (const auto& rom : roms) {
+		try {
+			const auto processor = loadProcessor(configuration, rom);
+			const ControlFlowGraph graph(*processor);
+
+			Run result;
+			if (frames > 0)
+				result = run(configuration, rom, graph, frames);
+			const auto ran = frames > 0 ? &result : nullptr;
+
+			if (roms.size() > 1) {
+				int unresolved = 0;
+				int invalid = 0;
+				for (const auto& entry : graph.blocks()) {
+					unresolved += entry.second.ending == ControlFlowGraph::Unresolved;
+					invalid += entry.second.ending == ControlFlowGraph::Invalid;
+				}
+				std::string status;
+				if (ran != nullptr) {
+					status = (boost::format("%d unreached, %d modified") % result.unreached.size() % result.modified.size()).str();
+					if (!result.error.empty())
+						status += ", stopped: " + result.error;
+				}
+				std::cout
+					<< row % rom % graph.blocks().size() % graph.getInstructionCount() % graph.subroutines().size() % unresolved % invalid
+						% ControlFlowGraph::getName(graph.getSelfModification()) % status
+					<< "\n";
+				continue;
+			}
+
+			if (listingOption.empty()) {
+				writeListing(std::cout, rom, *processor, graph, ran);
+			} else {
+				std::ofstream listing(listingOption.as<std::string>());
+				writeListing(listing, rom, *processor, graph, ran);
+				if (!listing)
+					throw std::runtime_error("Unable to write " + listingOption.as<std::string>());
+			}
+
+			if (!mapOption.empty()) {
+				std::ofstream map(mapOption.as<std::string>());
+				writeMap(map, rom, *processor, graph, ran);
+				if (!map)
+					throw std::runtime_error("Unable to write " + mapOption.as<std::string>());
+			}
+		} catch (std::exception& error) {
+			std::cerr << rom << ": " << error.what() << std::endl;
+			++failures;
+		}
+	}
+	std::cout.flush();
+
+	return failures == 0 ? 0 : 2;
+}
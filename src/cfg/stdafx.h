@@ -0,0 +1,22 @@
+#ifdef _MSC_VER
+#pragma once
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/format.hpp>
+#include <boost/program_options.hpp>
+
+#include <Chip8.h>
+#include <Configuration.h>
+#include <ControlFlowGraph.h>
+#include <Disassembler.h>
+#include <InstructionEventArgs.h>
+#include <ProcessorFactory.h>
+#include <Trace.h>
@@ -0,0 +1,307 @@
+#include "stdafx.h"
+
+// Runs ROMs or replays movies with no display, sound or frame pacing, several
+// at a time, reporting throughput and a hash of the final display of each.
+
+namespace po = boost::program_options;
+
+namespace {
+
+	typedef std::chrono::steady_clock timer;
+
+	// From the given frame onwards, the keypad is held as "keys" (bit n for key n)
+	struct KeyEvent {
+		int frame;
+		uint16_t keys;
+	};
+
+	struct Limits {
+		int frames;
+		long long cycles;
+	};
+
+	struct Result {
+		int frames = 0;
+		long long cycles = 0;
+		double seconds = 0.0;
+		uint64_t hash = 0;
+		bool finished = false;
+		bool replayed = false;
+		int outOfStep = -1;	// First replayed frame not matching its recording
+		std::string error;
+	};
+}
+
+static po::variables_map processCommandLine(int argc, char* argv[]) {
+
+	po::options_description poOptionsDescription("Allowed options");
+
+	poOptionsDescription.add_options()
+		("processor-type",				po::value<std::string>()->default_value("schip"),		"Processor type.  Can be one of chip, schip or xochip")
+		("allow-misaligned-opcodes",	po::value<bool>(),										"Allow instuctions to be loaded from odd addresses")
+		("translate-blocks",			po::value<bool>(),										"Translate straight-line runs of instructions into blocks")
+		("rom",							po::value<std::vector<std::string>>(),					"ROMs to run")
+		("replay",						po::value<std::vector<std::string>>(),					"Movies to replay, checking their display hashes")
+		("frames",						po::value<int>()->default_value(600),					"Frames to run each ROM for")
+		("cycles",						po::value<long long>(),									"Stop each ROM once this many instructions have run")
+		("jobs",						po::value<int>()->default_value(0),						"ROMs to run at once (0: one per hardware thread)")
+		("keys",						po::value<std::string>()->default_value(""),			"Key script: frame=mask pairs, separated by commas")
+		("graphics-count-row-hits",		po::value<bool>(),										"Graphics: count row hits")
+		("graphics-count-exceeded-rows",po::value<bool>(),										"Graphics: count exceeded rows")
+		("cycles-per-frame",			po::value<int>(),										"cycles per frame")
+		("seed",						po::value<uint32_t>(),									"Seed for RND (0: a different one each run)")
+		("graphics-clip",				po::value<bool>()->default_value(true),					"Graphics: clip")
+		("chip8-shifts",				po::value<bool>()->default_value(false),				"use chip8 shifts (uses VY)")
+		("chip8-load-save",				po::value<bool>()->default_value(false),				"use chip8 load and save (modifies I)")
+		("chip8-indexed-jumps",			po::value<bool>()->default_value(false),				"use chip8 indexed jumps (uses V0)")
+	;
+
+	po::positional_options_description poPositionalOptions;
+	poPositionalOptions.add("rom", -1);
+
+	po::command_line_parser poCommandLineParser(argc, argv);
+
+	po::variables_map options;
+	try {
+		po::store(poCommandLineParser.options(poOptionsDescription).positional(poPositionalOptions).run(), options);
+		po::notify(options);
+	} catch (std::exception& error) {
+		std::cerr << error.what() << std::endl;
+		options.clear();
+	}
+
+	return options;
+}
+
+static Configuration buildConfiguration(const po::variables_map& options) {
+
+	auto processorTypeOption = options["processor-type"].as<std::string>();
+	Configuration configuration;
+	if (processorTypeOption == "schip") {
+		configuration = Configuration::buildSuperChipConfiguration();
+	} else if (processorTypeOption == "xochip") {
+		configuration = Configuration::buildXoChipConfiguration();
+	}
+
+	auto allowMisalignedOpCodesOption = options["allow-misaligned-opcodes"];
+	if (!allowMisalignedOpCodesOption.empty()) {
+		configuration.setAllowMisalignedOpcodes(allowMisalignedOpCodesOption.as<bool>());
+	}
+
+	auto translateBlocksOption = options["translate-blocks"];
+	if (!translateBlocksOption.empty()) {
+		configuration.setTranslateBlocks(translateBlocksOption.as<bool>());
+	}
+
+	auto graphicsCountRowHitsOption = options["graphics-count-row-hits"];
+	if (!graphicsCountRowHitsOption.empty()) {
+		configuration.setGraphicsCountRowHits(graphicsCountRowHitsOption.as<bool>());
+	}
+
+	auto graphicsCountExceededRowsOption = options["graphics-count-exceeded-rows"];
+	if (!graphicsCountExceededRowsOption.empty()) {
+		configuration.setGraphicsCountExceededRows(graphicsCountExceededRowsOption.as<bool>());
+	}
+
+	auto cyclesPerFrameOption = options["cycles-per-frame"];
+	if (!cyclesPerFrameOption.empty()) {
+		configuration.setCyclesPerFrame(cyclesPerFrameOption.as<int>());
+	}
+
+	auto seedOption = options["seed"];
+	if (!seedOption.empty()) {
+		configuration.setRandomSeed(seedOption.as<uint32_t>());
+	}
+
+	configuration.setGraphicsClip(options["graphics-clip"].as<bool>());
+
+	configuration.setChip8Shifts(options["chip8-shifts"].as<bool>());
+	configuration.setChip8LoadAndSave(options["chip8-load-save"].as<bool>());
+	configuration.setChip8IndexedJumps(options["chip8-indexed-jumps"].as<bool>());
+
+	return configuration;
+}
+
+// e.g. "0=0,120=0x20,130=0": press key 5 on frame 120, release it ten frames later
+static std::vector<KeyEvent> parseKeyScript(const std::string& script) {
+	std::vector<KeyEvent> events;
+	std::istringstream input(script);
+	std::string entry;
+	while (std::getline(input, entry, ',')) {
+		const auto separator = entry.find('=');
+		if (separator == std::string::npos)
+			throw std::runtime_error("Key script entries must look like frame=mask: " + entry);
+		const auto frame = std::stoi(entry.substr(0, separator));
+		const auto keys = std::stoul(entry.substr(separator + 1), nullptr, 0);
+		if (!events.empty() && (frame < events.back().frame))
+			throw std::runtime_error("Key script entries must be in frame order: " + entry);
+		events.push_back({ frame, (uint16_t)keys });
+	}
+	return events;
+}
+
+static Result run(const Configuration& configuration, const std::string& rom, const Limits& limits, const std::vector<KeyEvent>& script) {
+
+	Result result;
+
+	std::unique_ptr<Chip8> processor(ProcessorFactory::buildProcessor(configuration));
+	processor->initialise();
+
+	const auto started = timer::now();
+	try {
+		processor->loadGame(rom);
+		auto next = script.begin();
+		while (!processor->getFinished() && (result.frames < limits.frames) && (result.cycles < limits.cycles)) {
+			for (; (next != script.end()) && (next->frame <= result.frames); ++next)
+				processor->keyboard().setKeys(next->keys);
+			result.cycles += processor->runFrame();
+			processor->updateTimers();
+			processor->setDrawNeeded(false);	// As if presented
+			++result.frames;
+		}
+	} catch (std::exception& error) {
+		result.error = error.what();
+	}
+	result.seconds = std::chrono::duration<double>(timer::now() - started).count();
+
+	result.hash = processor->display().hash();
+	result.finished = processor->getFinished();
+
+	return result;
+}
+
+// As recorded: the configuration and keys come from the movie, and only the
+// frame and cycle limits apply
+static Result replay(const std::string& path, const Limits& limits) {
+
+	Result result;
+	result.replayed = true;
+
+	Movie movie;
+	try {
+		movie.load(path);
+	} catch (std::exception& error) {
+		result.error = error.what();
+		return result;
+	}
+
+	std::unique_ptr<Chip8> processor(ProcessorFactory::buildProcessor(movie.configuration()));
+
+	const auto started = timer::now();
+	try {
+		movie.prepare(*processor);
+		const auto frames = std::min(limits.frames, movie.getFrames());
+		while (!processor->getFinished() && (result.frames < frames) && (result.cycles < limits.cycles)) {
+			processor->keyboard().setKeys(movie.getKeys(result.frames));
+			result.cycles += processor->runFrame();
+			processor->updateTimers();
+			if ((result.outOfStep < 0) && !movie.verify(result.frames, *processor))
+				result.outOfStep = result.frames;
+			processor->setDrawNeeded(false);	// As if presented
+			++result.frames;
+		}
+	} catch (std::exception& error) {
+		result.error = error.what();
+	}
+	result.seconds = std::chrono::duration<double>(timer::now() - started).count();
+
+	result.hash = processor->display().hash();
+	result.finished = processor->getFinished();
+
+	return result;
+}
+
+int main(int argc, char* argv[]) {
+
+	auto options = processCommandLine(argc, argv);
+	if (options.empty()) {
+		return 1;
+	}
+
+	std::vector<KeyEvent> script;
+	try {
+		script = parseKeyScript(options["keys"].as<std::string>());
+	} catch (std::exception& error) {
+		std::cerr << error.what() << std::endl;
+		return 1;
+	}
+
+	const auto configuration = buildConfiguration(options);
+
+	auto cyclesOption = options["cycles"];
+	auto framesOption = options["frames"];
+	const Limits limits = {
+		framesOption.as<int>(),
+		cyclesOption.empty() ? std::numeric_limits<long long>::max() : cyclesOption.as<long long>()
+	};
+
+	// Movies play to the end unless told otherwise
+	const Limits replayLimits = {
+		framesOption.defaulted() ? std::numeric_limits<int>::max() : limits.frames,
+		limits.cycles
+	};
+
+	// Each job is a ROM or a movie, named by its path
+	std::vector<std::string> roms;
+	std::vector<std::function<Result()>> runs;
+	if (!options["rom"].empty()) {
+		for (const auto& rom : options["rom"].as<std::vector<std::string>>()) {
+			roms.push_back(rom);
+			runs.push_back([&, rom] { return run(configuration, rom, limits, script); });
+		}
+	}
+	if (!options["replay"].empty()) {
+		for (const auto& movie : options["replay"].as<std::vector<std::string>>()) {
+			roms.push_back(movie);
+			runs.push_back([&, movie] { return replay(movie, replayLimits); });
+		}
+	}
+	if (roms.empty()) {
+		std::cerr << "Nothing to run: give ROMs or movies to replay" << std::endl;
+		return 1;
+	}
+
+	auto jobs = options["jobs"].as<int>();
+	if (jobs <= 0)
+		jobs = std::max(1U, std::thread::hardware_concurrency());
+	jobs = std::min(jobs, (int)roms.size());
+
+	// Each thread takes the next job until there are none left
+	std::vector<Result> results(roms.size());
+	WorkerPool pool(jobs);
+	const auto started = timer::now();
+	pool.run(roms.size(), [&](size_t rom) {
+		results[rom] = runs[rom]();
+	});
+	const auto seconds = std::chrono::duration<double>(timer::now() - started).count();
+
+	boost::format row("%-40s %8d %12d %14.0f %10.0f %016X %s");
+	std::cout << boost::format("%-40s %8s %12s %14s %10s %-16s %s") % "ROM" % "Frames" % "Cycles" % "Cycles/s" % "Frames/s" % "Display" % "Status" << "\n";
+
+	long long frames = 0;
+	long long cycles = 0;
+	auto failures = 0;
+	for (size_t rom = 0; rom < roms.size(); ++rom) {
+		const auto& result = results[rom];
+		frames += result.frames;
+		cycles += result.cycles;
+		const auto seconds = result.seconds > 0.0 ? result.seconds : 1e-9;
+		std::string status = result.finished ? "exited" : "ok";
+		if (result.replayed)
+			status = result.outOfStep < 0 ? "verified" : (boost::format("out of step at frame %d") % result.outOfStep).str();
+		if (result.outOfStep >= 0)
+			++failures;
+		if (!result.error.empty()) {
+			status = "error: " + result.error;
+			++failures;
+		}
+		std::cout << row % roms[rom] % result.frames % result.cycles % (result.cycles / seconds) % (result.frames / seconds) % result.hash % status << "\n";
+	}
+
+	std::cout
+		<< boost::format("%d ROMs on %d threads in %.3fs: %.0f cycles/s, %.0f frames/s")
+			% roms.size() % jobs % seconds % (cycles / seconds) % (frames / seconds)
+		<< std::endl;
+
+	return failures == 0 ? 0 : 2;
+}
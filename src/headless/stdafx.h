@@ -0,0 +1,24 @@
+#ifdef _MSC_VER
+#pragma once
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/format.hpp>
+#include <boost/program_options.hpp>
+
+#include <ProcessorFactory.h>
+#include <Configuration.h>
+#include <Chip8.h>
+#include <Movie.h>
+#include <WorkerPool.h>
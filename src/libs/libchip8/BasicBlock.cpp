@@ -0,0 +1,36 @@
+#include "stdafx.h"
+#include "BasicBlock.h"
+
+bool BasicBlock::isTerminator(const Instruction& instruction) {
+	switch (instruction.opcode & 0xf000) {
+
+	// CLS, RET, scrolling, EXIT and the resolution changes
+	case 0x0000:
+		return true;
+
+	// JP, CALL, the skips and JP V0
+	case 0x1000:
+	case 0x2000:
+	case 0x3000:
+	case 0x4000:
+	case 0x9000:
+	case 0xB000:
+	case 0xe000:
+		return true;
+
+	// SE VX,VY (XO-Chip's save and load ranges don't alter flow)
+	case 0x5000:
+		return instruction.n == 0;
+
+	// DRW: the controller may need to present the frame
+	case 0xd000:
+		return true;
+
+	// LD VX,K waits for a key; XO-Chip's long I load skips its operand
+	case 0xf000:
+		return instruction.nn == 0x0a || instruction.nnn == 0;
+
+	default:
+		return false;
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+
+#include "Instruction.h"
+
+// A straight-line run of predecoded instructions, ending with
+// (and including) the first instruction that may leave the run.
+class BasicBlock final {
+public:
+	enum {
+		MaximumLength = 64
+	};
+
+	static bool isTerminator(const Instruction& instruction);
+
+	const std::vector<Instruction>& instructions() const {
+		return m_instructions;
+	}
+
+	bool empty() const {
+		return m_instructions.empty();
+	}
+
+	void add(const Instruction& instruction) {
+		m_instructions.push_back(instruction);
+	}
+
+	bool isComplete() const {
+		return empty() ? false : (m_instructions.size() == MaximumLength) || isTerminator(m_instructions.back());
+	}
+
+private:
+	std::vector<Instruction> m_instructions;
+};
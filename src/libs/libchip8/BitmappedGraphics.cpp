@@ -20,7 +20,7 @@ int BitmappedGraphics::draw(const Memory& memory, int address, const int drawX,
 			address += height * bytesPerRow;
 		}
 	}
-	setDirty();
+	setRowsDirty(drawY, std::max(height, 1));	// Even an empty sprite needs a draw, which ends a low resolution frame
 	if (!m_countRowHits)
 		hits = hits > 0 ? 1 : 0;
 	return (int)hits;
@@ -56,6 +56,96 @@ void BitmappedGraphics::clear() {
 	setDirty();
 }
 
+// Rows are marked as if the sprite wraps at the bottom edge, even when it doesn't: redrawing a clean row is harmless
+void BitmappedGraphics::setRowsDirty(const int drawY, const int height) {
+	const auto screenHeight = getHeight();
+	auto row = drawY % screenHeight;
+	for (int count = 0; count < height; ++count) {
+		m_dirtyRows |= uint64_t(1) << row;
+		if (++row == screenHeight)
+			row = 0;
+	}
+}
+
+// Planar to chunky: eight pixels at a time, each plane byte is spread into
+// one bit of eight palette indices, which are then looked up together.
+void BitmappedGraphics::composeRow(const int y, const uint32_t* palette, uint32_t* destination) const {
+	const auto& spread = spreadTable();
+	const auto words = getWidth() / 64;
+	for (int word = 0; word < words; ++word) {
+		for (int shift = 56; shift >= 0; shift -= 8) {
+			uint64_t indices = spread[(m_planes[0].rows()[y][word] >> shift) & 0xff];
+			for (int plane = 1; plane < m_numberOfPlanes; ++plane)
+				indices |= spread[(m_planes[plane].rows()[y][word] >> shift) & 0xff] << plane;
+			for (int pixel = 0; pixel < 8; ++pixel, indices >>= 8)
+				*destination++ = palette[indices & 0xff];
+		}
+	}
+}
+
+uint64_t BitmappedGraphics::hash() const {
+	uint64_t hash = 0xcbf29ce484222325;
+	const auto add = [&hash](uint64_t word) {
+		for (int byte = 0; byte < 8; ++byte, word >>= 8) {
+			hash ^= word & 0xff;
+			hash *= 0x100000001b3;
+		}
+	};
+	add(getWidth());
+	const auto words = getWidth() / 64;
+	for (const auto& plane : m_planes) {
+		for (int y = 0; y < getHeight(); ++y) {
+			for (int word = 0; word < words; ++word)
+				add(plane.rows()[y][word]);
+		}
+	}
+	return hash;
+}
+
+void BitmappedGraphics::pack(uint64_t* output) const {
+	const auto height = getHeight();
+	const auto planeWords = getPackedWords(1);
+	for (const auto& plane : m_planes) {
+		auto word = output;
+		for (int y = 0; y < height; ++y) {
+			const auto& row = plane.rows()[y];
+			*word++ = row[0];
+			*word++ = row[1];
+		}
+		std::fill(word, output + planeWords, uint64_t(0));
+		output += planeWords;
+	}
+}
+
+void BitmappedGraphics::unpack(const uint64_t* input) {
+	const auto height = getHeight();
+	const auto planeWords = getPackedWords(1);
+	for (auto& plane : m_planes) {
+		auto word = input;
+		for (int y = 0; y < height; ++y) {
+			auto& row = plane.rows()[y];
+			row[0] = *word++;
+			row[1] = *word++;
+		}
+		input += planeWords;
+	}
+}
+
+// Entry n holds the bits of n one per byte, leftmost pixel (bit seven) in the lowest byte
+const std::array<uint64_t, 256>& BitmappedGraphics::spreadTable() {
+	static const std::array<uint64_t, 256> table = [] {
+		std::array<uint64_t, 256> spread;
+		for (int value = 0; value < 256; ++value) {
+			uint64_t bytes = 0;
+			for (int bit = 0; bit < 8; ++bit)
+				bytes |= uint64_t((value >> (7 - bit)) & 1) << (bit * 8);
+			spread[value] = bytes;
+		}
+		return spread;
+	}();
+	return table;
+}
+
 bool BitmappedGraphics::isPlaneSelected(const int plane) const {
 	const auto mask = 1 << plane;
 	return (getPlaneMask() & mask) != 0;
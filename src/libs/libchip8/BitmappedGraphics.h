@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <vector>
 
 #include "GraphicsPlane.h"
@@ -66,11 +68,43 @@ public:
 	}
 
 	bool getDirty() const {
-		return m_dirty;
+		return m_dirtyRows != 0;
 	}
 
+	// Marks (or clears) every row
 	void setDirty(const bool value = true) {
-		m_dirty = value;
+		m_dirtyRows = value ? ~uint64_t(0) : 0;
+	}
+
+	// One bit per display row, row zero in the least significant bit
+	uint64_t getDirtyRows() const {
+		return m_dirtyRows;
+	}
+
+	void setDirtyRows(const uint64_t rows) {
+		m_dirtyRows = rows;
+	}
+
+	bool isRowDirty(const int row) const {
+		return ((m_dirtyRows >> row) & 1) != 0;
+	}
+
+	// Writes one palette colour per pixel of row y, reading the planes in place
+	void composeRow(int y, const uint32_t* palette, uint32_t* destination) const;
+
+	// FNV-1a over the visible pixels of every plane, for comparing runs
+	uint64_t hash() const;
+
+	// Copies the display out at a fixed size whatever the resolution: plane by plane,
+	// each plane as 64 rows of two words, the leftmost pixel in the top bit of a row's
+	// first word.  Low resolution uses the first 32 rows and only their first words.
+	void pack(uint64_t* output) const;
+
+	// The reverse of pack, at the current resolution
+	void unpack(const uint64_t* input);
+
+	static size_t getPackedWords(const int numberOfPlanes) {
+		return numberOfPlanes * GraphicsPlane::ScreenHeightHigh * 2;
 	}
 
 	void initialise();
@@ -94,7 +128,7 @@ private:
 			m_planeMask,
 			m_highResolution,
 			m_countRowHits,
-			m_dirty);
+			m_dirtyRows);
 	}
 
 	int m_numberOfPlanes = 1;
@@ -102,10 +136,14 @@ private:
 	int m_planeMask = 1;
 	bool m_highResolution = false;
 	bool m_countRowHits = false;
-	bool m_dirty = false;
+	uint64_t m_dirtyRows = 0;
 
 	bool isPlaneSelected(int plane) const;
 
+	void setRowsDirty(int drawY, int height);
+
+	static const std::array<uint64_t, 256>& spreadTable();
+
 	void maybeScrollUp(int plane, int count);
 	void maybeScrollDown(int plane, int count);
 	void maybeScrollLeft(int plane);
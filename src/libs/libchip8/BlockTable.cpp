@@ -0,0 +1,12 @@
+#include "stdafx.h"
+#include "BlockTable.h"
+
+void BlockTable::flush(Memory& memory) {
+	if (!matches(memory)) {
+		m_pages.assign(memory.pages().size(), std::vector<BasicBlock>());
+	} else {
+		for (const auto page : memory.getModifiedPages())
+			m_pages[page].clear();
+	}
+	memory.clearCodeModified();
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "BasicBlock.h"
+#include "Memory.h"
+
+// Translated blocks, by memory page and then by even address within the page.
+// A page's blocks are only allocated once something runs from it, and are all
+// dropped when code in the page is written over.  As with predecoded
+// instructions, copies start out empty and translate whatever they run.
+class BlockTable final {
+public:
+	BlockTable() = default;
+
+	BlockTable(const BlockTable&) {}
+
+	BlockTable& operator=(const BlockTable&) {
+		m_pages.clear();
+		return *this;
+	}
+
+	// Whether the table has a page for each page of memory
+	bool matches(const Memory& memory) const {
+		return m_pages.size() == memory.pages().size();
+	}
+
+	// Drops the blocks in pages whose code has been modified, then clears the memory's record of them
+	void flush(Memory& memory);
+
+	// Empty if nothing has been translated at the address since its page was last flushed
+	BasicBlock& block(const uint16_t address) {
+		auto& page = m_pages[address >> Memory::PageShift];
+		if (page.empty())
+			page.resize(Memory::PageSize / 2);
+		return page[(address & Memory::PageMask) >> 1];
+	}
+
+private:
+	std::vector<std::vector<BasicBlock>> m_pages;
+};
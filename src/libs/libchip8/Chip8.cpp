@@ -1,20 +1,28 @@
 #include "stdafx.h"
 #include "Chip8.h"
 
+#include <atomic>
 #include <limits>
+#include <random>
 
 #include "Configuration.h"
+#include "Profiler.h"
 
-Chip8::Chip8()
-: m_eightBitDistribution(0, std::numeric_limits<uint8_t>::max()) {
+Chip8::Chip8() {
 }
 
 Chip8::Chip8(const Memory& memory, const KeyboardDevice& keyboard, const BitmappedGraphics& display, const Configuration& configuration)
 : m_display(display),
   m_memory(memory),
   m_keyboard(keyboard),
-  m_configuration(configuration),
-  m_eightBitDistribution(0, std::numeric_limits<uint8_t>::max()) {
+  m_configuration(configuration) {
+}
+
+// Machines left to choose their own seeds take them from a sequence started
+// once per process, so only the first initialise pays for random_device
+static uint32_t chooseRandomSeed() {
+	static std::atomic<uint32_t> next { std::random_device()() };
+	return next.fetch_add(0x9e3779b9);
 }
 
 void Chip8::initialise() {
@@ -36,7 +44,7 @@ void Chip8::initialise() {
 	memory().clear();
 
 	// Load fonts
-	std::copy_n(m_standardFont.cbegin(), m_standardFont.size(), memory().bus().begin() + StandardFontOffset);
+	memory().set(StandardFontOffset, m_standardFont.data(), m_standardFont.size());
 
 	// Reset timers
 	delayTimer() = soundTimer() = 0;
@@ -44,7 +52,77 @@ void Chip8::initialise() {
 	m_soundPlaying = false;
 	setWaitingForKeyPress(false);
 
-	m_randomNumberGenerator.seed(std::random_device()());
+	const auto seed = configuration().getRandomSeed();
+	seedRandomNumbers(seed == 0 ? chooseRandomSeed() : seed);
+}
+
+void Chip8::seedRandomNumbers(const uint32_t seed) {
+	m_randomSeed = seed;
+	m_randomNumberGenerator.seed(seed);
+}
+
+Chip8* Chip8::clone() const {
+	auto copy = new Chip8(*this);
+	copy->disconnect();
+	return copy;
+}
+
+void Chip8::disconnect() {
+	BeepStarting.clear();
+	BeepStopped.clear();
+	EmulatingCycle.clear();
+	EmulatedCycle.clear();
+	m_profiler = nullptr;
+}
+
+void Chip8::saveSnapshot(Snapshot& snapshot) const {
+	snapshot.v = m_v;
+	snapshot.stack = m_stack;
+	snapshot.i = m_i;
+	snapshot.pc = m_pc;
+	snapshot.sp = m_sp;
+	snapshot.opcode = m_opcode;
+	snapshot.delayTimer = m_delayTimer;
+	snapshot.soundTimer = m_soundTimer;
+	snapshot.finished = m_finished;
+	snapshot.soundPlaying = m_soundPlaying;
+	snapshot.waitingForKeyPress = m_waitingForKeyPress;
+	snapshot.waitingForKeyPressRegister = m_waitingForKeyPressRegister;
+	snapshot.keys = m_keyboard.getKeys();
+	snapshot.randomNumberGenerator = m_randomNumberGenerator;
+
+	snapshot.highResolution = m_display.getHighResolution();
+	snapshot.planeMask = m_display.getPlaneMask();
+	snapshot.dirtyRows = m_display.getDirtyRows();
+	snapshot.display.resize(BitmappedGraphics::getPackedWords(m_display.getNumberOfPlanes()));
+	m_display.pack(snapshot.display.data());
+
+	snapshot.memory = m_memory.pages();
+}
+
+void Chip8::loadSnapshot(const Snapshot& snapshot) {
+	m_v = snapshot.v;
+	m_stack = snapshot.stack;
+	m_i = snapshot.i;
+	m_pc = snapshot.pc;
+	m_sp = snapshot.sp;
+	m_opcode = snapshot.opcode;
+	m_delayTimer = snapshot.delayTimer;
+	m_soundTimer = snapshot.soundTimer;
+	m_finished = snapshot.finished;
+	m_soundPlaying = snapshot.soundPlaying;
+	m_waitingForKeyPress = snapshot.waitingForKeyPress;
+	m_waitingForKeyPressRegister = snapshot.waitingForKeyPressRegister;
+	m_keyboard.setKeys(snapshot.keys);
+	m_randomNumberGenerator = snapshot.randomNumberGenerator;
+
+	if (m_display.getHighResolution() != snapshot.highResolution)
+		m_display.setHighResolution(snapshot.highResolution);
+	m_display.setPlaneMask(snapshot.planeMask);
+	m_display.unpack(snapshot.display.data());
+	m_display.setDirtyRows(snapshot.dirtyRows);
+
+	m_memory.restore(snapshot.memory);
 }
 
 void Chip8::loadGame(const std::string& game) {
@@ -59,6 +137,7 @@ void Chip8::step() {
 }
 
 void Chip8::updateTimers() {
+	CHIP8_PROFILE_SECTION(*this, Timers);
 	updateDelayTimer();
 	updateSoundTimer();
 }
@@ -74,7 +153,6 @@ void Chip8::onBeepStopped() {
 }
 
 void Chip8::onEmulatingCycle(uint16_t programCounter, uint16_t instruction, int address, int operand, int n, int x, int y) {
-	mnemomicFormat().clear();
 	EmulatingCycle.fire(InstructionEventArgs(programCounter, instruction, address, operand, n, x, y));
 }
 
@@ -83,130 +161,209 @@ void Chip8::onEmulatedCycle(uint16_t programCounter, uint16_t instruction, int a
 }
 
 void Chip8::emulateCycle() {
-	// <-         opcode         ->
-	// <-    high  -><-    low   ->
-	//        <-        nnn      ->
-	//               <-    nn    ->
-	//                      <- n ->
-	//        <- x ->
-	//               <- y ->
-	m_opcode = memory().getWord(PC());
-	auto nnn = m_opcode & 0xfff;
-	auto nn = m_opcode & 0xff;
-	auto n = nn & 0xf;
-	auto x = (m_opcode & 0xf00) >> 8;
-	auto y = (nn & 0xf0) >> 4;
-
-	if (((PC() % 2) == 1) && !configuration().getAllowMisalignedOpcodes())
+	const auto programCounter = PC();
+	if (((programCounter % 2) == 1) && !configuration().getAllowMisalignedOpcodes())
 		throw std::runtime_error("Instruction is not on an aligned address.");
 
-	auto programCounter = PC();
+	// Taken by value: the instruction may overwrite its own cache slot
+	const auto instruction = fetchInstruction(programCounter);
+	executeInstruction(programCounter, instruction);
+}
+
+int Chip8::runFrame() {
+	const auto limit = configuration().getCyclesPerFrame();
+	auto cycles = 0;
+	while (!finishedCycling(cycles))
+		cycles += runBlock(limit - cycles + 1);
+	return cycles;
+}
+
+bool Chip8::finishedCycling(const int cycles) const {
+	const auto exhausted = cycles > configuration().getCyclesPerFrame();
+	const auto draw = display().getLowResolution() && getDrawNeeded();
+	return exhausted || getFinished() || draw;
+}
+
+int Chip8::runBlock(const int limit) {
+
+	const auto programCounter = PC();
+	if (!configuration().getTranslateBlocks() || isWaitingForKeyPress() || ((programCounter % 2) == 1)) {
+		step();
+		return 1;
+	}
+
+	// Self-modified code: translations from the pages written to are suspect
+	if (memory().getCodeModified() || !m_blocks.matches(memory()))
+		m_blocks.flush(memory());
+
+	auto& block = m_blocks.block(programCounter);
+	if (block.empty())
+		translateBlock(programCounter, block);
+	if (block.empty()) {
+		step();	// Let the interpreter report the problem
+		return 1;
+	}
+
+	const auto& instructions = block.instructions();
+	const auto length = std::min(limit, (int)instructions.size());
+	auto executed = 0;
+	while (executed < length) {
+		executeInstruction(PC(), instructions[executed++]);
+		if (memory().getCodeModified())
+			break;
+	}
+	return executed;
+}
+
+// Blocks stop at the end of their page, so that a write only ever invalidates the page it lands in
+void Chip8::translateBlock(const uint16_t address, BasicBlock& block) {
+	const auto end = std::min(memory().size(), (address | Memory::PageMask) + 1);
+	for (int current = address; !block.isComplete() && ((current + 1) < end); current += 2) {
+		auto& instruction = memory().instruction(current);
+		if (!instruction.isDecoded()) {
+			instruction.decode(memory().getWord(current));
+			if (!decodeInstruction(instruction)) {
+				instruction.handler = nullptr;
+				break;
+			}
+		}
+		block.add(instruction);
+	}
+}
+
+void Chip8::executeInstruction(const uint16_t programCounter, const Instruction& instruction) {
+	m_opcode = instruction.opcode;
+
 	PC() += 2;
 
-	onEmulatingCycle(programCounter, m_opcode, nnn, nn, n, x, y);
-	if (!emulateInstruction(nnn, nn, n, x, y))
-		throw std::runtime_error("Illegal instruction (is the processor type set correctly?)");
+#ifdef CHIP8_PROFILING
+	if (m_profiler != nullptr)
+		m_profiler->count(programCounter, m_opcode);
+#endif
 
-	onEmulatedCycle(programCounter, m_opcode, nnn, nn, n, x, y);
+	// Event arguments are only built when someone is listening
+	if (!EmulatingCycle.empty())
+		onEmulatingCycle(programCounter, m_opcode, instruction.nnn, instruction.nn, instruction.n, instruction.x, instruction.y);
+
+	instruction.handler(*this, instruction);
+
+	if (!EmulatedCycle.empty())
+		onEmulatedCycle(programCounter, m_opcode, instruction.nnn, instruction.nn, instruction.n, instruction.x, instruction.y);
+}
+
+const Instruction& Chip8::fetchInstruction(const uint16_t address) {
+
+	// Misaligned instructions overlap the cache slots, so they're decoded afresh every time
+	const auto misaligned = (address % 2) == 1;
+	auto& instruction = misaligned ? m_misalignedInstruction : memory().instruction(address);
+	if (misaligned || !instruction.isDecoded()) {
+		instruction.decode(memory().getWord(address));
+		if (!decodeInstruction(instruction)) {
+			instruction.handler = nullptr;
+			throw std::runtime_error("Illegal instruction (is the processor type set correctly?)");
+		}
+	}
+	return instruction;
 }
 
 void Chip8::draw(int x, int y, int width, int height) {
+	CHIP8_PROFILE_SECTION(*this, Draw);
 	const auto hits = display().draw(memory(), indirector(), registers()[x], registers()[y], width, height);
 	registers()[0xf] = (uint8_t)hits;
 }
 
-bool Chip8::emulateInstruction(int nnn, int nn, int n, int x, int y) {
+bool Chip8::decodeInstruction(Instruction& instruction) {
 
-	switch (m_opcode & 0xf000) {
+	switch (instruction.opcode & 0xf000) {
 	case 0x0000:
-		return emulateInstructions_0(nnn, nn, n, x, y);
+		return decodeInstructions_0(instruction);
 
 	case 0x1000:
-		return emulateInstructions_1(nnn, nn, n, x, y);
+		return decodeInstructions_1(instruction);
 
 	case 0x2000:
-		return emulateInstructions_2(nnn, nn, n, x, y);
+		return decodeInstructions_2(instruction);
 
 	case 0x3000:
-		return emulateInstructions_3(nnn, nn, n, x, y);
+		return decodeInstructions_3(instruction);
 
 	case 0x4000:
-		return emulateInstructions_4(nnn, nn, n, x, y);
+		return decodeInstructions_4(instruction);
 
 	case 0x5000:
-		return emulateInstructions_5(nnn, nn, n, x, y);
+		return decodeInstructions_5(instruction);
 
 	case 0x6000:
-		return emulateInstructions_6(nnn, nn, n, x, y);
+		return decodeInstructions_6(instruction);
 
 	case 0x7000:
-		return emulateInstructions_7(nnn, nn, n, x, y);
+		return decodeInstructions_7(instruction);
 
 	case 0x8000:
-		return emulateInstructions_8(nnn, nn, n, x, y);
+		return decodeInstructions_8(instruction);
 
 	case 0x9000:
-		return emulateInstructions_9(nnn, nn, n, x, y);
+		return decodeInstructions_9(instruction);
 
 	case 0xa000:
-		return emulateInstructions_A(nnn, nn, n, x, y);
+		return decodeInstructions_A(instruction);
 
 	case 0xB000:
-		return emulateInstructions_B(nnn, nn, n, x, y);
+		return decodeInstructions_B(instruction);
 
 	case 0xc000:
-		return emulateInstructions_C(nnn, nn, n, x, y);
+		return decodeInstructions_C(instruction);
 
 	case 0xd000:
-		return emulateInstructions_D(nnn, nn, n, x, y);
+		return decodeInstructions_D(instruction);
 
 	case 0xe000:
-		return emulateInstructions_E(nnn, nn, n, x, y);
+		return decodeInstructions_E(instruction);
 
 	case 0xf000:
-		return emulateInstructions_F(nnn, nn, n, x, y);
+		return decodeInstructions_F(instruction);
 
 	default:
 		return false;
 	}
 }
 
-bool Chip8::emulateInstructions_F(int, int nn, int, int x, int) {
-	switch (nn) {
+bool Chip8::decodeInstructions_F(Instruction& instruction) {
+	switch (instruction.nn) {
 	case 0x07:
-		LD_Vx_DT(x);
+		instruction.handler = [](Chip8& processor, const Instruction& operands) { processor.LD_Vx_DT(operands.x); };
 		break;
 
 	case 0x0a:
-		LD_Vx_K(x);
+		instruction.handler = [](Chip8& processor, const Instruction& operands) { processor.LD_Vx_K(operands.x); };
 		break;
 
 	case 0x15:
-		LD_DT_Vx(x);
+		instruction.handler = [](Chip8& processor, const Instruction& operands) { processor.LD_DT_Vx(operands.x); };
 		break;
 
 	case 0x18:
-		LD_ST_Vx(x);
+		instruction.handler = [](Chip8& processor, const Instruction& operands) { processor.LD_ST_Vx(operands.x); };
 		break;
 
 	case 0x1e:
-		ADD_I_Vx(x);
+		instruction.handler = [](Chip8& processor, const Instruction& operands) { processor.ADD_I_Vx(operands.x); };
 		break;
 
 	case 0x29:
-		LD_F_Vx(x);
+		instruction.handler = [](Chip8& processor, const Instruction& operands) { processor.LD_F_Vx(operands.x); };
 		break;
 
 	case 0x33:
-		LD_B_Vx(x);
+		instruction.handler = [](Chip8& processor, const Instruction& operands) { processor.LD_B_Vx(operands.x); };
 		break;
 
 	case 0x55:
-		LD_II_Vx(x);
+		instruction.handler = [](Chip8& processor, const Instruction& operands) { processor.LD_II_Vx(operands.x); };
 		break;
 
 	case 0x65:
-		LD_Vx_II(x);
+		instruction.handler = [](Chip8& processor, const Instruction& operands) { processor.LD_Vx_II(operands.x); };
 		break;
 
 	default:
@@ -216,14 +373,14 @@ bool Chip8::emulateInstructions_F(int, int nn, int, int x, int) {
 	return true;
 }
 
-bool Chip8::emulateInstructions_E(int, int nn, int, int x, int) {
-	switch (nn) {
+bool Chip8::decodeInstructions_E(Instruction& instruction) {
+	switch (instruction.nn) {
 	case 0x9E:
-		SKP(x);
+		instruction.handler = [](Chip8& processor, const Instruction& operands) { processor.SKP(operands.x); };
 		break;
 
 	case 0xa1:
-		SKNP(x);
+		instruction.handler = [](Chip8& processor, const Instruction& operands) { processor.SKNP(operands.x); };
 		break;
 
 	default:
@@ -233,30 +390,30 @@ bool Chip8::emulateInstructions_E(int, int nn, int, int x, int) {
 	return true;
 }
 
-bool Chip8::emulateInstructions_D(int, int, int n, int x, int y) {
-	DRW(x, y, n);
+bool Chip8::decodeInstructions_D(Instruction& instruction) {
+	instruction.handler = [](Chip8& processor, const Instruction& operands) { processor.DRW(operands.x, operands.y, operands.n); };
 	return true;
 }
 
-bool Chip8::emulateInstructions_C(int, int nn, int, int x, int) {
-	RND(x, nn);
+bool Chip8::decodeInstructions_C(Instruction& instruction) {
+	instruction.handler = [](Chip8& processor, const Instruction& operands) { processor.RND(operands.x, operands.nn); };
 	return true;
 }
 
-bool Chip8::emulateInstructions_B(int nnn, int, int, int x, int) {
-	JP_V0(x, nnn);
+bool Chip8::decodeInstructions_B(Instruction& instruction) {
+	instruction.handler = [](Chip8& processor, const Instruction& operands) { processor.JP_V0(operands.x, operands.nnn); };
 	return true;
 }
 
-bool Chip8::emulateInstructions_A(int nnn, int, int, int, int) {
-	LD_I(nnn);
+bool Chip8::decodeInstructions_A(Instruction& instruction) {
+	instruction.handler = [](Chip8& processor, const Instruction& operands) { processor.LD_I(operands.nnn); };
 	return true;
 }
 
-bool Chip8::emulateInstructions_9(int, int, int n, int x, int y) {
-	switch (n) {
+bool Chip8::decodeInstructions_9(Instruction& instruction) {
+	switch (instruction.n) {
 	case 0:
-		SNE(x, y);
+		instruction.handler = [](Chip8& processor, const Instruction& operands) { processor.SNE(operands.x, operands.y); };
 		break;
 
 	default:
@@ -266,42 +423,42 @@ bool Chip8::emulateInstructions_9(int, int, int n, int x, int y) {
 	return true;
 }
 
-bool Chip8::emulateInstructions_8(int, int, int n, int x, int y) {
-	switch (n) {
+bool Chip8::decodeInstructions_8(Instruction& instruction) {
+	switch (instruction.n) {
 	case 0x0:
-		LD(x, y);
+		instruction.handler = [](Chip8& processor, const Instruction& operands) { processor.LD(operands.x, operands.y); };
 		break;
 
 	case 0x1:
-		OR(x, y);
+		instruction.handler = [](Chip8& processor, const Instruction& operands) { processor.OR(operands.x, operands.y); };
 		break;
 
 	case 0x2:
-		AND(x, y);
+		instruction.handler = [](Chip8& processor, const Instruction& operands) { processor.AND(operands.x, operands.y); };
 		break;
 
 	case 0x3:
-		XOR(x, y);
+		instruction.handler = [](Chip8& processor, const Instruction& operands) { processor.XOR(operands.x, operands.y); };
 		break;
 
 	case 0x4:
-		ADD(x, y);
+		instruction.handler = [](Chip8& processor, const Instruction& operands) { processor.ADD(operands.x, operands.y); };
 		break;
 
 	case 0x5:
-		SUB(x, y);
+		instruction.handler = [](Chip8& processor, const Instruction& operands) { processor.SUB(operands.x, operands.y); };
 		break;
 
 	case 0x6:
-		SHR(x, y);
+		instruction.handler = [](Chip8& processor, const Instruction& operands) { processor.SHR(operands.x, operands.y); };
 		break;
 
 	case 0x7:
-		SUBN(x, y);
+		instruction.handler = [](Chip8& processor, const Instruction& operands) { processor.SUBN(operands.x, operands.y); };
 		break;
 
 	case 0xe:
-		SHL(x, y);
+		instruction.handler = [](Chip8& processor, const Instruction& operands) { processor.SHL(operands.x, operands.y); };
 		break;
 
 	default:
@@ -311,49 +468,49 @@ bool Chip8::emulateInstructions_8(int, int, int n, int x, int y) {
 	return true;
 }
 
-bool Chip8::emulateInstructions_7(int, int nn, int, int x, int) {
-	ADD_REG_IMM(x, nn);
+bool Chip8::decodeInstructions_7(Instruction& instruction) {
+	instruction.handler = [](Chip8& processor, const Instruction& operands) { processor.ADD_REG_IMM(operands.x, operands.nn); };
 	return true;
 }
 
-bool Chip8::emulateInstructions_6(int, int nn, int, int x, int) {
-	LD_REG_IMM(x, nn);
+bool Chip8::decodeInstructions_6(Instruction& instruction) {
+	instruction.handler = [](Chip8& processor, const Instruction& operands) { processor.LD_REG_IMM(operands.x, operands.nn); };
 	return true;
 }
 
-bool Chip8::emulateInstructions_5(int, int, int, int x, int y) {
-	SE(x, y);
+bool Chip8::decodeInstructions_5(Instruction& instruction) {
+	instruction.handler = [](Chip8& processor, const Instruction& operands) { processor.SE(operands.x, operands.y); };
 	return true;
 }
 
-bool Chip8::emulateInstructions_4(int, int nn, int, int x, int) {
-	SNE_REG_IMM(x, nn);
+bool Chip8::decodeInstructions_4(Instruction& instruction) {
+	instruction.handler = [](Chip8& processor, const Instruction& operands) { processor.SNE_REG_IMM(operands.x, operands.nn); };
 	return true;
 }
 
-bool Chip8::emulateInstructions_3(int, int nn, int, int x, int) {
-	SE_REG_IMM(x, nn);
+bool Chip8::decodeInstructions_3(Instruction& instruction) {
+	instruction.handler = [](Chip8& processor, const Instruction& operands) { processor.SE_REG_IMM(operands.x, operands.nn); };
 	return true;
 }
 
-bool Chip8::emulateInstructions_2(int nnn, int, int, int, int) {
-	CALL(nnn);
+bool Chip8::decodeInstructions_2(Instruction& instruction) {
+	instruction.handler = [](Chip8& processor, const Instruction& operands) { processor.CALL(operands.nnn); };
 	return true;
 }
 
-bool Chip8::emulateInstructions_1(int nnn, int, int, int, int) {
-	JP(nnn);
+bool Chip8::decodeInstructions_1(Instruction& instruction) {
+	instruction.handler = [](Chip8& processor, const Instruction& operands) { processor.JP(operands.nnn); };
 	return true;
 }
 
-bool Chip8::emulateInstructions_0(int, int nn, int, int, int) {
-	switch (nn) {
+bool Chip8::decodeInstructions_0(Instruction& instruction) {
+	switch (instruction.nn) {
 	case 0xe0:
-		CLS();
+		instruction.handler = [](Chip8& processor, const Instruction&) { processor.CLS(); };
 		break;
 
 	case 0xee:
-		RET();
+		instruction.handler = [](Chip8& processor, const Instruction&) { processor.RET(); };
 		break;
 
 	default:
@@ -366,82 +523,67 @@ bool Chip8::emulateInstructions_0(int, int nn, int, int, int) {
 ////
 
 void Chip8::CLS() {
-	mnemomicFormat() = "CLS";
 	display().clear();
 }
 
 void Chip8::RET() {
-	mnemomicFormat() = "RET";
 	PC() = stack()[--SP() & 0xF];
 }
 
 void Chip8::JP(int nnn) {
-	mnemomicFormat() = "JP %1$03X";
 	PC() = (uint16_t)nnn;
 }
 
 void Chip8::CALL(int nnn) {
-	mnemomicFormat() = "CALL %1$03X";
 	stack()[SP()++] = PC();
 	PC() = (uint16_t)nnn;
 }
 
 void Chip8::SE_REG_IMM(int x, int nn) {
-	mnemomicFormat() = "SE V%4$01X,%2$02X";
 	if (registers()[x] == nn)
 		PC() += 2;
 }
 
 void Chip8::SNE_REG_IMM(int x, int nn) {
-	mnemomicFormat() = "SNE V%4$01X,%2$02X";
 	if (registers()[x] != nn)
 		PC() += 2;
 }
 
 void Chip8::SE(int x, int y) {
-	mnemomicFormat() = "SE V%4$01X,V%5$01X";
 	if (registers()[x] == registers()[y])
 		PC() += 2;
 }
 
 void Chip8::LD_REG_IMM(int x, int nn) {
-	mnemomicFormat() = "LD V%4$01X,%2$02X";
 	registers()[x] = (uint8_t)nn;
 }
 
 void Chip8::ADD_REG_IMM(int x, int nn) {
-	m_mnemomicFormat = "ADD V%4$01X,%2$02X";
 	registers()[x] += (uint8_t)nn;
 }
 
 void Chip8::LD(int x, int y) {
-	mnemomicFormat() = "LD V%4$01X,V%5$01X";
 	registers()[x] = registers()[y];
 }
 
 void Chip8::OR(int x, int y) {
-	mnemomicFormat() = "OR V%4$01X,V%5$01X";
 	registers()[x] |= registers()[y];
 }
 
 void Chip8::AND(int x, int y) {
-	mnemomicFormat() = "AND V%4$01X,V%5$01X";
 	registers()[x] &= registers()[y];
 }
 
 void Chip8::XOR(int x, int y) {
-	mnemomicFormat() = "XOR V%4$01X,V%5$01X";
 	registers()[x] ^= registers()[y];
 }
 
 void Chip8::ADD(int x, int y) {
-	mnemomicFormat() = "ADD V%4$01X,V%5$01X";
 	registers()[0xf] = (uint8_t)(registers()[y] > (0xff - registers()[x]) ? 1 : 0);
 	registers()[x] += registers()[y];
 }
 
 void Chip8::SUB(int x, int y) {
-	mnemomicFormat() = "SUB V%4$01X,V%5$01X";
 	registers()[0xf] = (uint8_t)(registers()[x] >= registers()[y] ? 1 : 0);
 	registers()[x] -= registers()[y];
 }
@@ -449,14 +591,12 @@ void Chip8::SUB(int x, int y) {
 void Chip8::SHR(int x, int y) {
 	// https://github.com/Chromatophore/HP48-Superchip#8xy6--8xye
 	// Bit shifts X register by 1, VIP: shifts Y by one and places in X, HP48-SC: ignores Y field, shifts X
-	mnemomicFormat() = "SHR V%4$01X,V%5$01X";
 	registers()[0xf] = (uint8_t)(registers()[y] & 0x1);
 	registers()[y] >>= 1;
 	registers()[x] = registers()[y];
 }
 
 void Chip8::SUBN(int x, int y) {
-	mnemomicFormat() = "SUBN V%4$01X,V%5$01X";
 	registers()[0xf] = (uint8_t)(registers()[x] > registers()[y] ? 0 : 1);
 	registers()[x] = (uint8_t)(registers()[y] - registers()[x]);
 }
@@ -464,20 +604,17 @@ void Chip8::SUBN(int x, int y) {
 void Chip8::SHL(int x, int y) {
 	// https://github.com/Chromatophore/HP48-Superchip#8xy6--8xye
 	// Bit shifts X register by 1, VIP: shifts Y by one and places in X, HP48-SC: ignores Y field, shifts X
-	mnemomicFormat() = "SHL V%4$01X,V%5$01X";
 	registers()[0xf] = (uint8_t)((registers()[y] & 0x80) == 0 ? 0 : 1);
 	registers()[y] <<= 1;
 	registers()[x] = registers()[y];
 }
 
 void Chip8::SNE(int x, int y) {
-	mnemomicFormat() = "SNE V%4$01X,V%5$01X";
 	if (registers()[x] != registers()[y])
 		PC() += 2;
 }
 
 void Chip8::LD_I(int nnn) {
-	mnemomicFormat() = "LD I,%1$03X";
 	indirector() = (uint16_t)nnn;
 }
 
@@ -487,29 +624,24 @@ void Chip8::JP_V0(int, int nnn) {
 	//  VIP: correctly jumps based on v0
 	//  HP48 -SC: reads highest nibble of address to select
 	//      register to apply to address (high nibble pulls double duty)
-	mnemomicFormat() = "JP V0,%1$03X";
 	PC() = (uint16_t)(registers()[0] + nnn);
 }
 
 void Chip8::RND(int x, int nn) {
-	mnemomicFormat() = "RND V%4$01X,%2$02X";
-	auto random = m_eightBitDistribution(m_randomNumberGenerator);
+	auto random = m_randomNumberGenerator.nextByte();
 	registers()[x] = (uint8_t)(random & nn);
 }
 
 void Chip8::DRW(int x, int y, int n) {
-	mnemomicFormat() = "DRW V%4$01X,V%5$01X,%3$01X";
 	draw(x, y, 8, n);
 }
 
 void Chip8::SKP(int x) {
-	mnemomicFormat() = "SKP V%4$01X";
 	if (keyboard().isKeyPressed(registers()[x]))
 		PC() += 2;
 }
 
 void Chip8::SKNP(int x) {
-	mnemomicFormat() = "SKNP V%4$01X";
 	if (!keyboard().isKeyPressed(registers()[x]))
 		PC() += 2;
 }
@@ -517,21 +649,18 @@ void Chip8::SKNP(int x) {
 void Chip8::LD_Vx_II(int x) {
 	// https://github.com/Chromatophore/HP48-Superchip#fx55--fx65
 	// Saves/Loads registers up to X at I pointer - VIP: increases I, HP48-SC: I remains static
-	mnemomicFormat() = "LD V%4$01X,[I]";
-	std::copy_n(memory().bus().cbegin() + indirector(), x + 1, registers().begin());
+	memory().get(indirector(), registers().data(), x + 1);
 	indirector() += x + 1;
 }
 
 void Chip8::LD_II_Vx(int x) {
 	// https://github.com/Chromatophore/HP48-Superchip#fx55--fx65
 	// Saves/Loads registers up to X at I pointer - VIP: increases I, HP48-SC: I remains static
-	mnemomicFormat() = "LD [I],V%4$01X";
-	std::copy_n(registers().cbegin(), x + 1, memory().bus().begin() + indirector());
+	memory().set(indirector(), registers().data(), x + 1);
 	indirector() += x + 1;
 }
 
 void Chip8::LD_B_Vx(int x) {
-	mnemomicFormat() = "LD B,V%4$01X";
 	auto content = registers()[x];
 	memory().set(indirector(),     (uint8_t)(content / 100));
 	memory().set(indirector() + 1, (uint8_t)((content / 10) % 10));
@@ -539,7 +668,6 @@ void Chip8::LD_B_Vx(int x) {
 }
 
 void Chip8::LD_F_Vx(int x) {
-	mnemomicFormat() = "LD F,V%4$01X";
 	indirector() = (uint16_t)(StandardFontOffset + (StandardFontSize * registers()[x]));
 }
 
@@ -547,7 +675,6 @@ void Chip8::ADD_I_Vx(int x) {
 	// From wikipedia entry on CHIP-8:
 	// VF is set to 1 when there is a range overflow (I+VX>0xFFF), and to 0
 	// when there isn't. This is an undocumented feature of the CHIP-8 and used by the Spacefight 2091! game
-	mnemomicFormat() = "ADD I,V%4$01X";
 	auto sum = indirector() + registers()[x];
 	auto masked = sum & 0xFFF;
 	registers()[0xf] = sum == masked ? 0 : 1;
@@ -555,23 +682,19 @@ void Chip8::ADD_I_Vx(int x) {
 }
 
 void Chip8::LD_ST_Vx(int x) {
-	mnemomicFormat() = "LD ST,V%4$01X";
 	soundTimer() = registers()[x];
 }
 
 void Chip8::LD_DT_Vx(int x) {
-	mnemomicFormat() = "LD DT,V%4$01X";
 	delayTimer() = registers()[x];
 }
 
 void Chip8::LD_Vx_K(int x) {
-	mnemomicFormat() = "LD V%4$01X,K";
 	setWaitingForKeyPress();
 	setWaitingForKeyPressRegister(x);
 }
 
 void Chip8::LD_Vx_DT(int x) {
-	mnemomicFormat() = "LD V%4$01X,DT";
 	registers()[x] = delayTimer();
 }
 
@@ -2,16 +2,23 @@
 
 #include <array>
 #include <cstdint>
-#include <random>
 #include <string>
+#include <vector>
 
+#include "BasicBlock.h"
 #include "BitmappedGraphics.h"
+#include "BlockTable.h"
 #include "Configuration.h"
 #include "EventArgs.h"
+#include "Instruction.h"
 #include "InstructionEventArgs.h"
 #include "KeyboardDevice.h"
 #include "Memory.h"
+#include "RandomNumberGenerator.h"
 #include "Signal.h"
+#include "Snapshot.h"
+
+class Profiler;
 
 class Chip8 {
 public:
@@ -32,12 +39,33 @@ public:
 
 	virtual void initialise();
 
+	// A copy of the machine as it stands, with no listeners connected
+	virtual Chip8* clone() const;
+
+	// Snapshots hold the whole running state, but not the configuration: they
+	// only make sense restored into a machine built the same way.
+	virtual void saveSnapshot(Snapshot& snapshot) const;
+	virtual void loadSnapshot(const Snapshot& snapshot);
+
 	void loadGame(const std::string& game);
 
 	void step();
 
+	// Runs at most "limit" instructions as a translated block, returning the number executed
+	int runBlock(int limit);
+
+	// Runs a frame's worth of instructions, returning the number executed.  The frame
+	// ends early if the program finishes or, in low resolution, the display needs drawing.
+	int runFrame();
+
 	void updateTimers();
 
+	// Replaces the seed chosen by initialise(), making RND repeatable
+	void seedRandomNumbers(uint32_t seed);
+
+	// What RND was last seeded with
+	uint32_t getRandomSeed() const { return m_randomSeed; }
+
 	uint16_t PC() const { return m_pc; }
 	uint16_t& PC() { return m_pc; }
 	
@@ -82,10 +110,17 @@ public:
 	bool getFinished() const { return m_finished; }
 	void setFinished(bool value = true) { m_finished = value; }
 
-	const std::string& mnemomicFormat() const { return m_mnemomicFormat; }
-	std::string& mnemomicFormat() { return m_mnemomicFormat; }
+	// Counts into the profiler from here on (null stops counting).  Only
+	// does anything if libchip8 was built with CHIP8_PROFILING.
+	Profiler* profiler() const { return m_profiler; }
+	void setProfiler(Profiler* value) { m_profiler = value; }
 
 protected:
+	Chip8(const Chip8& rhs) = default;
+
+	// Drops every listener, e.g. from a clone
+	virtual void disconnect();
+
 	void onBeepStarting();
 	void onBeepStopped();
 
@@ -94,60 +129,64 @@ protected:
 
 	virtual void emulateCycle();
 
-	virtual void draw(int x, int y, int width, int height);
-
-	virtual bool emulateInstruction(int nnn, int nn, int n, int x, int y);
-	virtual bool emulateInstructions_F(int nnn, int nn, int n, int x, int y);
-	virtual bool emulateInstructions_E(int nnn, int nn, int n, int x, int y);
-	virtual bool emulateInstructions_D(int nnn, int nn, int n, int x, int y);
-	virtual bool emulateInstructions_C(int nnn, int nn, int n, int x, int y);
-	virtual bool emulateInstructions_B(int nnn, int nn, int n, int x, int y);
-	virtual bool emulateInstructions_A(int nnn, int nn, int n, int x, int y);
-	virtual bool emulateInstructions_9(int nnn, int nn, int n, int x, int y);
-	virtual bool emulateInstructions_8(int nnn, int nn, int n, int x, int y);
-	virtual bool emulateInstructions_7(int nnn, int nn, int n, int x, int y);
-	virtual bool emulateInstructions_6(int nnn, int nn, int n, int x, int y);
-	virtual bool emulateInstructions_5(int nnn, int nn, int n, int x, int y);
-	virtual bool emulateInstructions_4(int nnn, int nn, int n, int x, int y);
-	virtual bool emulateInstructions_3(int nnn, int nn, int n, int x, int y);
-	virtual bool emulateInstructions_2(int nnn, int nn, int n, int x, int y);
-	virtual bool emulateInstructions_1(int nnn, int nn, int n, int x, int y);
-	virtual bool emulateInstructions_0(int nnn, int nn, int n, int x, int y);
-
-	virtual void CLS();
-	virtual void RET();
-	virtual void JP(int nnn);
-	virtual void CALL(int nnn);
-	virtual void SE_REG_IMM(int x, int nn);
-	virtual void SNE_REG_IMM(int x, int nn);
-	virtual void SE(int x, int y);
-	virtual void LD_REG_IMM(int x, int nn);
-	virtual void ADD_REG_IMM(int x, int nn);
-	virtual void LD(int x, int y);
-	virtual void OR(int x, int y);
-	virtual void AND(int x, int y);
-	virtual void XOR(int x, int y);
-	virtual void ADD(int x, int y);
-	virtual void SUB(int x, int y);
-	virtual void SHR(int x, int y);
-	virtual void SUBN(int x, int y);
-	virtual void SHL(int x, int y);
-	virtual void SNE(int x, int y);
-	virtual void LD_I(int nnn);
-	virtual void JP_V0(int x, int nnn);
-	virtual void RND(int x, int nn);
-	virtual void DRW(int x, int y, int n);
-	virtual void SKP(int x);
-	virtual void SKNP(int x);
-	virtual void LD_Vx_II(int x);
-	virtual void LD_II_Vx(int x);
-	virtual void LD_B_Vx(int x);
-	virtual void LD_F_Vx(int x);
-	virtual void ADD_I_Vx(int x);
-	virtual void LD_ST_Vx(int x);
-	virtual void LD_DT_Vx(int x);
-	virtual void LD_Vx_K(int x);
-	virtual void LD_Vx_DT(int x);
+	bool finishedCycling(int cycles) const;
+
+	void draw(int x, int y, int width, int height);
+
+	virtual bool decodeInstruction(Instruction& instruction);
+	virtual bool decodeInstructions_F(Instruction& instruction);
+	virtual bool decodeInstructions_E(Instruction& instruction);
+	virtual bool decodeInstructions_D(Instruction& instruction);
+	virtual bool decodeInstructions_C(Instruction& instruction);
+	virtual bool decodeInstructions_B(Instruction& instruction);
+	virtual bool decodeInstructions_A(Instruction& instruction);
+	virtual bool decodeInstructions_9(Instruction& instruction);
+	virtual bool decodeInstructions_8(Instruction& instruction);
+	virtual bool decodeInstructions_7(Instruction& instruction);
+	virtual bool decodeInstructions_6(Instruction& instruction);
+	virtual bool decodeInstructions_5(Instruction& instruction);
+	virtual bool decodeInstructions_4(Instruction& instruction);
+	virtual bool decodeInstructions_3(Instruction& instruction);
+	virtual bool decodeInstructions_2(Instruction& instruction);
+	virtual bool decodeInstructions_1(Instruction& instruction);
+	virtual bool decodeInstructions_0(Instruction& instruction);
+
+	// Opcode implementations are bound to predecoded instructions by the decoders,
+	// so processor and quirk variants are chosen once, when an instruction is decoded.
+	void CLS();
+	void RET();
+	void JP(int nnn);
+	void CALL(int nnn);
+	void SE_REG_IMM(int x, int nn);
+	void SNE_REG_IMM(int x, int nn);
+	void SE(int x, int y);
+	void LD_REG_IMM(int x, int nn);
+	void ADD_REG_IMM(int x, int nn);
+	void LD(int x, int y);
+	void OR(int x, int y);
+	void AND(int x, int y);
+	void XOR(int x, int y);
+	void ADD(int x, int y);
+	void SUB(int x, int y);
+	void SHR(int x, int y);
+	void SUBN(int x, int y);
+	void SHL(int x, int y);
+	void SNE(int x, int y);
+	void LD_I(int nnn);
+	void JP_V0(int x, int nnn);
+	void RND(int x, int nn);
+	void DRW(int x, int y, int n);
+	void SKP(int x);
+	void SKNP(int x);
+	void LD_Vx_II(int x);
+	void LD_II_Vx(int x);
+	void LD_B_Vx(int x);
+	void LD_F_Vx(int x);
+	void ADD_I_Vx(int x);
+	void LD_ST_Vx(int x);
+	void LD_DT_Vx(int x);
+	void LD_Vx_K(int x);
+	void LD_Vx_DT(int x);
 
 private:
 	friend class cereal::access;
@@ -160,7 +199,6 @@ private:
 			m_i,
 			m_pc,
 			m_finished,
-			m_mnemomicFormat,
 			m_keyboard,
 			m_configuration,
 			m_stack,
@@ -183,8 +221,6 @@ private:
 
 	bool m_finished = false;
 
-	std::string m_mnemomicFormat;
-
 	std::array<uint8_t, 5 * 16> m_standardFont = { {
 		0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
 		0x20, 0x60, 0x20, 0x20, 0x70, // 1
@@ -220,8 +256,17 @@ private:
 	bool m_waitingForKeyPress = false;
 	int m_waitingForKeyPressRegister = -1;
 
-	std::mt19937 m_randomNumberGenerator;
-	std::uniform_int_distribution<std::mt19937::result_type> m_eightBitDistribution;
+	RandomNumberGenerator m_randomNumberGenerator;
+	uint32_t m_randomSeed = 0;
+
+	Profiler* m_profiler = nullptr;
+
+	Instruction m_misalignedInstruction;
+	BlockTable m_blocks;
+
+	const Instruction& fetchInstruction(uint16_t address);
+	void translateBlock(uint16_t address, BasicBlock& block);
+	void executeInstruction(uint16_t programCounter, const Instruction& instruction);
 
 	void waitForKeyPress();
 
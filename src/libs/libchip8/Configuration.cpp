@@ -30,9 +30,11 @@ void Configuration::read(std::string path) {
 	m_type = GetProcessorTypeValue(reader, "Processor.Type", m_type);
 
 	m_allowMisalignedOpcodes = reader.GetBooleanValue("Processor.AllowMisalignedOpcodes", m_allowMisalignedOpcodes);
+	m_translateBlocks = reader.GetBooleanValue("Processor.TranslateBlocks", m_translateBlocks);
 	m_startAddress = reader.GetUShortValue("Processor.LoadAddress", m_startAddress);
 	m_loadAddress = reader.GetUShortValue("Processor.LoadAddress", m_loadAddress);
 	m_memorySize = reader.GetIntValue("Processor.MemorySize", m_memorySize);
+	m_randomSeed = (uint32_t)reader.GetIntValue("Processor.RandomSeed", (int)m_randomSeed);
 
 	m_vsyncLocked = reader.GetBooleanValue("Graphics.VsyncLocked", m_vsyncLocked);
 	m_framesPerSecond = reader.GetIntValue("Graphics.FramesPerSecond", m_framesPerSecond);
@@ -41,6 +43,8 @@ void Configuration::read(std::string path) {
 	m_graphicsClip = reader.GetBooleanValue("Graphics.Clip", m_graphicsClip);
 	m_graphicsCountExceededRows = reader.GetBooleanValue("Graphics.CountExceededRows", m_graphicsCountExceededRows);
 	m_graphicsCountRowHits = reader.GetBooleanValue("Graphics.CountRowHits", m_graphicsCountRowHits);
+
+	m_rewindSeconds = reader.GetIntValue("Rewind.Seconds", m_rewindSeconds);
 }
 
 ProcessorLevel Configuration::GetProcessorTypeValue(const ConfigurationReader& reader, const std::string& path, ProcessorLevel defaultValue) const {
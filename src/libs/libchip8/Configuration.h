@@ -43,6 +43,14 @@ public:
 		m_allowMisalignedOpcodes = value;
 	}
 
+	bool getTranslateBlocks() const {
+		return m_translateBlocks;
+	}
+
+	void setTranslateBlocks(bool value) {
+		m_translateBlocks = value;
+	}
+
 	bool getVsyncLocked() const {
 		return m_vsyncLocked;
 	}
@@ -59,6 +67,24 @@ public:
 		m_framesPerSecond = value;
 	}
 
+	// Zero leaves each machine to choose its own
+	uint32_t getRandomSeed() const {
+		return m_randomSeed;
+	}
+
+	void setRandomSeed(uint32_t value) {
+		m_randomSeed = value;
+	}
+
+	// How far back the front end can rewind; zero turns recording off
+	int getRewindSeconds() const {
+		return m_rewindSeconds;
+	}
+
+	void setRewindSeconds(int value) {
+		m_rewindSeconds = value;
+	}
+
 	// https://github.com/Chromatophore/HP48-Superchip#platform-speed
 	// The HP48 calculator is much faster than the Cosmac VIP, but,
 	// there is still no solid understanding of how much faster it is for
@@ -170,6 +196,7 @@ private:
 			m_debugMode,
 			m_type,
 			m_allowMisalignedOpcodes,
+			m_translateBlocks,
 			m_vsyncLocked,
 			m_framesPerSecond,
 			m_cyclesPerFrame,
@@ -182,7 +209,9 @@ private:
 			m_graphicsCountRowHits,
 			m_chip8Shifts,
 			m_chip8LoadAndSave,
-			m_chip8IndexedJumps
+			m_chip8IndexedJumps,
+			m_rewindSeconds,
+			m_randomSeed
 		);
 	}
 
@@ -190,8 +219,11 @@ private:
 
 	ProcessorLevel m_type = chip8;
 	bool m_allowMisalignedOpcodes = false;
+	bool m_translateBlocks = false;
 	bool m_vsyncLocked = true;
 	int m_framesPerSecond = 60;
+	int m_rewindSeconds = 60 * 60;
+	uint32_t m_randomSeed = 0;
 	int m_cyclesPerFrame = 13;
 	uint16_t m_startAddress = 0x200;
 	uint16_t m_loadAddress = 0x200;
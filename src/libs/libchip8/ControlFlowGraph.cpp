@@ -0,0 +1,467 @@
+#include "stdafx.h"
+#include "ControlFlowGraph.h"
+
+#include <cstdlib>
+
+#include "Chip8.h"
+#include "Disassembler.h"
+
+namespace {
+
+	// How an instruction passes control on
+	enum Flow {
+		Straight,
+		Jumps,
+		Calls,
+		Skips,
+		Returns,
+		Stops,	// Super-Chip's EXIT
+		Indexed,	// BNNN
+		Undefined
+	};
+
+	struct Decoded {
+		uint16_t opcode;
+		int length;
+		Flow flow;
+	};
+
+	Decoded decode(const Chip8& processor, const int address) {
+		Decoded decoded;
+		decoded.opcode = processor.memory().getWord(address);
+		decoded.length = 2;
+		decoded.flow = Straight;
+
+		if (Disassembler::getMnemomicFormat(decoded.opcode, processor) == nullptr) {
+			decoded.flow = Undefined;
+			return decoded;
+		}
+
+		switch (decoded.opcode & 0xf000) {
+		case 0x0000:
+			if (decoded.opcode == 0x00ee)
+				decoded.flow = Returns;
+			else if (decoded.opcode == 0x00fd)
+				decoded.flow = Stops;
+			break;
+		case 0x1000:
+			decoded.flow = Jumps;
+			break;
+		case 0x2000:
+			decoded.flow = Calls;
+			break;
+		case 0x3000:
+		case 0x4000:
+		case 0x9000:
+		case 0xe000:
+			decoded.flow = Skips;
+			break;
+		case 0x5000:
+			if ((decoded.opcode & 0xf) == 0)
+				decoded.flow = Skips;
+			break;
+		case 0xb000:
+			decoded.flow = Indexed;
+			break;
+		case 0xf000:
+			if (decoded.opcode == 0xf000)
+				decoded.length = 4;	// XO-Chip's long I load
+			break;
+		}
+		return decoded;
+	}
+
+	// Registers and I where a block has set them to constants, otherwise -1
+	class Constants final {
+	public:
+		Constants() {
+			m_v.fill(-1);
+		}
+
+		int v(const int x) const {
+			return m_v[x];
+		}
+
+		int i() const {
+			return m_i;
+		}
+
+		// Returns the number of bytes the instruction writes through I, if any
+		int execute(const uint16_t opcode, const uint16_t following) {
+			const auto x = (opcode & 0xf00) >> 8;
+			const auto y = (opcode & 0xf0) >> 4;
+			const auto n = opcode & 0xf;
+			const auto nn = opcode & 0xff;
+			auto stored = 0;
+			switch (opcode & 0xf000) {
+			case 0x5000:
+				if (n == 2)
+					stored = std::abs(x - y) + 1;	// SAVE VX-VY
+				else if (n == 3)
+					forget(std::min(x, y), std::max(x, y));	// LOAD VX-VY
+				break;
+			case 0x6000:
+				m_v[x] = nn;
+				break;
+			case 0x7000:
+				if (m_v[x] >= 0)
+					m_v[x] = (m_v[x] + nn) & 0xff;
+				break;
+			case 0x8000:
+				if (n == 0) {
+					m_v[x] = m_v[y];
+				} else {
+					m_v[x] = -1;
+					m_v[0xf] = -1;
+				}
+				break;
+			case 0xa000:
+				m_i = opcode & 0xfff;
+				break;
+			case 0xc000:
+				m_v[x] = -1;
+				break;
+			case 0xd000:
+				m_v[0xf] = -1;
+				break;
+			case 0xf000:
+				if (opcode == 0xf000) {
+					m_i = following;
+					break;
+				}
+				switch (nn) {
+				case 0x07:
+				case 0x0a:
+					m_v[x] = -1;
+					break;
+				case 0x1e:
+					m_i = (m_i >= 0) && (m_v[x] >= 0) ? (m_i + m_v[x]) & 0xffff : -1;
+					break;
+				case 0x29:
+				case 0x30:
+					m_i = -1;
+					break;
+				case 0x33:
+					stored = 3;
+					break;
+				case 0x55:
+					stored = x + 1;
+					break;
+				case 0x65:
+				case 0x85:
+					forget(0, x);
+					break;
+				}
+				break;
+			}
+			return stored;
+		}
+
+		// Loads and saves may move I on, depending on the quirks in force
+		void afterLoadOrSave(const uint16_t opcode) {
+			if (((opcode & 0xf0ff) == 0xf055) || ((opcode & 0xf0ff) == 0xf065))
+				m_i = -1;
+		}
+
+	private:
+		std::array<int, 16> m_v;
+		int m_i = -1;
+
+		void forget(const int first, const int last) {
+			for (auto x = first; x <= last; ++x)
+				m_v[x] = -1;
+		}
+	};
+}
+
+ControlFlowGraph::ControlFlowGraph(const Chip8& processor)
+: m_processor(processor),
+  m_startAddress(processor.configuration().getStartAddress()),
+  m_flags(processor.memory().size()) {
+
+	// Resolving a jump table can reveal more code, and more code can
+	// split blocks, so blocks are rebuilt until nothing new turns up.
+	addLeader(m_startAddress);
+	for (;;) {
+		while (!m_pending.empty()) {
+			const auto leader = m_pending.back();
+			m_pending.pop_back();
+			walk(leader);
+		}
+		buildBlocks();
+		auto found = false;
+		for (auto& entry : m_blocks)
+			found = analyseBlock(entry.second) || found;
+		if (!found)
+			break;
+	}
+
+	matchReturns();
+	linkPredecessors();
+	checkStores();
+}
+
+bool ControlFlowGraph::addLeader(const int address) {
+	if (!inMemory(address) || ((m_flags[address] & LeaderFlag) != 0))
+		return false;
+	m_flags[address] |= LeaderFlag;
+	m_pending.push_back((uint16_t)address);
+	return true;
+}
+
+// Marks the instructions from a leader until control leaves the run,
+// queueing wherever it goes.  Runs that can't be decoded are left unmarked.
+void ControlFlowGraph::walk(const uint16_t leader) {
+	const auto misalignable = m_processor.configuration().getAllowMisalignedOpcodes();
+	for (int address = leader; ; ) {
+		if (!inMemory(address + 1) || (((address % 2) == 1) && !misalignable) || isInstruction(address))
+			return;
+		const auto decoded = decode(m_processor, address);
+		if (!inMemory(address + decoded.length - 1))
+			return;
+
+		m_flags[address] |= InstructionFlag;
+		for (auto byte = 0; byte < decoded.length; ++byte)
+			m_flags[address + byte] |= CodeFlag;
+
+		const auto next = address + decoded.length;
+		switch (decoded.flow) {
+		case Straight:
+			address = next;
+			break;
+		case Jumps:
+			addLeader(decoded.opcode & 0xfff);
+			return;
+		case Calls:
+			addLeader(decoded.opcode & 0xfff);
+			addLeader(next);
+			return;
+		case Skips:
+			addLeader(next);
+			addLeader(address + 4);
+			return;
+		default:
+			return;	// BNNN is resolved once its block is known
+		}
+	}
+}
+
+void ControlFlowGraph::buildBlocks() {
+	const auto misalignable = m_processor.configuration().getAllowMisalignedOpcodes();
+	m_blocks.clear();
+	m_stores.clear();
+	for (int leader = 0; leader < (int)m_flags.size(); ++leader) {
+		if ((m_flags[leader] & LeaderFlag) == 0)
+			continue;
+
+		Block block;
+		block.start = block.end = (uint16_t)leader;
+		for (int address = leader; ; ) {
+			if (!isInstruction(address)) {
+				block.ending = ((address % 2) == 1) && !misalignable ? Invalid : Truncated;
+				break;
+			}
+			block.instructions.push_back((uint16_t)address);
+			const auto decoded = decode(m_processor, address);
+			const auto next = address + decoded.length;
+			block.end = next;
+			block.ending = Transfers;
+			if (decoded.flow == Straight) {
+				if (inMemory(next) && ((m_flags[next] & LeaderFlag) != 0)) {
+					block.ending = Falls;
+					block.successors.push_back({ (uint16_t)next, Next });
+					break;
+				}
+				address = next;
+				continue;
+			}
+			switch (decoded.flow) {
+			case Jumps:
+				block.successors.push_back({ (uint16_t)(decoded.opcode & 0xfff), Jump });
+				break;
+			case Calls:
+				block.successors.push_back({ (uint16_t)(decoded.opcode & 0xfff), Call });
+				block.successors.push_back({ (uint16_t)next, Resume });
+				break;
+			case Skips:
+				block.successors.push_back({ (uint16_t)next, Next });
+				block.successors.push_back({ (uint16_t)(address + 4), Skip });
+				break;
+			case Stops:
+				block.ending = Exits;
+				break;
+			case Indexed:
+				block.ending = Unresolved;
+				break;
+			case Undefined:
+				block.ending = Invalid;
+				break;
+			default:
+				break;	// RETs are matched to their calls once every block is known
+			}
+			break;
+		}
+		m_blocks[block.start] = block;
+	}
+}
+
+// Follows the constants set through the block, noting its stores and
+// working out where a BNNN at its end can go.  Returns true if that
+// turned up somewhere new.
+bool ControlFlowGraph::analyseBlock(Block& block) {
+	const auto& memory = m_processor.memory();
+	Constants constants;
+	for (const auto address : block.instructions) {
+		const auto opcode = memory.getWord(address);
+		const auto following = inMemory(address + 3) ? memory.getWord(address + 2) : 0;
+		const auto stored = constants.execute(opcode, following);
+		if (stored > 0) {
+			Store store;
+			store.address = address;
+			store.known = constants.i() >= 0;
+			store.target = store.known ? (uint16_t)constants.i() : 0;
+			store.length = (uint16_t)stored;
+			m_stores.push_back(store);
+		}
+		constants.afterLoadOrSave(opcode);
+	}
+
+	if (block.ending != Unresolved)
+		return false;
+
+	// As Chip8::JP_V0 or, with HP48 indexed jumps, Schip::JP_V0
+	const auto& configuration = m_processor.configuration();
+	const auto opcode = memory.getWord(block.instructions.back());
+	const auto nnn = opcode & 0xfff;
+	const auto index = (configuration.getType() >= superChip) && !configuration.getChip8IndexedJumps() ? (opcode & 0xf00) >> 8 : 0;
+
+	std::vector<int> targets;
+	if (constants.v(index) >= 0) {
+		targets.push_back(nnn + constants.v(index));
+	} else {
+		for (auto entry = nnn; (targets.size() < (size_t)MaximumTableLength) && inMemory(entry + 1); entry += 2) {
+			if ((memory.getWord(entry) & 0xf000) != 0x1000)
+				break;
+			targets.push_back(entry);
+		}
+	}
+	if (targets.empty())
+		return false;
+
+	auto found = false;
+	block.ending = Transfers;
+	for (const auto target : targets) {
+		block.successors.push_back({ (uint16_t)target, Table });
+		found = addLeader(target) || found;
+	}
+	return found;
+}
+
+// A RET returns to after every CALL of each subroutine it can be reached
+// in, without passing through another RET
+void ControlFlowGraph::matchReturns() {
+	const auto& memory = m_processor.memory();
+
+	for (const auto& entry : m_blocks) {
+		const auto& block = entry.second;
+		for (const auto& edge : block.successors) {
+			if (edge.kind == Call)
+				m_subroutines[edge.target].calls.push_back(block.instructions.back());
+		}
+	}
+
+	for (auto& entry : m_subroutines) {
+		auto& subroutine = entry.second;
+		std::vector<uint16_t> pending = { entry.first };
+		std::vector<bool> seen(m_flags.size());
+		while (!pending.empty()) {
+			const auto start = pending.back();
+			pending.pop_back();
+			const auto found = m_blocks.find(start);
+			if (seen[start] || (found == m_blocks.end()))
+				continue;
+			seen[start] = true;
+
+			auto& block = found->second;
+			if (block.instructions.empty())
+				continue;
+			const auto last = block.instructions.back();
+			if (memory.getWord(last) == 0x00ee) {
+				subroutine.returns.push_back(last);
+				for (const auto call : subroutine.calls)
+					block.successors.push_back({ (uint16_t)(call + 2), Return });
+				continue;
+			}
+			for (const auto& edge : block.successors) {
+				if ((edge.kind != Call) && (edge.kind != Return))
+					pending.push_back(edge.target);
+			}
+		}
+		std::sort(subroutine.returns.begin(), subroutine.returns.end());
+	}
+
+	// A RET shared by subroutines called from the same place needs only one edge back
+	for (auto& entry : m_blocks) {
+		auto& successors = entry.second.successors;
+		for (auto edge = successors.begin(); edge != successors.end(); ) {
+			const auto duplicate = std::find_if(successors.begin(), edge, [&](const Edge& earlier) {
+				return (earlier.target == edge->target) && (earlier.kind == edge->kind);
+			});
+			edge = duplicate == edge ? edge + 1 : successors.erase(edge);
+		}
+	}
+}
+
+void ControlFlowGraph::linkPredecessors() {
+	for (const auto& entry : m_blocks) {
+		for (const auto& edge : entry.second.successors) {
+			const auto target = m_blocks.find(edge.target);
+			if (target == m_blocks.end())
+				continue;
+			auto& predecessors = target->second.predecessors;
+			if (std::find(predecessors.begin(), predecessors.end(), entry.first) == predecessors.end())
+				predecessors.push_back(entry.first);
+		}
+	}
+}
+
+void ControlFlowGraph::checkStores() {
+	for (auto& store : m_stores) {
+		for (int address = store.target; store.known && !store.writesCode && (address < store.target + store.length); ++address)
+			store.writesCode = isCode(address);
+	}
+}
+
+int ControlFlowGraph::getInstructionCount() const {
+	return (int)std::count_if(m_flags.begin(), m_flags.end(), [](uint8_t flags) { return (flags & InstructionFlag) != 0; });
+}
+
+int ControlFlowGraph::getCodeBytes() const {
+	return (int)std::count_if(m_flags.begin(), m_flags.end(), [](uint8_t flags) { return (flags & CodeFlag) != 0; });
+}
+
+ControlFlowGraph::SelfModification ControlFlowGraph::getSelfModification() const {
+	auto modification = No;
+	for (const auto& store : m_stores) {
+		if (store.writesCode)
+			return Yes;
+		if (!store.known)
+			modification = Possibly;
+	}
+	return modification;
+}
+
+const char* ControlFlowGraph::getName(const EdgeKind kind) {
+	static const char* const Names[] = { "next", "skip", "jump", "call", "resume", "return", "table" };
+	return Names[kind];
+}
+
+const char* ControlFlowGraph::getName(const Ending ending) {
+	static const char* const Names[] = { "falls", "transfers", "exits", "unresolved", "invalid", "truncated" };
+	return Names[ending];
+}
+
+const char* ControlFlowGraph::getName(const SelfModification modification) {
+	static const char* const Names[] = { "no", "possibly", "yes" };
+	return Names[modification];
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+class Chip8;
+
+// A ROM's code as it can be found without running it: the instructions
+// reachable from the start address, split into basic blocks and joined by the
+// ways control passes between them.  A BNNN jump is followed where its
+// register was loaded with a constant earlier in the block, or where NNN is
+// the start of a table of jumps.
+//
+// Control flow follows the processor's own rules (a skip always steps over two
+// bytes, XO-Chip's long I load is four bytes long, and the configuration
+// chooses which register BNNN adds), so the blocks are those the processor
+// would run through.
+class ControlFlowGraph final {
+public:
+	enum EdgeKind {
+		Next,		// Straight on, including a skip not taken
+		Skip,		// A skip taken
+		Jump,
+		Call,
+		Resume,		// From a CALL to the instruction after it, for when the subroutine returns
+		Return,		// From a RET to the instruction after each CALL of its subroutine
+		Table		// From a BNNN to a target it can reach
+	};
+
+	enum Ending {
+		Falls,		// Runs on into a block that is entered from elsewhere too
+		Transfers,	// Jumps, skips, calls or returns: see the edges
+		Exits,		// Super-Chip's EXIT
+		Unresolved,	// A BNNN whose targets can't be worked out
+		Invalid,	// An instruction the processor doesn't have, or one on an odd address
+		Truncated	// Runs off the end of memory
+	};
+
+	struct Edge {
+		uint16_t target;
+		EdgeKind kind;
+	};
+
+	struct Block {
+		uint16_t start = 0;
+		int end = 0;	// Just past the last instruction
+		std::vector<uint16_t> instructions;
+		std::vector<Edge> successors;
+		std::vector<uint16_t> predecessors;	// Starts of the blocks with edges here
+		Ending ending = Falls;
+	};
+
+	struct Subroutine {
+		std::vector<uint16_t> calls;	// Addresses of the CALLs to it
+		std::vector<uint16_t> returns;	// Addresses of the RETs reachable from its entry
+	};
+
+	// A write to memory through I: LD B, LD [I] or XO-Chip's SAVE
+	struct Store {
+		uint16_t address = 0;	// Of the instruction
+		bool known = false;		// Whether I is known at that point
+		uint16_t target = 0;
+		uint16_t length = 0;
+		bool writesCode = false;
+	};
+
+	enum SelfModification {
+		No,
+		Possibly,	// Some stores go where I can't be worked out
+		Yes
+	};
+
+	// From a processor with its ROM loaded, as it stands before running
+	explicit ControlFlowGraph(const Chip8& processor);
+
+	uint16_t getStartAddress() const {
+		return m_startAddress;
+	}
+
+	// Keyed by start address
+	const std::map<uint16_t, Block>& blocks() const {
+		return m_blocks;
+	}
+
+	// Keyed by entry address
+	const std::map<uint16_t, Subroutine>& subroutines() const {
+		return m_subroutines;
+	}
+
+	const std::vector<Store>& stores() const {
+		return m_stores;
+	}
+
+	// Whether an instruction that can be reached starts at the address
+	bool isInstruction(int address) const {
+		return inMemory(address) && ((m_flags[address] & InstructionFlag) != 0);
+	}
+
+	// Whether the address is part of an instruction that can be reached
+	bool isCode(int address) const {
+		return inMemory(address) && ((m_flags[address] & CodeFlag) != 0);
+	}
+
+	int getInstructionCount() const;
+	int getCodeBytes() const;
+	SelfModification getSelfModification() const;
+
+	static const char* getName(EdgeKind kind);
+	static const char* getName(Ending ending);
+	static const char* getName(SelfModification modification);
+
+private:
+	enum {
+		InstructionFlag = 0x1,
+		CodeFlag = 0x2,
+		LeaderFlag = 0x4,
+
+		MaximumTableLength = 64
+	};
+
+	const Chip8& m_processor;
+	uint16_t m_startAddress;
+	std::vector<uint8_t> m_flags;	// Per address
+	std::vector<uint16_t> m_pending;	// Leaders still to be walked from
+
+	std::map<uint16_t, Block> m_blocks;
+	std::map<uint16_t, Subroutine> m_subroutines;
+	std::vector<Store> m_stores;
+
+	bool inMemory(int address) const {
+		return (address >= 0) && (address < (int)m_flags.size());
+	}
+
+	bool addLeader(int address);
+	void walk(uint16_t address);
+	void buildBlocks();
+	bool analyseBlock(Block& block);
+	void matchReturns();
+	void linkPredecessors();
+	void checkStores();
+};
@@ -1,73 +1,300 @@
 #include "stdafx.h"
 
-#include <sstream>
+#include <cctype>
+#include <cstring>
 
 #include "Disassembler.h"
 #include "InstructionEventArgs.h"
-#include "Memory.h"
+#include "Instruction.h"
 #include "Chip8.h"
+#include "Configuration.h"
+#include "Schip.h"
+#include "Trace.h"
 
-Disassembler::Disassembler() {
-	// Disable exceptions where too many format arguments are available
-	m_formatter.exceptions(boost::io::all_error_bits ^ boost::io::too_many_args_bit);
+namespace {
+
+	struct Mnemomic {
+		uint16_t mask;
+		uint16_t match;
+		ProcessorLevel level;
+		bool (*applies)(const Configuration& configuration, bool compatibility);
+		const char* format;
+	};
+
+	bool always(const Configuration&, bool) {
+		return true;
+	}
+
+	bool hp48Shifts(const Configuration& configuration, bool) {
+		return !configuration.getChip8Shifts();
+	}
+
+	bool hp48IndexedJumps(const Configuration& configuration, bool) {
+		return !configuration.getChip8IndexedJumps();
+	}
+
+	bool hp48LoadAndSave(const Configuration&, bool compatibility) {
+		return !compatibility;
+	}
+
+	// Searched in order, so extended instructions come before those they replace.
+	// This mirrors the processors' decodeInstructions_N methods.
+	const Mnemomic Mnemomics[] = {
+
+		{ 0xf0f0, 0x00d0, xoChip, always, "(X) SCUP %3$01X" },
+		{ 0xf00f, 0x5002, xoChip, always, "(X) SAVE V%4$01X-V%5$01X" },
+		{ 0xf00f, 0x5003, xoChip, always, "(X) LOAD V%4$01X-V%5$01X" },
+		{ 0xffff, 0xf000, xoChip, always, "(X) LD I,%6$04X" },
+		{ 0xffff, 0xf002, xoChip, always, "(X) AUDIO" },
+		{ 0xf0ff, 0xf001, xoChip, always, "(X) PLANE %3$01X" },
+
+		{ 0xf0ff, 0x00fa, superChip, always, "(S) COMPATIBILITY" },
+		{ 0xf0ff, 0x00fb, superChip, always, "(S) SCRIGHT" },
+		{ 0xf0ff, 0x00fc, superChip, always, "(S) SCLEFT" },
+		{ 0xf0ff, 0x00fd, superChip, always, "(S) EXIT" },
+		{ 0xf0ff, 0x00fe, superChip, always, "(S) LOW" },
+		{ 0xf0ff, 0x00ff, superChip, always, "(S) HIGH" },
+		{ 0xf0f0, 0x00c0, superChip, always, "(S) SCDOWN %3$01X" },
+		{ 0xf00f, 0x8006, superChip, hp48Shifts, "(S) SHR V%4$01X" },
+		{ 0xf00f, 0x800e, superChip, hp48Shifts, "(S) SHL V%4$01X" },
+		{ 0xf000, 0xb000, superChip, hp48IndexedJumps, "(S) JP V%4$01X,%1$03X" },
+		{ 0xf00f, 0xd000, superChip, always, "(S) XDRW V%4$01X,V%5$01X" },
+		{ 0xf0ff, 0xf030, superChip, always, "(S) LD HF,V%4$01X" },
+		{ 0xf0ff, 0xf075, superChip, always, "(S) LD R,V%4$01X" },
+		{ 0xf0ff, 0xf085, superChip, always, "(S) LD V%4$01X,R" },
+		{ 0xf0ff, 0xf055, superChip, hp48LoadAndSave, "(S) LD [I],V%4$01X" },
+		{ 0xf0ff, 0xf065, superChip, hp48LoadAndSave, "(S) LD V%4$01X,[I]" },
+
+		{ 0xf0ff, 0x00e0, chip8, always, "CLS" },
+		{ 0xf0ff, 0x00ee, chip8, always, "RET" },
+		{ 0xf000, 0x1000, chip8, always, "JP %1$03X" },
+		{ 0xf000, 0x2000, chip8, always, "CALL %1$03X" },
+		{ 0xf000, 0x3000, chip8, always, "SE V%4$01X,%2$02X" },
+		{ 0xf000, 0x4000, chip8, always, "SNE V%4$01X,%2$02X" },
+		{ 0xf000, 0x5000, chip8, always, "SE V%4$01X,V%5$01X" },
+		{ 0xf000, 0x6000, chip8, always, "LD V%4$01X,%2$02X" },
+		{ 0xf000, 0x7000, chip8, always, "ADD V%4$01X,%2$02X" },
+		{ 0xf00f, 0x8000, chip8, always, "LD V%4$01X,V%5$01X" },
+		{ 0xf00f, 0x8001, chip8, always, "OR V%4$01X,V%5$01X" },
+		{ 0xf00f, 0x8002, chip8, always, "AND V%4$01X,V%5$01X" },
+		{ 0xf00f, 0x8003, chip8, always, "XOR V%4$01X,V%5$01X" },
+		{ 0xf00f, 0x8004, chip8, always, "ADD V%4$01X,V%5$01X" },
+		{ 0xf00f, 0x8005, chip8, always, "SUB V%4$01X,V%5$01X" },
+		{ 0xf00f, 0x8006, chip8, always, "SHR V%4$01X,V%5$01X" },
+		{ 0xf00f, 0x8007, chip8, always, "SUBN V%4$01X,V%5$01X" },
+		{ 0xf00f, 0x800e, chip8, always, "SHL V%4$01X,V%5$01X" },
+		{ 0xf00f, 0x9000, chip8, always, "SNE V%4$01X,V%5$01X" },
+		{ 0xf000, 0xa000, chip8, always, "LD I,%1$03X" },
+		{ 0xf000, 0xb000, chip8, always, "JP V0,%1$03X" },
+		{ 0xf000, 0xc000, chip8, always, "RND V%4$01X,%2$02X" },
+		{ 0xf000, 0xd000, chip8, always, "DRW V%4$01X,V%5$01X,%3$01X" },
+		{ 0xf0ff, 0xe09e, chip8, always, "SKP V%4$01X" },
+		{ 0xf0ff, 0xe0a1, chip8, always, "SKNP V%4$01X" },
+		{ 0xf0ff, 0xf007, chip8, always, "LD V%4$01X,DT" },
+		{ 0xf0ff, 0xf00a, chip8, always, "LD V%4$01X,K" },
+		{ 0xf0ff, 0xf015, chip8, always, "LD DT,V%4$01X" },
+		{ 0xf0ff, 0xf018, chip8, always, "LD ST,V%4$01X" },
+		{ 0xf0ff, 0xf01e, chip8, always, "ADD I,V%4$01X" },
+		{ 0xf0ff, 0xf029, chip8, always, "LD F,V%4$01X" },
+		{ 0xf0ff, 0xf033, chip8, always, "LD B,V%4$01X" },
+		{ 0xf0ff, 0xf055, chip8, always, "LD [I],V%4$01X" },
+		{ 0xf0ff, 0xf065, chip8, always, "LD V%4$01X,[I]" },
+	};
+
+	const size_t MnemomicCount = sizeof(Mnemomics) / sizeof(Mnemomics[0]);
+
+	// A run of text from a format, then the field that follows it, if any
+	struct Piece {
+		const char* text;
+		uint8_t length;
+		uint8_t argument;	// As numbered in the formats, or zero for no field
+		uint8_t width;
+	};
+
+	struct Template {
+		std::array<Piece, 4> pieces;
+		size_t count;
+	};
+
+	// The formats are parsed once, and the mnemomics grouped by the top
+	// nibble of the instructions they match, keeping their search order.
+	class Decoder final {
+	public:
+		Decoder() {
+			for (size_t index = 0; index < MnemomicCount; ++index) {
+				const auto& mnemomic = Mnemomics[index];
+				m_templates[index] = parse(mnemomic.format);
+				for (size_t nibble = 0; nibble < m_candidates.size(); ++nibble) {
+					if (((nibble << 12) & mnemomic.mask) == (mnemomic.match & 0xf000)) {
+						auto& candidates = m_candidates[nibble];
+						if (candidates.count == candidates.indices.size())
+							throw std::logic_error("Too many mnemomics share an opcode nibble");
+						candidates.indices[candidates.count++] = (uint8_t)index;
+					}
+				}
+			}
+		}
+
+		// The index of the instruction's mnemomic, or -1 if it has none
+		int find(const uint16_t instruction, const Configuration& configuration, const bool compatibility) const {
+			const auto level = configuration.getType();
+			const auto& candidates = m_candidates[instruction >> 12];
+			for (size_t candidate = 0; candidate < candidates.count; ++candidate) {
+				const auto index = candidates.indices[candidate];
+				const auto& mnemomic = Mnemomics[index];
+				if (((instruction & mnemomic.mask) == mnemomic.match) && (level >= mnemomic.level) && mnemomic.applies(configuration, compatibility))
+					return index;
+			}
+			return -1;
+		}
+
+		const Template& getTemplate(const int index) const {
+			return m_templates[index];
+		}
+
+	private:
+		struct Candidates {
+			std::array<uint8_t, 24> indices;
+			size_t count = 0;
+		};
+
+		std::array<Template, MnemomicCount> m_templates;
+		std::array<Candidates, 16> m_candidates;
+
+		// Formats use only boost::format's "%N$0WX": argument N (1-6) in at least W hexadecimal digits
+		static Template parse(const char* format) {
+			Template parsed;
+			parsed.count = 0;
+			auto text = format;
+			for (;;) {
+				if (parsed.count == parsed.pieces.size())
+					throw std::logic_error(std::string("Too many fields in mnemomic format: ") + format);
+				auto& piece = parsed.pieces[parsed.count++];
+				const auto field = std::strchr(text, '%');
+				const auto end = field == nullptr ? text + std::strlen(text) : field;
+				piece.text = text;
+				piece.length = (uint8_t)(end - text);
+				piece.argument = piece.width = 0;
+				if (field == nullptr)
+					return parsed;
+				if ((field[1] < '1') || (field[1] > '6') || (field[2] != '$') || (field[3] != '0') || !std::isdigit(field[4]) || (field[5] != 'X'))
+					throw std::logic_error(std::string("Unsupported mnemomic format: ") + format);
+				piece.argument = (uint8_t)(field[1] - '0');
+				piece.width = (uint8_t)(field[4] - '0');
+				text = field + 6;
+			}
+		}
+	};
+
+	const Decoder& decoder() {
+		static const Decoder decoded;
+		return decoded;
+	}
+
+	// At least "width" upper case hexadecimal digits, as printf's "%0*X" writes them
+	char* writeHex(char* output, const unsigned value, const int width) {
+		static const char Digits[] = "0123456789ABCDEF";
+		auto digits = 1;
+		while ((digits < 8) && ((value >> (4 * digits)) != 0))
+			++digits;
+		digits = std::max(digits, width);
+		for (auto digit = digits - 1; digit >= 0; --digit)
+			*output++ = Digits[(value >> (4 * digit)) & 0xf];
+		return output;
+	}
+
+	char* writeText(char* output, const char* text) {
+		while (*text != 0)
+			*output++ = *text++;
+		return output;
+	}
 }
 
 std::string Disassembler::generateState(const InstructionEventArgs& event, Chip8* processor) const {
+	return generateState(TraceRecord::capture(event.getProgramCounter(), event.getInstruction(), *processor));
+}
 
-	auto pc = event.getProgramCounter();
-	auto sp = processor->SP();
-	auto indirector = processor->indirector();
-	auto dt = processor->delayTimer();
-	auto st = processor->soundTimer();
-	auto waiting = processor->isWaitingForKeyPress();
-	auto keypressRegister = processor->getWaitingForKeyPressRegister();
-	const auto& V = processor->registers();
+std::string Disassembler::generateState(const TraceRecord& record) const {
+	char buffer[BufferSize];
+	return std::string(buffer, generateState(record, buffer));
+}
 
-	std::ostringstream output;
+size_t Disassembler::generateState(const TraceRecord& record, char* buffer) const {
 
-	m_formatter.parse("PC=%1$04X");
-	output << m_formatter % pc;
+	auto output = writeText(buffer, "PC=");
+	output = writeHex(output, record.programCounter, 4);
 
-	// V registers, 8 at a time
-	m_formatter.parse(
-		"%1$02X %2$02X %3$02X %4$02X "
-		"%5$02X %6$02X %7$02X %8$02X ");
+	output = writeText(output, " V=");
+	for (const auto value : record.registers) {
+		output = writeHex(output, value, 2);
+		*output++ = ' ';
+	}
 
-	output << " V=";
+	output = writeText(output, " SP=");
+	output = writeHex(output, record.stackPointer, 1);
+	output = writeText(output, " I=");
+	output = writeHex(output, record.indirector, 4);
 
-	// first eight
-	output << m_formatter
-		% (unsigned)V[0] % (unsigned)V[1] % (unsigned)V[2] % (unsigned)V[3]
-		% (unsigned)V[4] % (unsigned)V[5] % (unsigned)V[6] % (unsigned)V[7];
+	*output = 0;
+	return output - buffer;
+}
 
-	// second eight
-	output << m_formatter
-		% (unsigned)V[8] % (unsigned)V[9] % (unsigned)V[10] % (unsigned)V[11]
-		% (unsigned)V[12] % (unsigned)V[13] % (unsigned)V[14] % (unsigned)V[15];
+const char* Disassembler::getMnemomicFormat(const uint16_t instruction, const Chip8& processor) {
+	const auto& configuration = processor.configuration();
+	const auto compatibility = (configuration.getType() >= superChip) && static_cast<const Schip&>(processor).getCompatibility();
+	return getMnemomicFormat(instruction, configuration, compatibility);
+}
 
-	m_formatter.parse(
-		" SP=%1$01X"
-		" I=%2$04X");
+const char* Disassembler::getMnemomicFormat(const uint16_t instruction, const Configuration& configuration, const bool compatibility) {
+	const auto index = decoder().find(instruction, configuration, compatibility);
+	return index < 0 ? nullptr : Mnemomics[index].format;
+}
 
-	output << m_formatter
-		% sp % indirector % dt % st % waiting % keypressRegister;
+std::string Disassembler::disassemble(const InstructionEventArgs& event, const Chip8* processor) const {
+	return disassemble(TraceRecord::capture(event.getProgramCounter(), event.getInstruction(), *processor), processor->configuration());
+}
 
-	return output.str();
+std::string Disassembler::disassemble(const TraceRecord& record, const Configuration& configuration) const {
+	char buffer[BufferSize];
+	return std::string(buffer, disassemble(record, configuration, buffer));
 }
 
-std::string Disassembler::disassemble(const std::string& mnemomicFormat, const InstructionEventArgs& event, const Memory& memory) const {
-	if (mnemomicFormat.empty())
+size_t Disassembler::disassemble(const TraceRecord& record, const Configuration& configuration, char* buffer) const {
+	const auto& decoded = decoder();
+	const auto compatibility = (record.flags & TraceRecord::Compatibility) != 0;
+	const auto index = decoded.find(record.instruction, configuration, compatibility);
+	if (index < 0)
 		throw std::runtime_error("No disassembly format defined.");
 
-	std::ostringstream output;
-	auto address = event.getAddress();
-	auto operand = event.getOperand();
-	auto n = event.getN();
-	auto x = event.getX();
-	auto y = event.getY();
-	auto longAddress = memory.getWord(event.getProgramCounter() + 2);
-	m_formatter.parse(mnemomicFormat);
-	output << m_formatter % address % operand % n % x % y % longAddress;
-
-	return output.str();
+	Instruction operands;
+	operands.decode(record.instruction);
+
+	// Numbered as in the formats
+	const unsigned arguments[] = { 0, operands.nnn, operands.nn, operands.n, operands.x, operands.y, record.following };
+
+	const auto& parsed = decoded.getTemplate(index);
+	auto output = buffer;
+	for (size_t piece = 0; piece < parsed.count; ++piece) {
+		const auto& current = parsed.pieces[piece];
+		output = std::copy(current.text, current.text + current.length, output);
+		if (current.argument != 0)
+			output = writeHex(output, arguments[current.argument], current.width);
+	}
+
+	*output = 0;
+	return output - buffer;
+}
+
+std::string Disassembler::trace(const TraceRecord& record, const Configuration& configuration) const {
+	char buffer[BufferSize];
+	return std::string(buffer, trace(record, configuration, buffer));
+}
+
+size_t Disassembler::trace(const TraceRecord& record, const Configuration& configuration, char* buffer) const {
+	auto output = buffer + generateState(record, buffer);
+	*output++ = '\t';
+	output = writeHex(output, record.instruction, 4);
+	*output++ = '\t';
+	output += disassemble(record, configuration, output);
+	return output - buffer;
 }
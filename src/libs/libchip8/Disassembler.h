@@ -1,20 +1,39 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
-#include <boost/format.hpp>
-
 class Chip8;
+class Configuration;
 class InstructionEventArgs;
-class Memory;
+struct TraceRecord;
 
+// Formats instructions and processor state as text, through templates parsed
+// once from the mnemomic formats rather than a format string per instruction.
 class Disassembler final {
 public:
-	Disassembler();
+	enum {
+		BufferSize = 128	// Enough for any line of the text trace, and its terminating null
+	};
+
+	// The format of an instruction's mnemomic, or null if the processor has no such instruction
+	static const char* getMnemomicFormat(uint16_t instruction, const Chip8& processor);
+	static const char* getMnemomicFormat(uint16_t instruction, const Configuration& configuration, bool compatibility);
 
-	std::string disassemble(const std::string& mnemomicFormat, const InstructionEventArgs& event, const Memory& memory) const;
+	std::string disassemble(const InstructionEventArgs& event, const Chip8* processor) const;
 	std::string generateState(const InstructionEventArgs& event, Chip8* processor) const;
 
-private:
-	mutable boost::format m_formatter;
+	// As above, from a record of the processor about to execute an instruction
+	std::string disassemble(const TraceRecord& record, const Configuration& configuration) const;
+	std::string generateState(const TraceRecord& record) const;
+
+	// A whole line of the text trace: state, instruction and its disassembly
+	std::string trace(const TraceRecord& record, const Configuration& configuration) const;
+
+	// As above, without allocating: each writes a null terminated line into a
+	// buffer of at least BufferSize characters, returning its length.
+	size_t disassemble(const TraceRecord& record, const Configuration& configuration, char* buffer) const;
+	size_t generateState(const TraceRecord& record, char* buffer) const;
+	size_t trace(const TraceRecord& record, const Configuration& configuration, char* buffer) const;
 };
\ No newline at end of file
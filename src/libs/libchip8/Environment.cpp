@@ -0,0 +1,65 @@
+#include "stdafx.h"
+#include "Environment.h"
+
+#include "Chip8.h"
+#include "ProcessorFactory.h"
+
+Environment::Environment(const Configuration& configuration, const int rewardAddress, const int frameBudget)
+: m_processor(ProcessorFactory::buildProcessor(configuration)),
+  m_rewardAddress(rewardAddress),
+  m_frameBudget(frameBudget),
+  m_observationWords(BitmappedGraphics::getPackedWords(configuration.getGraphicPlanes())) {
+	if (m_rewardAddress >= configuration.getMemorySize())
+		throw std::out_of_range("Reward address is outside memory");
+}
+
+Environment::Environment(Environment&& rhs) = default;
+
+Environment::~Environment() {}
+
+Environment& Environment::operator=(Environment&& rhs) = default;
+
+void Environment::reset(const std::string& rom, const uint32_t seed) {
+	auto& machine = processor();
+	machine.initialise();
+	if (rom != m_rom) {
+		machine.loadGame(rom);
+		m_image = machine.memory();
+		m_rom = rom;
+	} else {
+		machine.memory() = m_image;
+	}
+	machine.seedRandomNumbers(seed);
+	machine.setDrawNeeded(false);	// As if presented
+
+	m_frames = 0;
+	m_score = score();
+	m_done = false;
+}
+
+int Environment::step(const uint16_t action, const int frameskip) {
+	if (m_done)
+		return 0;
+
+	auto& machine = processor();
+	machine.keyboard().setKeys(action);
+	for (int frame = 0; (frame < frameskip) && !m_done; ++frame) {
+		machine.runFrame();
+		machine.updateTimers();
+		machine.setDrawNeeded(false);	// As if presented
+		++m_frames;
+		m_done = machine.getFinished() || ((m_frameBudget > 0) && (m_frames >= m_frameBudget));
+	}
+
+	const auto previous = m_score;
+	m_score = score();
+	return m_score - previous;
+}
+
+void Environment::observe(uint64_t* output) const {
+	processor().display().pack(output);
+}
+
+int Environment::score() const {
+	return m_rewardAddress < 0 ? 0 : processor().memory().get(m_rewardAddress);
+}
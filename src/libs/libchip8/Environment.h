@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Configuration.h"
+#include "Memory.h"
+
+class Chip8;
+
+// A single machine driven the way a learning agent drives a game: reset()
+// starts a ROM from a known seed, then each step() holds an action (a keypad
+// mask, bit k for key k) for a number of frames and reports what came of it.
+//
+// The reward for a step is the change in the byte at the reward address over
+// the step, e.g. a score kept in memory; with no reward address it is always
+// zero.  An episode is done once the program exits or the frame budget is used.
+class Environment final {
+public:
+	// rewardAddress < 0: no reward.  frameBudget <= 0: no limit.
+	Environment(const Configuration& configuration, int rewardAddress = -1, int frameBudget = 0);
+	Environment(Environment&& rhs);
+	~Environment();
+
+	Environment& operator=(Environment&& rhs);
+
+	// Reading the ROM is skipped when it is the one last used
+	void reset(const std::string& rom, uint32_t seed);
+
+	// Returns the reward.  Steps taken once done do nothing and return zero.
+	int step(uint16_t action, int frameskip = 1);
+
+	bool getDone() const {
+		return m_done;
+	}
+
+	// Frames run since the last reset
+	int getFrames() const {
+		return m_frames;
+	}
+
+	// The display as it stands, as packed by BitmappedGraphics::pack
+	void observe(uint64_t* output) const;
+
+	size_t getObservationWords() const {
+		return m_observationWords;
+	}
+
+	const Chip8& processor() const {
+		return *m_processor;
+	}
+
+	Chip8& processor() {
+		return *m_processor;
+	}
+
+private:
+	std::unique_ptr<Chip8> m_processor;
+	int m_rewardAddress;
+	int m_frameBudget;
+	size_t m_observationWords;
+
+	std::string m_rom;
+	Memory m_image;
+
+	int m_frames = 0;
+	int m_score = 0;
+	bool m_done = false;
+
+	int score() const;
+};
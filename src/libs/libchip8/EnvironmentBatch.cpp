@@ -0,0 +1,36 @@
+#include "stdafx.h"
+#include "EnvironmentBatch.h"
+
+#include "BitmappedGraphics.h"
+
+EnvironmentBatch::EnvironmentBatch(const Configuration& configuration, const size_t size, const int rewardAddress, const int frameBudget, const int threads)
+: m_workers(threads),
+  m_observationWords(BitmappedGraphics::getPackedWords(configuration.getGraphicPlanes())),
+  m_observations(size * m_observationWords),
+  m_rewards(size),
+  m_dones(size) {
+	m_environments.reserve(size);
+	for (size_t index = 0; index < size; ++index)
+		m_environments.emplace_back(configuration, rewardAddress, frameBudget);
+}
+
+void EnvironmentBatch::reset(const std::string& rom, const uint32_t seed) {
+	m_workers.run(size(), [&](size_t index) {
+		environment(index).reset(rom, seed + (uint32_t)index);
+		m_rewards[index] = 0;
+		gather(index);
+	});
+}
+
+void EnvironmentBatch::step(const uint16_t* actions, const int frameskip) {
+	m_workers.run(size(), [&](size_t index) {
+		m_rewards[index] = environment(index).step(actions[index], frameskip);
+		gather(index);
+	});
+}
+
+void EnvironmentBatch::gather(const size_t index) {
+	const auto& current = environment(index);
+	current.observe(&m_observations[index * m_observationWords]);
+	m_dones[index] = current.getDone();
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Configuration.h"
+#include "Environment.h"
+#include "WorkerPool.h"
+
+// Many environments of one configuration stepped together, spread over a
+// worker pool.  Results are gathered into flat arrays, one entry per
+// environment, so a whole batch can be fed and read without walking it.
+class EnvironmentBatch final {
+public:
+	// threads: as for WorkerPool
+	EnvironmentBatch(const Configuration& configuration, size_t size, int rewardAddress = -1, int frameBudget = 0, int threads = 0);
+
+	size_t size() const {
+		return m_environments.size();
+	}
+
+	const Environment& environment(size_t index) const {
+		return m_environments[index];
+	}
+
+	Environment& environment(size_t index) {
+		return m_environments[index];
+	}
+
+	// Environment n is seeded with seed + n
+	void reset(const std::string& rom, uint32_t seed);
+
+	// Environment n holds actions[n] for frameskip frames.  Environments that
+	// are already done are left alone, and report no reward.
+	void step(const uint16_t* actions, int frameskip = 1);
+
+	void step(const std::vector<uint16_t>& actions, int frameskip = 1) {
+		step(actions.data(), frameskip);
+	}
+
+	// Environment n's observation starts at word n * getObservationWords()
+	const std::vector<uint64_t>& observations() const {
+		return m_observations;
+	}
+
+	size_t getObservationWords() const {
+		return m_observationWords;
+	}
+
+	// From the last step
+	const std::vector<int>& rewards() const {
+		return m_rewards;
+	}
+
+	// Non zero for each environment whose episode is over
+	const std::vector<uint8_t>& dones() const {
+		return m_dones;
+	}
+
+private:
+	std::vector<Environment> m_environments;
+	WorkerPool m_workers;
+
+	size_t m_observationWords;
+	std::vector<uint64_t> m_observations;
+	std::vector<int> m_rewards;
+	std::vector<uint8_t> m_dones;
+
+	void gather(size_t index);
+};
@@ -10,7 +10,6 @@ GraphicsPlane::GraphicsPlane(bool clip, bool countExceededRows)
 
 size_t GraphicsPlane::draw(const Memory& memory, int address, int drawX, int drawY, int width, int height) {
 
-	auto screenWidth = getWidth();
 	auto screenHeight = getHeight();
 
 	auto bytesPerRow = width / 8;
@@ -21,119 +20,133 @@ size_t GraphicsPlane::draw(const Memory& memory, int address, int drawX, int dra
 	//// erased, VF is <> 00, other-wise 00. In extended screen mode (aka hires), SCHIP 1.1
 	//// will report the number of rows that include a pixel that XORs with the existing data,
 	//// so the 'correct' way to detect collisions is Vf <> 0 rather than Vf == 1.
-	std::vector<int> rowHits(height);
-
-	auto numberOfCells = m_graphics.size();
-	auto skipX = !m_clip;
-	auto skipY = !m_clip;
-
-	for (int row = 0; row < height; ++row) {
-		auto cellY = drawY + row;
-		auto clippedY = cellY % screenHeight;
-		auto skippedY = skipY && (clippedY != cellY);
-		if (skippedY)
-			continue;
-
-		auto spriteAddress = address + (row * bytesPerRow);
-		for (int column = 0; column < width; ++column) {
-			auto cellX = drawX + column;
-			auto clippedX = cellX % screenWidth;
-			auto skippedX = skipX && (clippedX != cellX);
-			if (skippedX)
-				continue;
-
-			size_t cell = clippedY * screenWidth + clippedX;
-			if (cell < numberOfCells) {
-				int highColumn = column > 7;
-				auto spritePixelByte = memory.get(spriteAddress + (highColumn ? 1 : 0));
-				auto spritePixel = (spritePixelByte & (0x80 >> (column & 0x7))) == 0 ? 0 : 1;
-				if (spritePixel) {
-					auto before = m_graphics[cell];
-					if (before)
-						++rowHits[row];
-					m_graphics[cell] ^= spritePixel;
-				}
-			} else {
-				//// https://github.com/Chromatophore/HP48-Superchip#collision-with-the-bottom-of-the-screen
-				//// Sprites that are drawn such that they contain data that runs off of the bottom of the
-				//// screen will set Vf based on the number of lines that run off of the screen,
-				//// as if they are colliding.
-				if (m_countExceededRows) {
-					rowHits[row]++;
-				}
+	size_t rowHits = 0;
+
+	// Clipping bounds are worked out once per sprite, not per row or pixel
+	const auto placement = placeSprite(width, drawX);
+	if (!placement.visible)
+		return rowHits;
+
+	auto rows = height;
+	if (!m_clip)
+		rows = std::max(0, std::min(height, screenHeight - drawY));
+
+	auto numberOfRows = (int)m_rows.size();
+	auto clippedY = drawY % screenHeight;
+
+	for (int row = 0; row < rows; ++row) {
+
+		if (clippedY < numberOfRows) {
+			auto spriteAddress = address + (row * bytesPerRow);
+			uint64_t sprite = memory.get(spriteAddress);
+			if (bytesPerRow > 1)
+				sprite = (sprite << 8) | memory.get(spriteAddress + 1);
+
+			const auto placed = placeRow(sprite, placement);
+			auto& cells = m_rows[clippedY];
+			const auto before = (cells[0] & placed[0]) | (cells[1] & placed[1]);
+			rowHits += before != 0;
+			cells[0] ^= placed[0];
+			cells[1] ^= placed[1];
+		} else {
+			//// https://github.com/Chromatophore/HP48-Superchip#collision-with-the-bottom-of-the-screen
+			//// Sprites that are drawn such that they contain data that runs off of the bottom of the
+			//// screen will set Vf based on the number of lines that run off of the screen,
+			//// as if they are colliding.
+			if (m_countExceededRows) {
+				++rowHits;
 			}
 		}
+
+		if (++clippedY == screenHeight)
+			clippedY = 0;
 	}
-	return std::count_if(rowHits.cbegin(), rowHits.cend(), [](int hits) { return hits > 0; });
+	return rowHits;
 }
 
-void GraphicsPlane::allocateMemory() {
-	auto previous = m_graphics;
-	m_graphics.resize(getWidth() * getHeight());
+// Lines sprite rows up with the display, wrapping or dropping the pixels that run off the right
+GraphicsPlane::placement_t GraphicsPlane::placeSprite(int width, int drawX) const {
 
-	// https://github.com/Chromatophore/HP48-Superchip#swapping-display-modes
-	// Superchip has two different display modes, 64x32 and 128x64. When swapped between,
-	// the display buffer is not cleared. Pixels are modified based on being XORed in 1x2 vertical
-	// columns, so odd patterns can be created.
-	if (!previous.empty()) {
-		auto length = std::min(previous.size(), m_graphics.size());
-		std::copy(previous.cbegin(), previous.cbegin() + length, m_graphics.begin());
-	}
-}
+	auto screenWidth = getWidth();
 
-void GraphicsPlane::clearRow(int row) {
-	auto width = getWidth();
-	std::fill_n(m_graphics.begin() + row * width, width, 0);
+	placement_t placement;
+
+	placement.offset = drawX % screenWidth;
+	placement.visible = m_clip || (placement.offset == drawX);
+
+	// Leftmost sprite pixel in the most significant bit
+	placement.alignment = 64 - width;
+
+	// The second word is beyond the right edge in low resolution
+	placement.split = (placement.offset > 0) && (placement.offset < 64) && (screenWidth > 64);
+
+	auto exceeded = placement.offset + width - screenWidth;
+	placement.wrap = (m_clip && (exceeded > 0)) ? width - exceeded : 0;
+
+	return placement;
 }
 
-void GraphicsPlane::clearColumn(int column) {
-	auto width = getWidth();
-	auto height = getHeight();
-	for (int y = 0; y < height; ++y) {
-		m_graphics[column + (y * width)] = 0;
+GraphicsPlane::row_t GraphicsPlane::placeRow(uint64_t sprite, const placement_t& placement) {
+
+	row_t placed = { { 0, 0 } };
+
+	auto aligned = sprite << placement.alignment;
+
+	if (placement.offset < 64) {
+		placed[0] = aligned >> placement.offset;
+		if (placement.split)
+			placed[1] = aligned << (64 - placement.offset);
+	} else {
+		placed[1] = aligned >> (placement.offset - 64);
 	}
-}
 
-void GraphicsPlane::copyRow(int source, int destination) {
-	auto width = getWidth();
-	std::copy_n(m_graphics.cbegin() + source * width, width, m_graphics.begin() + destination * width);
+	if (placement.wrap > 0)
+		placed[0] |= aligned << placement.wrap;
+
+	return placed;
 }
 
-void GraphicsPlane::copyColumn(int source, int destination) {
+void GraphicsPlane::allocateMemory() {
+	auto previous = m_rows;
+	auto previousHeight = (int)previous.size();
+
 	auto width = getWidth();
 	auto height = getHeight();
-	for (int y = 0; y < height; ++y) {
-		auto rowOffset = y * width;
-		m_graphics[destination + rowOffset] = m_graphics[source + rowOffset];
+	if (previousHeight == height)
+		return;
+
+	m_rows.assign(height, row_t{ { 0, 0 } });
+
+	// https://github.com/Chromatophore/HP48-Superchip#swapping-display-modes
+	// Superchip has two different display modes, 64x32 and 128x64. When swapped between,
+	// the display buffer is not cleared. Pixels are modified based on being XORed in 1x2 vertical
+	// columns, so odd patterns can be created.
+	if (previousHeight > 0) {
+		auto previousWidth = previousHeight == ScreenHeightHigh ? ScreenWidthHigh : ScreenWidthLow;
+		auto length = std::min(previousWidth * previousHeight, width * height);
+		for (int cell = 0; cell < length; ++cell) {
+			auto x = cell % previousWidth;
+			auto y = cell / previousWidth;
+			auto on = (previous[y][x >> 6] >> (63 - (x & 63))) & 1;
+			setPixel(cell % width, cell / width, on != 0);
+		}
 	}
 }
 
 void GraphicsPlane::scrollDown(int count) {
-	auto screenHeight = getHeight();
-
-	// Copy rows bottom to top
-	for (int y = screenHeight - count - 1; y >= 0; --y) {
-		copyRow(y, y + count);
-	}
+	auto blanked = std::min(count, (int)m_rows.size());
 
-	// Remove the topmost rows, blanked by the scroll effect
-	for (int y = 0; y < count; ++y) {
-		clearRow(y);
-	}
+	// Move the rows down in one block, then remove the topmost rows, blanked by the scroll effect
+	std::copy_backward(m_rows.cbegin(), m_rows.cend() - blanked, m_rows.end());
+	std::fill_n(m_rows.begin(), blanked, row_t{ { 0, 0 } });
 }
 
 void GraphicsPlane::scrollUp(int count) {
-	auto screenHeight = getHeight();
-
-	// Copy rows from top to bottom
-	for (int y = 0; y < (screenHeight - count); ++y) {
-		copyRow(y + count, y);
-	}
+	auto blanked = std::min(count, (int)m_rows.size());
 
-	// Remove the bottommost rows, blanked by the scroll effect
-	for (int y = 0; y < count; ++y) {
-		clearRow(screenHeight - y - 1);
-	}
+	// Move the rows up in one block, then remove the bottommost rows, blanked by the scroll effect
+	std::copy(m_rows.cbegin() + blanked, m_rows.cend(), m_rows.begin());
+	std::fill(m_rows.end() - blanked, m_rows.end(), row_t{ { 0, 0 } });
 }
 
 void GraphicsPlane::scrollLeft() {
@@ -142,16 +155,10 @@ void GraphicsPlane::scrollLeft() {
 
 void GraphicsPlane::scrollLeft(int count) {
 
-	auto screenWidth = getWidth();
-
-	// Copy columns from left to right
-	for (int x = 0; x < (screenWidth - count); ++x) {
-		copyColumn(x + count, x);
-	}
-
-	// Remove the rightmost columns, blanked by the scroll effect
-	for (int x = 0; x < count; ++x) {
-		clearColumn(screenWidth - x - 1);
+	// Each row shifts as a whole: the rightmost columns are blanked by the scroll effect
+	for (auto& row : m_rows) {
+		row[0] = (row[0] << count) | (row[1] >> (64 - count));
+		row[1] <<= count;
 	}
 }
 
@@ -161,19 +168,16 @@ void GraphicsPlane::scrollRight() {
 
 void GraphicsPlane::scrollRight(int count) {
 
-	auto screenWidth = getWidth();
-
-	// Copy columns from right to left
-	for (int x = screenWidth - count - 1; x >= 0; --x) {
-		copyColumn(x, x + count);
-	}
+	// In low resolution, anything shifted into the second word is off screen
+	auto highResolution = getHighResolution();
 
-	// Remove the leftmost columns, blanked by the scroll effect
-	for (int x = 0; x < count; ++x) {
-		clearColumn(x);
+	// Each row shifts as a whole: the leftmost columns are blanked by the scroll effect
+	for (auto& row : m_rows) {
+		row[1] = highResolution ? (row[1] >> count) | (row[0] << (64 - count)) : 0;
+		row[0] >>= count;
 	}
 }
 
 void GraphicsPlane::clear() {
-	std::fill(m_graphics.begin(), m_graphics.end(), 0);
+	std::fill(m_rows.begin(), m_rows.end(), row_t{ { 0, 0 } });
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <vector>
 
 namespace cereal {
@@ -18,15 +20,29 @@ public:
 		ScreenHeightHigh = 64
 	};
 
+	// One bit per pixel, in two words: the leftmost pixel of a row is
+	// the most significant bit of its first word.
+	typedef std::array<uint64_t, 2> row_t;
+
 	GraphicsPlane() = default;
 	GraphicsPlane(bool clip, bool countExceededRows);
 
-	const std::vector<int>& graphics() const {
-		return m_graphics;
+	const std::vector<row_t>& rows() const {
+		return m_rows;
+	}
+
+	std::vector<row_t>& rows() {
+		return m_rows;
+	}
+
+	int getPixel(int x, int y) const {
+		return (int)(m_rows[y][x >> 6] >> (63 - (x & 63))) & 1;
 	}
 
-	std::vector<int>& graphics() {
-		return m_graphics;
+	void setPixel(int x, int y, bool value) {
+		const auto bit = uint64_t(1) << (63 - (x & 63));
+		auto& word = m_rows[y][x >> 6];
+		word = value ? (word | bit) : (word & ~bit);
 	}
 
 	void setHighResolution(bool value) {
@@ -48,13 +64,13 @@ private:
 
 	template<class Archive> void serialize(Archive& archive) {
 		archive(
-			m_graphics,
+			m_rows,
 			m_highResolution,
 			m_clip,
 			m_countExceededRows);
 	}
 
-	std::vector<int> m_graphics;
+	std::vector<row_t> m_rows;
 	bool m_highResolution = false;
 	bool m_clip = false;
 	bool m_countExceededRows = false;
@@ -73,11 +89,19 @@ private:
 		return getHighResolution() ? ScreenHeightHigh : ScreenHeightLow;
 	}
 
-	void clearRow(int row);
-	void clearColumn(int column);
-	void copyRow(int source, int destination);
-	void copyColumn(int source, int destination);
-
+	// Shifts of 1-63 columns
 	void scrollLeft(int count);
 	void scrollRight(int count);
+
+	// How the rows of a sprite line up with the display
+	struct placement_t {
+		bool visible;
+		int alignment;	// Shift that puts the leftmost sprite pixel into the top bit
+		int offset;		// Display column of the leftmost sprite pixel
+		bool split;		// Whether the sprite continues into the second word
+		int wrap;		// Shift that brings pixels past the right edge round to the left, or zero
+	};
+
+	placement_t placeSprite(int width, int drawX) const;
+	static row_t placeRow(uint64_t sprite, const placement_t& placement);
 };
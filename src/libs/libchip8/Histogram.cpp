@@ -0,0 +1,68 @@
+#include "stdafx.h"
+#include "Histogram.h"
+
+#ifdef _MSC_VER
+#	include <intrin.h>
+#endif
+
+const uint64_t Histogram::MaximumValue;
+
+void Histogram::record(uint64_t value) {
+	value = std::min(value, MaximumValue);
+	++m_counts[getIndex(value)];
+	++m_count;
+	m_total += value;
+	m_maximum = std::max(m_maximum, value);
+}
+
+void Histogram::add(const Histogram& other) {
+	for (size_t i = 0; i < m_counts.size(); ++i)
+		m_counts[i] += other.m_counts[i];
+	m_count += other.m_count;
+	m_total += other.m_total;
+	m_maximum = std::max(m_maximum, other.m_maximum);
+}
+
+void Histogram::reset() {
+	m_counts.fill(0);
+	m_count = m_total = m_maximum = 0;
+}
+
+uint64_t Histogram::getValueAtPercentile(const double percentile) const {
+	if (m_count == 0)
+		return 0;
+	const auto clamped = std::min(std::max(percentile, 0.0), 100.0);
+	const auto wanted = std::max<uint64_t>(1, (uint64_t)std::ceil(clamped / 100.0 * m_count));
+	uint64_t seen = 0;
+	for (int i = 0; i < Buckets; ++i) {
+		seen += m_counts[i];
+		if (seen >= wanted)
+			return std::min(getHighestInBucket(i), m_maximum);
+	}
+	return m_maximum;
+}
+
+// Below SubBuckets, a bucket per value.  Above, the value's top SubBucketBits
+// bits pick one of the upper half of the buckets at its power of two.
+int Histogram::getIndex(const uint64_t value) {
+	static_assert((ValueBits - SubBucketBits) <= 32, "Recorded values must fit 32 bits above the sub-buckets");
+	const auto high = (uint32_t)(value >> SubBucketBits);
+	if (high == 0)
+		return (int)value;
+#ifdef _MSC_VER
+	unsigned long highest;
+	_BitScanReverse(&highest, high);
+	const auto shift = (int)highest + 1;
+#else
+	const auto shift = 32 - __builtin_clz(high);
+#endif
+	return shift * HalfSubBuckets + (int)(value >> shift);
+}
+
+uint64_t Histogram::getHighestInBucket(const int index) {
+	if (index < SubBuckets)
+		return index;
+	const auto shift = index / HalfSubBuckets - 1;
+	const uint64_t bucket = index % HalfSubBuckets + HalfSubBuckets;
+	return ((bucket + 1) << shift) - 1;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// Counts of values, bucketed as HdrHistogram does: each power of two is split
+// into the same number of linear buckets, so any value is recorded to within
+// 1/32 of itself whatever its size.  Recording is a bit scan, a shift and an
+// increment, and there is no allocation, so times can be recorded every frame.
+//
+// Values from zero to MaximumValue are held; larger ones count as MaximumValue.
+class Histogram final {
+public:
+	enum {
+		SubBucketBits = 6,
+		ValueBits = 36	// About 68 seconds, in nanoseconds
+	};
+
+	static const uint64_t MaximumValue = (uint64_t(1) << ValueBits) - 1;
+
+	void record(uint64_t value);
+
+	// Adds the other's counts to these
+	void add(const Histogram& other);
+
+	void reset();
+
+	uint64_t getCount() const {
+		return m_count;
+	}
+
+	uint64_t getMaximum() const {
+		return m_maximum;
+	}
+
+	double getMean() const {
+		return m_count == 0 ? 0.0 : (double)m_total / m_count;
+	}
+
+	// The largest value that could be in the bucket holding the given percentile
+	// (0-100), but no more than the largest value recorded.  Zero when empty.
+	uint64_t getValueAtPercentile(double percentile) const;
+
+private:
+	enum {
+		SubBuckets = 1 << SubBucketBits,
+		HalfSubBuckets = SubBuckets / 2,
+		Buckets = (ValueBits - SubBucketBits) * HalfSubBuckets + SubBuckets
+	};
+
+	std::array<uint64_t, Buckets> m_counts = { {} };
+	uint64_t m_count = 0;
+	uint64_t m_total = 0;
+	uint64_t m_maximum = 0;
+
+	static int getIndex(uint64_t value);
+	static uint64_t getHighestInBucket(int index);
+};
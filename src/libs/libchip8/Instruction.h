@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+
+class Chip8;
+
+// A predecoded instruction: the handler that executes it, plus
+// the operands already split out of the opcode.
+class Instruction final {
+public:
+	typedef void (*handler_t)(Chip8& processor, const Instruction& instruction);
+
+	handler_t handler = nullptr;
+
+	uint16_t opcode = 0;
+	uint16_t nnn = 0;
+	uint8_t nn = 0;
+	uint8_t n = 0;
+	uint8_t x = 0;
+	uint8_t y = 0;
+
+	bool isDecoded() const {
+		return handler != nullptr;
+	}
+
+	void decode(uint16_t instruction) {
+		// <-         opcode         ->
+		// <-    high  -><-    low   ->
+		//        <-        nnn      ->
+		//               <-    nn    ->
+		//                      <- n ->
+		//        <- x ->
+		//               <- y ->
+		handler = nullptr;
+		opcode = instruction;
+		nnn = instruction & 0xfff;
+		nn = instruction & 0xff;
+		n = nn & 0xf;
+		x = (instruction & 0xf00) >> 8;
+		y = (nn & 0xf0) >> 4;
+	}
+};
@@ -1,25 +1,21 @@
 #include "stdafx.h"
 #include "KeyboardDevice.h"
 
+#ifdef _MSC_VER
+#	include <intrin.h>
+#endif
+
 bool KeyboardDevice::checkKeyPress(int& key) const {
-	key = -1;
-	for (auto idx = 0UL; idx < m_mapping.size(); ++idx) {
-		if (isKeyPressed(idx)) {
-			key = idx;
-			return true;
-		}
+	if (m_keys == 0) {
+		key = -1;
+		return false;
 	}
-	return false;
-}
-
-bool KeyboardDevice::isKeyPressed(int key) const {
-	return m_raw.find(m_mapping[key]) != m_raw.end();
-}
-
-void KeyboardDevice::pokeKey(SDL_Keycode raw) {
-	m_raw.emplace(raw);
-}
-
-void KeyboardDevice::pullKey(SDL_Keycode raw) {
-	m_raw.erase(raw);
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, m_keys);
+	key = (int)index;
+#else
+	key = __builtin_ctz(m_keys);
+#endif
+	return true;
 }
@@ -1,53 +1,52 @@
 #pragma once
 
-#include <array>
-#include <unordered_set>
-
-#include <SDL.h>
+#include <cstdint>
 
 namespace cereal {
 	class access;
 }
 
+// The state of the sixteen key CHIP-8 keypad, one bit per key.  Mapping
+// host input onto it is left to the front end.
+//
+// CHIP-8 Keyboard layout
+//  1   2   3   C
+//  4   5   6   D
+//  7   8   9   E
+//  A   0   B   F
 class KeyboardDevice final {
 public:
+	// The lowest numbered key held down, if any
 	bool checkKeyPress(int& key) const;
-	bool isKeyPressed(int key) const;
-
-	void pokeKey(SDL_Keycode raw);
-	void pullKey(SDL_Keycode raw);
 
-	// For game controller keyboard mapping
-	const std::array<int, 16>& getMapping() const {
-		return m_mapping;
+	// Only the low four bits of "key" are decoded, as on the original keypad
+	bool isKeyPressed(const int key) const {
+		return ((m_keys >> (key & 0xf)) & 1) != 0;
 	}
 
-private:
-	friend class cereal::access;
+	void pokeKey(const int key) {
+		m_keys |= (uint16_t)(1 << key);
+	}
 
-	template<class Archive> void serialize(Archive& archive) {
-		archive(m_raw);
+	void pullKey(const int key) {
+		m_keys &= (uint16_t)~(1 << key);
 	}
 
-	std::unordered_set<SDL_Keycode> m_raw;
+	// Bit n is set while key n is held down
+	uint16_t getKeys() const {
+		return m_keys;
+	}
 
-	// CHIP-8 Keyboard layout
-	//  1   2   3   C
-	//  4   5   6   D
-	//  7   8   9   E
-	//  A   0   B   F
-	std::array<int, 16> m_mapping = { {
-					SDLK_x,
+	void setKeys(const uint16_t keys) {
+		m_keys = keys;
+	}
 
-		SDLK_1,		SDLK_2,		SDLK_3,
-		SDLK_q,     SDLK_w,     SDLK_e,
-		SDLK_a,     SDLK_s,     SDLK_d,
+private:
+	friend class cereal::access;
 
-		SDLK_z,                 SDLK_c,
+	template<class Archive> void serialize(Archive& archive) {
+		archive(m_keys);
+	}
 
-		SDLK_4,
-		SDLK_r,
-		SDLK_f,
-		SDLK_v
-	} };
+	uint16_t m_keys = 0;
 };
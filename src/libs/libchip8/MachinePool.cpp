@@ -0,0 +1,126 @@
+#include "stdafx.h"
+#include "MachinePool.h"
+
+#include "BitmappedGraphics.h"
+#include "Chip8.h"
+#include "ProcessorFactory.h"
+
+MachinePool::MachinePool(const Configuration& configuration, const size_t size)
+: m_processor(ProcessorFactory::buildProcessor(configuration)),
+  m_staging(),
+  m_i(size),
+  m_pc(size),
+  m_sp(size),
+  m_opcode(size),
+  m_delayTimer(size),
+  m_soundTimer(size),
+  m_finished(size),
+  m_soundPlaying(size),
+  m_waitingForKeyPress(size),
+  m_waitingForKeyPressRegister(size, -1),
+  m_keys(size),
+  m_randomNumberGenerators(size),
+  m_calculatorRegisters(size),
+  m_compatibility(size),
+  m_audioPatternBuffers(size),
+  m_highResolution(size),
+  m_planeMask(size),
+  m_dirtyRows(size),
+  m_framebufferWords(BitmappedGraphics::getPackedWords(configuration.getGraphicPlanes())),
+  m_framebuffers(size * m_framebufferWords),
+  m_memories(size) {
+	for (auto& column : m_v)
+		column.resize(size);
+	for (auto& column : m_stack)
+		column.resize(size);
+}
+
+MachinePool::~MachinePool() {}
+
+void MachinePool::reset(const std::string& game, const uint32_t seed) {
+	m_processor->initialise();
+	m_processor->loadGame(game);
+	m_processor->setDrawNeeded(false);	// As if presented
+	m_processor->saveSnapshot(m_staging);
+	for (size_t index = 0; index < size(); ++index) {
+		m_staging.randomNumberGenerator.seed(seed + (uint32_t)index);
+		loadSnapshot(index, m_staging);
+	}
+}
+
+long long MachinePool::runFrame() {
+	long long cycles = 0;
+	for (size_t index = 0; index < size(); ++index) {
+		if (m_finished[index])
+			continue;
+		saveSnapshot(index, m_staging);
+		m_processor->loadSnapshot(m_staging);
+		cycles += m_processor->runFrame();
+		m_processor->updateTimers();
+		m_processor->setDrawNeeded(false);	// As if presented
+		m_processor->saveSnapshot(m_staging);
+		loadSnapshot(index, m_staging);
+	}
+	return cycles;
+}
+
+void MachinePool::saveSnapshot(const size_t index, Snapshot& snapshot) const {
+	for (size_t x = 0; x < m_v.size(); ++x)
+		snapshot.v[x] = m_v[x][index];
+	for (size_t level = 0; level < m_stack.size(); ++level)
+		snapshot.stack[level] = m_stack[level][index];
+	snapshot.i = m_i[index];
+	snapshot.pc = m_pc[index];
+	snapshot.sp = m_sp[index];
+	snapshot.opcode = m_opcode[index];
+	snapshot.delayTimer = m_delayTimer[index];
+	snapshot.soundTimer = m_soundTimer[index];
+	snapshot.finished = m_finished[index] != 0;
+	snapshot.soundPlaying = m_soundPlaying[index] != 0;
+	snapshot.waitingForKeyPress = m_waitingForKeyPress[index] != 0;
+	snapshot.waitingForKeyPressRegister = m_waitingForKeyPressRegister[index];
+	snapshot.keys = m_keys[index];
+	snapshot.randomNumberGenerator = m_randomNumberGenerators[index];
+
+	snapshot.calculatorRegisters = m_calculatorRegisters[index];
+	snapshot.compatibility = m_compatibility[index] != 0;
+	snapshot.audioPatternBuffer = m_audioPatternBuffers[index];
+
+	snapshot.highResolution = m_highResolution[index] != 0;
+	snapshot.planeMask = m_planeMask[index];
+	snapshot.dirtyRows = m_dirtyRows[index];
+	const auto framebuffer = m_framebuffers.begin() + index * m_framebufferWords;
+	snapshot.display.assign(framebuffer, framebuffer + m_framebufferWords);
+
+	snapshot.memory = m_memories[index];
+}
+
+void MachinePool::loadSnapshot(const size_t index, const Snapshot& snapshot) {
+	for (size_t x = 0; x < m_v.size(); ++x)
+		m_v[x][index] = snapshot.v[x];
+	for (size_t level = 0; level < m_stack.size(); ++level)
+		m_stack[level][index] = snapshot.stack[level];
+	m_i[index] = snapshot.i;
+	m_pc[index] = snapshot.pc;
+	m_sp[index] = snapshot.sp;
+	m_opcode[index] = snapshot.opcode;
+	m_delayTimer[index] = snapshot.delayTimer;
+	m_soundTimer[index] = snapshot.soundTimer;
+	m_finished[index] = snapshot.finished;
+	m_soundPlaying[index] = snapshot.soundPlaying;
+	m_waitingForKeyPress[index] = snapshot.waitingForKeyPress;
+	m_waitingForKeyPressRegister[index] = snapshot.waitingForKeyPressRegister;
+	m_keys[index] = snapshot.keys;
+	m_randomNumberGenerators[index] = snapshot.randomNumberGenerator;
+
+	m_calculatorRegisters[index] = snapshot.calculatorRegisters;
+	m_compatibility[index] = snapshot.compatibility;
+	m_audioPatternBuffers[index] = snapshot.audioPatternBuffer;
+
+	m_highResolution[index] = snapshot.highResolution;
+	m_planeMask[index] = snapshot.planeMask;
+	m_dirtyRows[index] = snapshot.dirtyRows;
+	std::copy(snapshot.display.begin(), snapshot.display.end(), m_framebuffers.begin() + index * m_framebufferWords);
+
+	m_memories[index] = snapshot.memory;
+}
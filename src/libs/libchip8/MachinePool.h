@@ -0,0 +1,124 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Configuration.h"
+#include "Memory.h"
+#include "RandomNumberGenerator.h"
+#include "Snapshot.h"
+
+class Chip8;
+
+// Many machines of one configuration running the same program, differing only
+// in input, held as a structure of arrays: each register, the index, program
+// counter, stack level, timer and so on is a column with an entry per machine,
+// and the packed displays sit end to end.  The same register of every machine
+// is contiguous, so the pool can be fed and read without walking it.
+//
+// A frame is run machine by machine on one processor, loaded from the columns
+// and stored back through its snapshots.  Every instruction is executed by the
+// processor's own handlers, so results are bit for bit those of running each
+// machine separately.  Memory pages are shared between machines until written.
+class MachinePool final {
+public:
+	MachinePool(const Configuration& configuration, size_t size);
+	~MachinePool();
+
+	size_t size() const {
+		return m_pc.size();
+	}
+
+	// Every machine starts the game afresh, machine n with its random numbers seeded with seed + n
+	void reset(const std::string& game, uint32_t seed);
+
+	// Runs a frame on every machine that hasn't finished, holding down keys()[n]
+	// on machine n, and takes its display as presented.  Returns the number of
+	// instructions executed.
+	long long runFrame();
+
+	// Keypad masks for the next frame: bit k of entry n holds key k down on machine n
+	const std::vector<uint16_t>& keys() const {
+		return m_keys;
+	}
+
+	std::vector<uint16_t>& keys() {
+		return m_keys;
+	}
+
+	// Non zero for each machine whose program has exited
+	const std::vector<uint8_t>& finished() const {
+		return m_finished;
+	}
+
+	// Register Vx of every machine
+	const std::vector<uint8_t>& registers(int x) const {
+		return m_v[x];
+	}
+
+	const std::vector<uint16_t>& indirectors() const {
+		return m_i;
+	}
+
+	const std::vector<uint16_t>& programCounters() const {
+		return m_pc;
+	}
+
+	const std::vector<uint8_t>& delayTimers() const {
+		return m_delayTimer;
+	}
+
+	const std::vector<uint8_t>& soundTimers() const {
+		return m_soundTimer;
+	}
+
+	// Machine n's display starts at word n * getFramebufferWords(), as packed by BitmappedGraphics::pack
+	const std::vector<uint64_t>& framebuffers() const {
+		return m_framebuffers;
+	}
+
+	size_t getFramebufferWords() const {
+		return m_framebufferWords;
+	}
+
+	// The whole of one machine, as a processor would save or load it
+	void saveSnapshot(size_t index, Snapshot& snapshot) const;
+	void loadSnapshot(size_t index, const Snapshot& snapshot);
+
+private:
+	std::unique_ptr<Chip8> m_processor;	// Runs each machine in turn
+	Snapshot m_staging;
+
+	// Processor
+	std::array<std::vector<uint8_t>, 16> m_v;	// By register, then machine
+	std::array<std::vector<uint16_t>, 16> m_stack;	// By level, then machine
+	std::vector<uint16_t> m_i;
+	std::vector<uint16_t> m_pc;
+	std::vector<uint16_t> m_sp;
+	std::vector<uint16_t> m_opcode;
+	std::vector<uint8_t> m_delayTimer;
+	std::vector<uint8_t> m_soundTimer;
+	std::vector<uint8_t> m_finished;
+	std::vector<uint8_t> m_soundPlaying;
+	std::vector<uint8_t> m_waitingForKeyPress;
+	std::vector<int> m_waitingForKeyPressRegister;
+	std::vector<uint16_t> m_keys;
+	std::vector<RandomNumberGenerator> m_randomNumberGenerators;
+
+	// Super-Chip and XO-Chip
+	std::vector<std::array<uint8_t, 8>> m_calculatorRegisters;
+	std::vector<uint8_t> m_compatibility;
+	std::vector<std::array<uint8_t, 16>> m_audioPatternBuffers;
+
+	// Display
+	std::vector<uint8_t> m_highResolution;
+	std::vector<int> m_planeMask;
+	std::vector<uint64_t> m_dirtyRows;
+	size_t m_framebufferWords;
+	std::vector<uint64_t> m_framebuffers;
+
+	std::vector<Memory::pages_t> m_memories;
+};
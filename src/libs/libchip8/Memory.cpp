@@ -2,23 +2,43 @@
 #include "Memory.h"
 
 #include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <fstream>
 
 Memory::Memory(int size)
-: m_bus(size) {
+: m_size(size),
+  m_pages((size + PageMask) >> PageShift, zeroPage()),
+  m_instructions(m_pages.size()),
+  m_pageModified(m_pages.size()) {
 }
 
-const std::vector<uint8_t>& Memory::bus() const {
-	return m_bus;
+Memory::Memory(const Memory& rhs)
+: m_size(rhs.m_size),
+  m_pages(rhs.m_pages),
+  m_instructions(rhs.m_instructions.size()),
+  m_pageModified(rhs.m_pageModified.size()) {
+	// Whatever the copy is assigned over may have translated code from it, so every page is suspect
+	invalidateInstructions();
 }
 
-std::vector<uint8_t>& Memory::bus() {
-	return m_bus;
+Memory& Memory::operator=(const Memory& rhs) {
+	if (this != &rhs)
+		*this = Memory(rhs);
+	return *this;
 }
 
-uint8_t Memory::get(int address) const {
-	return m_bus[address];
+const std::shared_ptr<Memory::page_t>& Memory::zeroPage() {
+	// Always shared, so never written to
+	static const auto page = std::make_shared<page_t>(page_t());
+	return page;
+}
+
+Memory::page_t& Memory::writablePage(int address) {
+	auto& page = m_pages[address >> PageShift];
+	if (page.use_count() > 1)
+		page = std::make_shared<page_t>(*page);
+	return *page;
 }
 
 uint16_t Memory::getWord(int address) const {
@@ -27,8 +47,20 @@ uint16_t Memory::getWord(int address) const {
 	return (high << 8) + low;
 }
 
+void Memory::get(int address, uint8_t* values, size_t count) const {
+	while (count > 0) {
+		const auto& page = *m_pages[address >> PageShift];
+		const auto offset = address & PageMask;
+		const auto length = std::min(count, (size_t)(PageSize - offset));
+		values = std::copy_n(page.cbegin() + offset, length, values);
+		address += (int)length;
+		count -= length;
+	}
+}
+
 void Memory::set(int address, uint8_t value) {
-	m_bus[address] = value;
+	writablePage(address)[address & PageMask] = value;
+	invalidateInstruction(address);
 }
 
 void Memory::setWord(int address, uint16_t value) {
@@ -36,8 +68,64 @@ void Memory::setWord(int address, uint16_t value) {
 	set(address + 1, value & 0xFF);
 }
 
+void Memory::set(int address, const uint8_t* values, size_t count) {
+	for (size_t i = 0; i < count; ++i)
+		invalidateInstruction(address + (int)i);
+	while (count > 0) {
+		auto& page = writablePage(address);
+		const auto offset = address & PageMask;
+		const auto length = std::min(count, (size_t)(PageSize - offset));
+		std::copy_n(values, length, page.begin() + offset);
+		values += length;
+		address += (int)length;
+		count -= length;
+	}
+}
+
+void Memory::restore(const pages_t& pages) {
+	if (pages.size() != m_pages.size())
+		throw std::runtime_error("Memory image is the wrong size");
+	for (size_t index = 0; index < pages.size(); ++index) {
+		auto& page = m_pages[index];
+		const auto& replacement = pages[index];
+		if (page == replacement)
+			continue;
+		if (*page != *replacement) {
+			const auto start = (int)(index << PageShift);
+			const auto end = std::min(start + (int)PageSize, size());
+			for (auto address = start; address < end; address += 2)
+				invalidateInstruction(address);
+		}
+		page = replacement;
+	}
+}
+
 void Memory::clear() {
-	std::fill(m_bus.begin(), m_bus.end(), (uint8_t)0U);
+	std::fill(m_pages.begin(), m_pages.end(), zeroPage());
+	invalidateInstructions();
+}
+
+// Decoded pages are cleared in place rather than freed, so that they aren't allocated again
+void Memory::invalidateInstructions() {
+	for (auto& instructions : m_instructions) {
+		if (instructions)
+			instructions->fill(Instruction());
+	}
+	for (size_t page = 0; page < m_pages.size(); ++page)
+		setPageModified((int)page);
+}
+
+void Memory::setPageModified(const int page) {
+	if (!m_pageModified[page]) {
+		m_pageModified[page] = true;
+		m_modifiedPages.push_back(page);
+	}
+}
+
+void Memory::clearCodeModified() {
+	for (const auto page : m_modifiedPages)
+		m_pageModified[page] = false;
+	m_modifiedPages.clear();
 }
 
 void Memory::loadRom(const std::string& path, uint16_t offset) {
@@ -61,9 +149,10 @@ void Memory::loadRom(const std::string& path, uint16_t offset) {
 		header = 13;
 
 	size_t extent = size + offset - header;
-	if (m_bus.size() < extent) {
+	if ((size_t)m_size < extent) {
 		throw std::runtime_error("Game is too large (is this an XoChip game?)");
 	}
 
-	std::copy(buffer.cbegin() + header, buffer.cend(), m_bus.begin() + offset);
+	set(offset, (const uint8_t*)buffer.data() + header, size - header);
+	invalidateInstructions();
 }
@@ -1,26 +1,92 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "Instruction.h"
+
 namespace cereal {
 	class access;
 }
 
+// Memory is held in pages that copies share until one of them writes to a
+// page, at which point the writer takes a copy of its own.  Predecoded
+// instructions are kept by page too, allocated when code in the page is first
+// fetched, but are never copied: copying a memory, e.g. when a machine is
+// cloned, costs a reference and an empty slot per page however large the
+// address space, and the copy decodes whatever it runs afresh, with every
+// page reported as modified.  Untouched pages stay shared for good.
 class Memory final {
 public:
+	enum {
+		PageShift = 8,
+		PageSize = 1 << PageShift,
+		PageMask = PageSize - 1
+	};
+
+	typedef std::array<uint8_t, PageSize> page_t;
+	typedef std::vector<std::shared_ptr<page_t>> pages_t;
+
 	Memory() noexcept {}
 	Memory(int size);
 
-	const std::vector<uint8_t>& bus() const;
-	std::vector<uint8_t>& bus();
+	Memory(const Memory& rhs);
+	Memory& operator=(const Memory& rhs);
+	Memory(Memory&& rhs) = default;
+	Memory& operator=(Memory&& rhs) = default;
+
+	int size() const {
+		return m_size;
+	}
+
+	// Shared with any copies: never written through
+	const pages_t& pages() const {
+		return m_pages;
+	}
+
+	uint8_t get(int address) const {
+		return (*m_pages[address >> PageShift])[address & PageMask];
+	}
 
-	uint8_t get(int address) const;
 	uint16_t getWord(int address) const;
+	void get(int address, uint8_t* values, size_t count) const;
+
+	// Writes must go through set/setWord, so that shared pages are copied and
+	// predecoded instructions are invalidated when the code underneath them changes.
 
 	void set(int address, uint8_t value);
 	void setWord(int address, uint16_t value);
+	void set(int address, const uint8_t* values, size_t count);
+
+	// The predecoded instruction slot for an even address
+	Instruction& instruction(int address) {
+		auto& instructions = m_instructions[address >> PageShift];
+		if (!instructions)
+			instructions.reset(new instructions_t());
+		return (*instructions)[(address & PageMask) >> 1];
+	}
+
+	// Set when a write lands on an instruction that has already been decoded
+	bool getCodeModified() const {
+		return !m_modifiedPages.empty();
+	}
+
+	// The pages holding those instructions, each listed once
+	const std::vector<int>& getModifiedPages() const {
+		return m_modifiedPages;
+	}
+
+	void clearCodeModified();
+
+	// Forces every instruction to be decoded again
+	void invalidateInstructions();
+
+	// Shares the pages of another memory of the same size, e.g. from a
+	// snapshot.  Only instructions in pages whose contents differ are invalidated.
+	void restore(const pages_t& pages);
 
 	void clear();
 	void loadRom(const std::string& path, uint16_t offset);
@@ -28,9 +94,43 @@ public:
 private:
 	friend class cereal::access;
 
-	template<class Archive> void serialize(Archive& archive) {
-		archive(m_bus);
+	template<class Archive> void save(Archive& archive) const {
+		std::vector<uint8_t> bus(size());
+		get(0, bus.data(), bus.size());
+		archive(bus);
+	}
+
+	template<class Archive> void load(Archive& archive) {
+		std::vector<uint8_t> bus;
+		archive(bus);
+		*this = Memory((int)bus.size());
+		set(0, bus.data(), bus.size());
+		invalidateInstructions();
 	}
 
-	std::vector<uint8_t> m_bus;
+	typedef std::array<Instruction, PageSize / 2> instructions_t;
+
+	int m_size = 0;
+	pages_t m_pages;
+	std::vector<std::unique_ptr<instructions_t>> m_instructions;	// By page: null until code there is fetched
+	std::vector<int> m_modifiedPages;
+	std::vector<bool> m_pageModified;
+
+	static const std::shared_ptr<page_t>& zeroPage();
+
+	// The page holding an address, copied first if anyone else shares it
+	page_t& writablePage(int address);
+
+	void setPageModified(int page);
+
+	void invalidateInstruction(int address) {
+		const auto& instructions = m_instructions[address >> PageShift];
+		if (!instructions)
+			return;
+		auto& instruction = (*instructions)[(address & PageMask) >> 1];
+		if (instruction.isDecoded()) {
+			instruction.handler = nullptr;
+			setPageModified(address >> PageShift);
+		}
+	}
 };
@@ -0,0 +1,186 @@
+#include "stdafx.h"
+#include "Movie.h"
+
+#include "Chip8.h"
+
+// File layout, all little endian:
+//	"C8MV", version (u16)
+//	configuration, seed (u32)
+//	ROM length (u32), ROM
+//	frames (u32), runs of keys (u32 count of runs, then u32 length and u16 mask for each)
+//	checkpoints (u32 count, then u64 each), final hash (u64)
+
+namespace {
+
+	const char Magic[4] = { 'C', '8', 'M', 'V' };
+	const uint16_t Version = 2;	// 1: RND drawn from a Mersenne Twister
+
+	template<class T> void write(std::ostream& output, const T value) {
+		const auto bits = (uint64_t)value;
+		for (size_t byte = 0; byte < sizeof(T); ++byte)
+			output.put((char)((bits >> (8 * byte)) & 0xff));
+	}
+
+	template<class T> T read(std::istream& input) {
+		T value = 0;
+		for (size_t byte = 0; byte < sizeof(T); ++byte)
+			value |= (T)((uint64_t)(uint8_t)input.get() << (8 * byte));
+		return value;
+	}
+
+	void writeConfiguration(std::ostream& output, const Configuration& configuration) {
+		write<uint8_t>(output, (uint8_t)configuration.getType());
+		write<uint8_t>(output, configuration.getAllowMisalignedOpcodes());
+		write<uint8_t>(output, configuration.getTranslateBlocks());
+		write<int32_t>(output, configuration.getFramesPerSecond());
+		write<int32_t>(output, configuration.getCyclesPerFrame());
+		write<uint16_t>(output, configuration.getStartAddress());
+		write<uint16_t>(output, configuration.getLoadAddress());
+		write<int32_t>(output, configuration.getMemorySize());
+		write<int32_t>(output, configuration.getGraphicPlanes());
+		write<uint8_t>(output, configuration.getGraphicsClip());
+		write<uint8_t>(output, configuration.getGraphicsCountExceededRows());
+		write<uint8_t>(output, configuration.getGraphicsCountRowHits());
+		write<uint8_t>(output, configuration.getChip8Shifts());
+		write<uint8_t>(output, configuration.getChip8LoadAndSave());
+		write<uint8_t>(output, configuration.getChip8IndexedJumps());
+	}
+
+	Configuration readConfiguration(std::istream& input) {
+		Configuration configuration;
+		configuration.setType((ProcessorLevel)read<uint8_t>(input));
+		configuration.setAllowMisalignedOpcodes(read<uint8_t>(input) != 0);
+		configuration.setTranslateBlocks(read<uint8_t>(input) != 0);
+		configuration.setFramesPerSecond(read<int32_t>(input));
+		configuration.setCyclesPerFrame(read<int32_t>(input));
+		configuration.setStartAddress(read<uint16_t>(input));
+		configuration.setLoadAddress(read<uint16_t>(input));
+		configuration.setMemorySize(read<int32_t>(input));
+		configuration.setGraphicPlanes(read<int32_t>(input));
+		configuration.setGraphicsClip(read<uint8_t>(input) != 0);
+		configuration.setGraphicsCountExceededRows(read<uint8_t>(input) != 0);
+		configuration.setGraphicsCountRowHits(read<uint8_t>(input) != 0);
+		configuration.setChip8Shifts(read<uint8_t>(input) != 0);
+		configuration.setChip8LoadAndSave(read<uint8_t>(input) != 0);
+		configuration.setChip8IndexedJumps(read<uint8_t>(input) != 0);
+		return configuration;
+	}
+}
+
+void Movie::start(const Chip8& processor) {
+	m_configuration = processor.configuration();
+	m_seed = processor.getRandomSeed();
+
+	const auto& memory = processor.memory();
+	const auto start = m_configuration.getLoadAddress();
+	auto end = memory.size();
+	while ((end > start) && (memory.get(end - 1) == 0))
+		--end;
+	m_rom.resize(end - start);
+	memory.get(start, m_rom.data(), m_rom.size());
+
+	m_keys.clear();
+	m_checkpoints.clear();
+	m_final = processor.display().hash();
+}
+
+void Movie::record(const uint16_t keys, const Chip8& processor) {
+	m_keys.push_back(keys);
+	m_final = processor.display().hash();
+	if ((m_keys.size() % CheckpointInterval) == 0)
+		m_checkpoints.push_back(m_final);
+}
+
+void Movie::truncate(const int frames) {
+	if (frames >= getFrames())
+		return;
+	m_keys.resize(frames);
+	m_checkpoints.resize(frames / CheckpointInterval);
+	m_final = 0;	// Unknown until the next frame is recorded
+}
+
+void Movie::prepare(Chip8& processor) const {
+	processor.initialise();
+	processor.seedRandomNumbers(m_seed);
+	processor.memory().set(m_configuration.getLoadAddress(), m_rom.data(), m_rom.size());
+}
+
+bool Movie::verify(const int frame, const Chip8& processor) const {
+	const auto hash = processor.display().hash();
+	if ((frame == (getFrames() - 1)) && (m_final != 0) && (hash != m_final))
+		return false;
+	const auto checkpoint = (size_t)(frame + 1) / CheckpointInterval;
+	if ((((frame + 1) % CheckpointInterval) == 0) && (checkpoint <= m_checkpoints.size()))
+		return hash == m_checkpoints[checkpoint - 1];
+	return true;
+}
+
+void Movie::save(const std::string& path) const {
+	std::ofstream output;
+	output.exceptions(std::ios::failbit | std::ios::badbit);
+	output.open(path, std::ios::binary);
+
+	output.write(Magic, sizeof(Magic));
+	write<uint16_t>(output, Version);
+
+	writeConfiguration(output, m_configuration);
+	write<uint32_t>(output, m_seed);
+
+	write<uint32_t>(output, (uint32_t)m_rom.size());
+	output.write((const char*)m_rom.data(), m_rom.size());
+
+	std::vector<std::pair<uint32_t, uint16_t>> runs;
+	for (const auto keys : m_keys) {
+		if (runs.empty() || (runs.back().second != keys))
+			runs.emplace_back(0, keys);
+		++runs.back().first;
+	}
+	write<uint32_t>(output, (uint32_t)m_keys.size());
+	write<uint32_t>(output, (uint32_t)runs.size());
+	for (const auto& run : runs) {
+		write<uint32_t>(output, run.first);
+		write<uint16_t>(output, run.second);
+	}
+
+	write<uint32_t>(output, (uint32_t)m_checkpoints.size());
+	for (const auto checkpoint : m_checkpoints)
+		write<uint64_t>(output, checkpoint);
+	write<uint64_t>(output, m_final);
+}
+
+void Movie::load(const std::string& path) {
+	std::ifstream input;
+	input.exceptions(std::ios::failbit | std::ios::badbit | std::ios::eofbit);
+	input.open(path, std::ios::binary);
+
+	char magic[sizeof(Magic)];
+	input.read(magic, sizeof(magic));
+	if (!std::equal(magic, magic + sizeof(magic), Magic))
+		throw std::runtime_error("Not a movie file: " + path);
+	if (read<uint16_t>(input) != Version)
+		throw std::runtime_error("Unsupported movie version: " + path);
+
+	m_configuration = readConfiguration(input);
+	m_seed = read<uint32_t>(input);
+
+	m_rom.resize(read<uint32_t>(input));
+	input.read((char*)m_rom.data(), m_rom.size());
+
+	const auto frames = read<uint32_t>(input);
+	if (frames == 0)
+		throw std::runtime_error("Movie has no frames: " + path);
+	m_keys.clear();
+	m_keys.reserve(frames);
+	for (auto runs = read<uint32_t>(input); runs > 0; --runs) {
+		const auto length = read<uint32_t>(input);
+		const auto keys = read<uint16_t>(input);
+		m_keys.insert(m_keys.end(), length, keys);
+	}
+	if (m_keys.size() != frames)
+		throw std::runtime_error("Movie frames don't add up: " + path);
+
+	m_checkpoints.resize(read<uint32_t>(input));
+	for (auto& checkpoint : m_checkpoints)
+		checkpoint = read<uint64_t>(input);
+	m_final = read<uint64_t>(input);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Configuration.h"
+
+class Chip8;
+
+// A recording of a run: the configuration, random number seed and ROM it
+// started from, and the keypad mask held for every frame after.  Replaying
+// one on a fresh machine reproduces the run exactly, which the display hashes
+// taken every CheckpointInterval frames (and on the last) let a replay check.
+//
+// A frame here is what the front ends run: set the keys, run a frame, update
+// the timers and take the display as presented.
+class Movie final {
+public:
+	enum {
+		CheckpointInterval = 60
+	};
+
+	// Recording
+
+	// From a machine that has just been initialised and loaded
+	void start(const Chip8& processor);
+
+	// After each frame, with the keys it ran with
+	void record(uint16_t keys, const Chip8& processor);
+
+	// Forgets every frame from "frames" on, e.g. after rewinding
+	void truncate(int frames);
+
+	// Replay
+
+	// Initialises, seeds and loads a machine built from configuration()
+	void prepare(Chip8& processor) const;
+
+	uint16_t getKeys(int frame) const {
+		return m_keys[frame];
+	}
+
+	// After running a frame: false if the display differs from the recording
+	bool verify(int frame, const Chip8& processor) const;
+
+	// Either
+
+	const Configuration& configuration() const {
+		return m_configuration;
+	}
+
+	uint32_t getSeed() const {
+		return m_seed;
+	}
+
+	int getFrames() const {
+		return (int)m_keys.size();
+	}
+
+	void save(const std::string& path) const;
+	void load(const std::string& path);
+
+private:
+	Configuration m_configuration;
+	uint32_t m_seed = 0;
+	std::vector<uint8_t> m_rom;	// Memory from the load address on, without trailing zeros
+
+	std::vector<uint16_t> m_keys;	// One per frame
+	std::vector<uint64_t> m_checkpoints;	// Display hash after frames CheckpointInterval - 1, 2 * CheckpointInterval - 1, ...
+	uint64_t m_final = 0;	// Display hash after the last frame
+};
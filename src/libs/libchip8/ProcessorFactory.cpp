@@ -0,0 +1,36 @@
+#include "stdafx.h"
+#include "ProcessorFactory.h"
+
+#include "Chip8.h"
+#include "Schip.h"
+#include "XoChip.h"
+
+#include "Configuration.h"
+
+Chip8* ProcessorFactory::buildProcessor(const Configuration& configuration) {
+
+	auto memorySize = configuration.getMemorySize();
+	Memory memory(memorySize);
+
+	auto graphicsPlanes = configuration.getGraphicPlanes();
+	auto graphicsClip = configuration.getGraphicsClip();
+	auto graphicsCountExceededRows = configuration.getGraphicsCountExceededRows();
+	auto graphicsCountRowHits = configuration.getGraphicsCountRowHits();
+	BitmappedGraphics graphics(graphicsPlanes, graphicsClip, graphicsCountExceededRows, graphicsCountRowHits);
+
+	KeyboardDevice keyboard;
+
+	switch (configuration.getType()) {
+	case chip8:
+		return new Chip8(memory, keyboard, graphics, configuration);
+
+	case superChip:
+		return new Schip(memory, keyboard, graphics, configuration);
+
+	case xoChip:
+		return new XoChip(memory, keyboard, graphics, configuration);
+
+	default:
+		throw std::logic_error("Whoops: unknown processor type.");
+	}
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+class Chip8;
+class Configuration;
+
+class ProcessorFactory final {
+public:
+	// The caller owns the processor, which matches the configured type
+	static Chip8* buildProcessor(const Configuration& configuration);
+};
@@ -0,0 +1,180 @@
+#include "stdafx.h"
+#include "Profiler.h"
+
+#include <unordered_map>
+
+Profiler::Profiler()
+: m_addresses(0x10000),
+  m_opcodes(0x10000) {}
+
+bool Profiler::isCompiledIn() {
+#ifdef CHIP8_PROFILING
+	return true;
+#else
+	return false;
+#endif
+}
+
+uint64_t Profiler::getInstructions() const {
+	uint64_t total = 0;
+	for (const auto count : m_opcodes)
+		total += count;
+	return total;
+}
+
+std::vector<std::pair<std::string, uint64_t>> Profiler::opcodeClasses() const {
+	std::unordered_map<std::string, uint64_t> classes;
+	for (size_t opcode = 0; opcode < m_opcodes.size(); ++opcode) {
+		if (m_opcodes[opcode] > 0)
+			classes[getClass((uint16_t)opcode)] += m_opcodes[opcode];
+	}
+	std::vector<std::pair<std::string, uint64_t>> sorted(classes.begin(), classes.end());
+	std::sort(sorted.begin(), sorted.end(), [](const std::pair<std::string, uint64_t>& lhs, const std::pair<std::string, uint64_t>& rhs) {
+		return lhs.second != rhs.second ? lhs.second > rhs.second : lhs.first < rhs.first;
+	});
+	return sorted;
+}
+
+std::vector<std::pair<uint16_t, uint64_t>> Profiler::addresses() const {
+	std::vector<std::pair<uint16_t, uint64_t>> sorted;
+	for (size_t address = 0; address < m_addresses.size(); ++address) {
+		if (m_addresses[address] > 0)
+			sorted.emplace_back((uint16_t)address, m_addresses[address]);
+	}
+	std::stable_sort(sorted.begin(), sorted.end(), [](const std::pair<uint16_t, uint64_t>& lhs, const std::pair<uint16_t, uint64_t>& rhs) {
+		return lhs.second > rhs.second;
+	});
+	return sorted;
+}
+
+// Named as the opcode tables name them, whichever processor the opcode was run on
+std::string Profiler::getClass(const uint16_t opcode) {
+	const auto nn = opcode & 0xff;
+	const auto n = opcode & 0xf;
+	switch (opcode & 0xf000) {
+	case 0x0000:
+		if ((opcode & 0xfff0) == 0x00c0)
+			return "00CN";
+		if ((opcode & 0xfff0) == 0x00d0)
+			return "00DN";
+		if ((opcode == 0x00e0) || (opcode == 0x00ee) || ((opcode >= 0x00fa) && (opcode <= 0x00ff)))
+			return (boost::format("%04X") % opcode).str();
+		return "0NNN";
+	case 0x1000:
+		return "1NNN";
+	case 0x2000:
+		return "2NNN";
+	case 0x3000:
+		return "3XNN";
+	case 0x4000:
+		return "4XNN";
+	case 0x5000:
+		return (boost::format("5XY%1X") % n).str();
+	case 0x6000:
+		return "6XNN";
+	case 0x7000:
+		return "7XNN";
+	case 0x8000:
+		return (boost::format("8XY%1X") % n).str();
+	case 0x9000:
+		return (boost::format("9XY%1X") % n).str();
+	case 0xa000:
+		return "ANNN";
+	case 0xb000:
+		return "BNNN";
+	case 0xc000:
+		return "CXNN";
+	case 0xd000:
+		return "DXYN";
+	case 0xe000:
+		return (boost::format("EX%02X") % nn).str();
+	default:
+		if ((opcode == 0xf000) || (opcode == 0xf002))
+			return (boost::format("%04X") % opcode).str();
+		if (nn == 0x01)
+			return "FN01";
+		return (boost::format("FX%02X") % nn).str();
+	}
+}
+
+const char* Profiler::getName(const Section section) {
+	switch (section) {
+	case Draw:
+		return "draw";
+	case Scroll:
+		return "scroll";
+	case Timers:
+		return "timers";
+	default:
+		return "unknown";
+	}
+}
+
+void Profiler::writeJson(std::ostream& output) const {
+
+	const auto instructions = getInstructions();
+	output
+		<< "{\n"
+		<< "\t\"instructions\": " << instructions << ",\n";
+
+	output << "\t\"opcodes\": [";
+	auto first = true;
+	for (const auto& entry : opcodeClasses()) {
+		output << (first ? "\n" : ",\n") << "\t\t{ \"class\": \"" << entry.first << "\", \"count\": " << entry.second << " }";
+		first = false;
+	}
+	output << "\n\t],\n";
+
+	output << "\t\"addresses\": [";
+	first = true;
+	for (const auto& entry : addresses()) {
+		output << (first ? "\n" : ",\n") << "\t\t{ \"address\": " << entry.first << ", \"count\": " << entry.second << " }";
+		first = false;
+	}
+	output << "\n\t],\n";
+
+	output << "\t\"sections\": {";
+	for (int section = 0; section < NumberOfSections; ++section) {
+		const auto& timing = m_sections[section];
+		output
+			<< (section == 0 ? "\n" : ",\n")
+			<< "\t\t\"" << getName((Section)section) << "\": { \"calls\": " << timing.calls << ", \"nanoseconds\": " << timing.nanoseconds << " }";
+	}
+	output << "\n\t}\n";
+
+	output << "}\n";
+}
+
+void Profiler::writeTable(std::ostream& output, const size_t limit) const {
+
+	const auto instructions = getInstructions();
+	const auto share = [instructions](uint64_t count) {
+		return instructions == 0 ? 0.0 : 100.0 * count / instructions;
+	};
+
+	output << boost::format("%d instructions\n\n") % instructions;
+
+	boost::format opcodeRow("%-8s %14d %7.2f%%\n");
+	output << boost::format("%-8s %14s %8s\n") % "Opcode" % "Count" % "Share";
+	const auto classes = opcodeClasses();
+	for (size_t row = 0; (row < classes.size()) && (row < limit); ++row)
+		output << opcodeRow % classes[row].first % classes[row].second % share(classes[row].second);
+	if (classes.size() > limit)
+		output << boost::format("(%d more)\n") % (classes.size() - limit);
+
+	boost::format addressRow("%04X     %14d %7.2f%%\n");
+	output << boost::format("\n%-8s %14s %8s\n") % "Address" % "Count" % "Share";
+	const auto executed = addresses();
+	for (size_t row = 0; (row < executed.size()) && (row < limit); ++row)
+		output << addressRow % executed[row].first % executed[row].second % share(executed[row].second);
+	if (executed.size() > limit)
+		output << boost::format("(%d more)\n") % (executed.size() - limit);
+
+	boost::format sectionRow("%-8s %14d %12.3f %12.0f\n");
+	output << boost::format("\n%-8s %14s %12s %12s\n") % "Section" % "Calls" % "Total ms" % "ns/call";
+	for (int section = 0; section < NumberOfSections; ++section) {
+		const auto& timing = m_sections[section];
+		const auto perCall = timing.calls == 0 ? 0.0 : (double)timing.nanoseconds / timing.calls;
+		output << sectionRow % getName((Section)section) % timing.calls % (timing.nanoseconds / 1e6) % perCall;
+	}
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Counts the instructions a processor executes, by address and by opcode, and
+// the time it spends drawing, scrolling and updating its timers.  Nothing is
+// counted unless libchip8 is built with CHIP8_PROFILING ("make profile"); without
+// it, the hooks in the processor compile to nothing.
+//
+// Counting is two increments per instruction: opcodes are only sorted into
+// their classes (8XY4, DXYN, FX33, ...) when a report is asked for.
+class Profiler final {
+public:
+	enum Section {
+		Draw,
+		Scroll,
+		Timers,
+		NumberOfSections
+	};
+
+	struct Timing {
+		uint64_t calls = 0;
+		uint64_t nanoseconds = 0;
+	};
+
+	// Times a section from construction to destruction, if there's a profiler to add it to
+	class Scope final {
+	public:
+		Scope(Profiler* profiler, Section section)
+		: m_profiler(profiler),
+		  m_section(section) {
+			if (m_profiler != nullptr)
+				m_started = std::chrono::steady_clock::now();
+		}
+
+		~Scope() {
+			if (m_profiler != nullptr)
+				m_profiler->addTime(m_section, std::chrono::steady_clock::now() - m_started);
+		}
+
+	private:
+		Profiler* m_profiler;
+		Section m_section;
+		std::chrono::steady_clock::time_point m_started;
+	};
+
+	Profiler();
+
+	// Whether libchip8 was built to count anything
+	static bool isCompiledIn();
+
+	void count(const uint16_t programCounter, const uint16_t opcode) {
+		++m_addresses[programCounter];
+		++m_opcodes[opcode];
+	}
+
+	void addTime(const Section section, const std::chrono::steady_clock::duration elapsed) {
+		auto& timing = m_sections[section];
+		++timing.calls;
+		timing.nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+	}
+
+	uint64_t getInstructions() const;
+
+	// Most executed first, leaving out whatever never ran
+	std::vector<std::pair<std::string, uint64_t>> opcodeClasses() const;
+	std::vector<std::pair<uint16_t, uint64_t>> addresses() const;
+
+	const Timing& timing(const Section section) const {
+		return m_sections[section];
+	}
+
+	static std::string getClass(uint16_t opcode);
+	static const char* getName(Section section);
+
+	void writeJson(std::ostream& output) const;
+
+	// At most "limit" rows of each of the opcode and address tables
+	void writeTable(std::ostream& output, size_t limit = 20) const;
+
+private:
+	std::vector<uint64_t> m_addresses;	// By program counter
+	std::vector<uint64_t> m_opcodes;	// By the whole opcode
+	std::array<Timing, NumberOfSections> m_sections;
+};
+
+// Times the rest of the enclosing block as a section of the processor's profile
+#ifdef CHIP8_PROFILING
+#	define CHIP8_PROFILE_SECTION(processor, section) Profiler::Scope profiledSection((processor).profiler(), Profiler::section)
+#else
+#	define CHIP8_PROFILE_SECTION(processor, section)
+#endif
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// xoshiro128** (Blackman & Vigna): sixteen bytes of state, a handful of
+// shifts and rotates per number, and good enough statistics for games.
+// The state is plain data, so it can be copied into snapshots and movies.
+class Xoshiro128 final {
+public:
+	Xoshiro128() {
+		seed(0);
+	}
+
+	// Spreads the seed over the state with SplitMix32, which never leaves
+	// it all zeros
+	void seed(uint32_t value) {
+		for (auto& word : m_state) {
+			value += 0x9e3779b9;
+			auto mixed = value;
+			mixed = (mixed ^ (mixed >> 16)) * 0x85ebca6b;
+			mixed = (mixed ^ (mixed >> 13)) * 0xc2b2ae35;
+			word = mixed ^ (mixed >> 16);
+		}
+	}
+
+	uint32_t next() {
+		const auto result = rotate(m_state[1] * 5, 7) * 9;
+		const auto t = m_state[1] << 9;
+		m_state[2] ^= m_state[0];
+		m_state[3] ^= m_state[1];
+		m_state[1] ^= m_state[2];
+		m_state[0] ^= m_state[3];
+		m_state[2] ^= t;
+		m_state[3] = rotate(m_state[3], 11);
+		return result;
+	}
+
+	// The top bits are the strongest
+	uint8_t nextByte() {
+		return (uint8_t)(next() >> 24);
+	}
+
+	bool operator==(const Xoshiro128& rhs) const {
+		return m_state == rhs.m_state;
+	}
+
+	bool operator!=(const Xoshiro128& rhs) const {
+		return !(*this == rhs);
+	}
+
+private:
+	std::array<uint32_t, 4> m_state;
+
+	static uint32_t rotate(uint32_t value, int count) {
+		return (value << count) | (value >> (32 - count));
+	}
+};
+
+// The generator behind RND.  Any replacement needs seed(uint32_t) and
+// nextByte(), and must be trivially copyable, as snapshots and the rewind
+// buffer copy it as bytes.
+typedef Xoshiro128 RandomNumberGenerator;
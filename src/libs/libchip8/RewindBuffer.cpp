@@ -0,0 +1,230 @@
+#include "stdafx.h"
+#include "RewindBuffer.h"
+
+#include <cstring>
+#include <type_traits>
+
+#include "Chip8.h"
+
+namespace {
+
+	template<class T> void put(std::vector<uint8_t>& image, const T& value) {
+		static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be flattened");
+		const auto bytes = reinterpret_cast<const uint8_t*>(&value);
+		image.insert(image.end(), bytes, bytes + sizeof(T));
+	}
+
+	template<class T> void take(const std::vector<uint8_t>& image, size_t& offset, T& value) {
+		static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be flattened");
+		std::memcpy(&value, &image[offset], sizeof(T));
+		offset += sizeof(T);
+	}
+
+	void putCount(std::vector<uint8_t>& delta, size_t count) {
+		while (count >= 0x80) {
+			delta.push_back((uint8_t)(count | 0x80));
+			count >>= 7;
+		}
+		delta.push_back((uint8_t)count);
+	}
+
+	size_t takeCount(const std::vector<uint8_t>& delta, size_t& offset) {
+		size_t count = 0;
+		for (int shift = 0; ; shift += 7) {
+			const auto byte = delta[offset++];
+			count |= (size_t)(byte & 0x7f) << shift;
+			if ((byte & 0x80) == 0)
+				return count;
+		}
+	}
+}
+
+RewindBuffer::RewindBuffer(const size_t capacity, const size_t keyframeInterval)
+: m_capacity(capacity),
+  m_keyframeInterval(std::max(keyframeInterval, (size_t)1)) {
+}
+
+size_t RewindBuffer::getBytes() const {
+	auto bytes = m_newest.size();
+	for (const auto& keyframe : m_keyframes) {
+		bytes += keyframe.delta.size();
+		for (const auto& frame : keyframe.frames)
+			bytes += frame.size();
+	}
+	return bytes;
+}
+
+void RewindBuffer::clear() {
+	m_keyframes.clear();
+	m_newest.clear();
+	m_size = 0;
+}
+
+void RewindBuffer::record(const Chip8& processor) {
+	if (m_capacity == 0)
+		return;
+
+	if (m_size == m_capacity) {
+		m_size -= 1 + m_keyframes.front().frames.size();
+		m_keyframes.pop_front();
+	}
+
+	processor.saveSnapshot(m_snapshot);
+	flatten(m_snapshot, m_image);
+
+	if (m_keyframes.empty() || ((m_keyframes.back().frames.size() + 1) >= m_keyframeInterval)) {
+		if (!m_keyframes.empty())
+			encode(m_newest, m_image, m_keyframes.back().delta);
+		m_keyframes.emplace_back();
+		m_newest.swap(m_image);
+	} else {
+		auto& frames = m_keyframes.back().frames;
+		frames.emplace_back();
+		encode(m_image, m_newest, frames.back());
+	}
+	++m_size;
+}
+
+bool RewindBuffer::rewind(Chip8& processor) {
+	if (empty())
+		return false;
+
+	auto& newest = m_keyframes.back();
+	if (!newest.frames.empty()) {
+		decode(newest.frames.back(), m_newest, m_image);
+		newest.frames.pop_back();
+		restore(m_image, processor);
+	} else {
+		restore(m_newest, processor);
+		m_keyframes.pop_back();
+		if (!m_keyframes.empty()) {
+			auto& previous = m_keyframes.back();
+			decode(previous.delta, m_newest, m_image);
+			m_newest.swap(m_image);
+			previous.delta.clear();
+		}
+	}
+	--m_size;
+	return true;
+}
+
+void RewindBuffer::restore(const image_t& image, Chip8& processor) {
+	unflatten(image, m_snapshot);
+	processor.loadSnapshot(m_snapshot);
+}
+
+void RewindBuffer::flatten(const Snapshot& snapshot, image_t& image) {
+	image.clear();
+
+	put(image, snapshot.v);
+	put(image, snapshot.stack);
+	put(image, snapshot.i);
+	put(image, snapshot.pc);
+	put(image, snapshot.sp);
+	put(image, snapshot.opcode);
+	put(image, snapshot.delayTimer);
+	put(image, snapshot.soundTimer);
+	put(image, snapshot.finished);
+	put(image, snapshot.soundPlaying);
+	put(image, snapshot.waitingForKeyPress);
+	put(image, snapshot.waitingForKeyPressRegister);
+	put(image, snapshot.keys);
+	put(image, snapshot.randomNumberGenerator);
+
+	put(image, snapshot.calculatorRegisters);
+	put(image, snapshot.compatibility);
+
+	put(image, snapshot.audioPatternBuffer);
+
+	put(image, snapshot.highResolution);
+	put(image, snapshot.planeMask);
+	put(image, snapshot.dirtyRows);
+
+	put(image, (uint32_t)snapshot.display.size());
+	const auto display = reinterpret_cast<const uint8_t*>(snapshot.display.data());
+	image.insert(image.end(), display, display + snapshot.display.size() * sizeof(uint64_t));
+
+	put(image, (uint32_t)snapshot.memory.size());
+	for (const auto& page : snapshot.memory)
+		image.insert(image.end(), page->cbegin(), page->cend());
+}
+
+void RewindBuffer::unflatten(const image_t& image, Snapshot& snapshot) {
+	size_t offset = 0;
+
+	take(image, offset, snapshot.v);
+	take(image, offset, snapshot.stack);
+	take(image, offset, snapshot.i);
+	take(image, offset, snapshot.pc);
+	take(image, offset, snapshot.sp);
+	take(image, offset, snapshot.opcode);
+	take(image, offset, snapshot.delayTimer);
+	take(image, offset, snapshot.soundTimer);
+	take(image, offset, snapshot.finished);
+	take(image, offset, snapshot.soundPlaying);
+	take(image, offset, snapshot.waitingForKeyPress);
+	take(image, offset, snapshot.waitingForKeyPressRegister);
+	take(image, offset, snapshot.keys);
+	take(image, offset, snapshot.randomNumberGenerator);
+
+	take(image, offset, snapshot.calculatorRegisters);
+	take(image, offset, snapshot.compatibility);
+
+	take(image, offset, snapshot.audioPatternBuffer);
+
+	take(image, offset, snapshot.highResolution);
+	take(image, offset, snapshot.planeMask);
+	take(image, offset, snapshot.dirtyRows);
+
+	uint32_t displayWords = 0;
+	take(image, offset, displayWords);
+	snapshot.display.resize(displayWords);
+	std::memcpy(snapshot.display.data(), &image[offset], displayWords * sizeof(uint64_t));
+	offset += displayWords * sizeof(uint64_t);
+
+	uint32_t pages = 0;
+	take(image, offset, pages);
+	const auto size = (int)(pages * Memory::PageSize);
+	if (m_memory.size() != size)
+		m_memory = Memory(size);
+	m_memory.set(0, &image[offset], size);
+	snapshot.memory = m_memory.pages();
+}
+
+// Zero runs are skipped over; anything else is copied as a literal, until
+// the next pair of zeros
+void RewindBuffer::encode(const image_t& image, const image_t& reference, image_t& delta) {
+	delta.clear();
+	const auto size = image.size();
+	const auto difference = [&](size_t offset) {
+		return (uint8_t)(image[offset] ^ reference[offset]);
+	};
+	size_t offset = 0;
+	while (offset < size) {
+		const auto start = offset;
+		while ((offset < size) && (difference(offset) == 0))
+			++offset;
+		if (offset == size)
+			break;
+		putCount(delta, offset - start);
+
+		const auto literals = offset;
+		while ((offset < size) && !((difference(offset) == 0) && (((offset + 1) == size) || (difference(offset + 1) == 0))))
+			++offset;
+		putCount(delta, offset - literals);
+		for (auto literal = literals; literal < offset; ++literal)
+			delta.push_back(difference(literal));
+	}
+}
+
+void RewindBuffer::decode(const image_t& delta, const image_t& reference, image_t& image) {
+	image = reference;
+	size_t offset = 0;
+	size_t position = 0;
+	while (offset < delta.size()) {
+		position += takeCount(delta, offset);
+		const auto literals = takeCount(delta, offset);
+		for (size_t literal = 0; literal < literals; ++literal)
+			image[position++] ^= delta[offset++];
+	}
+}
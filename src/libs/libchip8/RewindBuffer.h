@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "Memory.h"
+#include "Snapshot.h"
+
+class Chip8;
+
+// The last so many frames of a machine's history, for stepping backwards
+// through.  Every state is flattened into an image of fixed length; one in
+// every keyframeInterval is a keyframe, and each of the others is kept as the
+// XOR of its image with its keyframe's, run length encoded, so that only what
+// changed costs anything.  Keyframes are themselves kept as deltas against the
+// keyframe after them, with only the newest held whole: rewinding walks back
+// through them, and the oldest can be dropped without touching the rest.
+class RewindBuffer final {
+public:
+	RewindBuffer(size_t capacity, size_t keyframeInterval = 4);
+
+	// In frames
+	size_t size() const {
+		return m_size;
+	}
+
+	size_t capacity() const {
+		return m_capacity;
+	}
+
+	bool empty() const {
+		return m_size == 0;
+	}
+
+	// Storage used by the encoded states
+	size_t getBytes() const;
+
+	void clear();
+
+	// Adds the machine's state as the newest, dropping the oldest keyframe
+	// and the frames that depend on it if the buffer is full
+	void record(const Chip8& processor);
+
+	// Restores the newest state into the machine and forgets it.  Returns
+	// false, leaving the machine alone, if there's nothing left to rewind to.
+	bool rewind(Chip8& processor);
+
+private:
+	typedef std::vector<uint8_t> image_t;
+
+	struct keyframe_t {
+		image_t delta;	// Against the next keyframe; unused for the newest
+		std::vector<image_t> frames;	// Against this keyframe
+	};
+
+	size_t m_capacity;
+	size_t m_keyframeInterval;
+	size_t m_size = 0;
+
+	std::deque<keyframe_t> m_keyframes;
+	image_t m_newest;	// The newest keyframe, whole
+
+	// Scratch space, kept to save reallocating every frame
+	Snapshot m_snapshot;
+	Memory m_memory;
+	image_t m_image;
+
+	void restore(const image_t& image, Chip8& processor);
+
+	static void flatten(const Snapshot& snapshot, image_t& image);
+	void unflatten(const image_t& image, Snapshot& snapshot);
+
+	static void encode(const image_t& image, const image_t& reference, image_t& delta);
+	static void decode(const image_t& delta, const image_t& reference, image_t& image);
+};
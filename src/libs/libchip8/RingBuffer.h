@@ -0,0 +1,65 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Lock-free queue of values from one producer thread to one consumer
+// thread.  Neither side ever waits: the producer is told when the ring is
+// full, and the consumer takes whatever has been pushed so far.  The
+// capacity is rounded up to a power of two.
+template<class T> class RingBuffer final {
+public:
+	RingBuffer(size_t capacity)
+	: m_buffer(roundUp(capacity)),
+	  m_mask(m_buffer.size() - 1) {}
+
+	size_t capacity() const {
+		return m_buffer.size();
+	}
+
+	// Producer side
+
+	// Returns false, leaving the ring alone, if it is full
+	bool push(const T& value) {
+		const auto tail = m_tail.load(std::memory_order_relaxed);
+		if ((tail - m_cachedHead) == m_buffer.size()) {
+			m_cachedHead = m_head.load(std::memory_order_acquire);
+			if ((tail - m_cachedHead) == m_buffer.size())
+				return false;
+		}
+		m_buffer[tail & m_mask] = value;
+		m_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer side
+
+	// Moves up to "count" values into "values", returning how many were taken
+	size_t pop(T* values, size_t count) {
+		const auto head = m_head.load(std::memory_order_relaxed);
+		count = std::min(count, m_tail.load(std::memory_order_acquire) - head);
+		for (size_t i = 0; i < count; ++i)
+			values[i] = m_buffer[(head + i) & m_mask];
+		m_head.store(head + count, std::memory_order_release);
+		return count;
+	}
+
+private:
+	static size_t roundUp(size_t capacity) {
+		size_t rounded = 1;
+		while (rounded < capacity)
+			rounded <<= 1;
+		return rounded;
+	}
+
+	std::vector<T> m_buffer;
+	size_t m_mask;
+
+	// Each side writes its own index on its own cache line
+	std::atomic<size_t> m_head { 0 };
+	char m_headPadding[64];
+	std::atomic<size_t> m_tail { 0 };
+	size_t m_cachedHead = 0;	// The producer's last look at m_head
+};
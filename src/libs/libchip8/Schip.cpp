@@ -1,17 +1,46 @@
 #include "stdafx.h"
 #include "Schip.h"
 
+#include "Profiler.h"
+
 Schip::Schip(const Memory& memory, const KeyboardDevice& keyboard, const BitmappedGraphics& display, const Configuration& configuration)
 : Chip8(memory, keyboard, display, configuration) {
 }
 
 void Schip::initialise() {
 	Chip8::initialise();
-	std::copy_n(m_highFont.cbegin(), m_highFont.size(), memory().bus().begin() + HighFontOffset);
+	memory().set(HighFontOffset, m_highFont.data(), m_highFont.size());
 	if (configuration().getChip8LoadAndSave())
 		m_compatibility = true;
 }
 
+Chip8* Schip::clone() const {
+	auto copy = new Schip(*this);
+	copy->disconnect();
+	return copy;
+}
+
+void Schip::disconnect() {
+	Chip8::disconnect();
+	HighResolutionConfigured.clear();
+	LowResolutionConfigured.clear();
+}
+
+void Schip::saveSnapshot(Snapshot& snapshot) const {
+	Chip8::saveSnapshot(snapshot);
+	snapshot.calculatorRegisters = m_r;
+	snapshot.compatibility = m_compatibility;
+}
+
+void Schip::loadSnapshot(const Snapshot& snapshot) {
+	Chip8::loadSnapshot(snapshot);
+	m_r = snapshot.calculatorRegisters;
+	if (m_compatibility != snapshot.compatibility) {
+		m_compatibility = snapshot.compatibility;
+		memory().invalidateInstructions();	// Load and save have to be decoded again
+	}
+}
+
 void Schip::onHighResolution() {
 	display().setHighResolution(true);
 	HighResolutionConfigured.fire(EventArgs());
@@ -22,72 +51,110 @@ void Schip::onLowResolution() {
 	LowResolutionConfigured.fire(EventArgs());
 }
 
-bool Schip::emulateInstructions_F(int nnn, int nn, int n, int x, int y) {
-	switch (nn) {
+bool Schip::decodeInstructions_F(Instruction& instruction) {
+	switch (instruction.nn) {
 	case 0x30:
-		LD_HF_Vx(x);
+		instruction.handler = [](Chip8& processor, const Instruction& operands) { static_cast<Schip&>(processor).LD_HF_Vx(operands.x); };
 		break;
 
 	case 0x75:
-		LD_R_Vx(x);
+		instruction.handler = [](Chip8& processor, const Instruction& operands) { static_cast<Schip&>(processor).LD_R_Vx(operands.x); };
 		break;
 
 	case 0x85:
-		LD_Vx_R(x);
+		instruction.handler = [](Chip8& processor, const Instruction& operands) { static_cast<Schip&>(processor).LD_Vx_R(operands.x); };
+		break;
+
+	case 0x55:
+		if (m_compatibility)
+			return Chip8::decodeInstructions_F(instruction);
+		instruction.handler = [](Chip8& processor, const Instruction& operands) { static_cast<Schip&>(processor).LD_II_Vx(operands.x); };
+		break;
+
+	case 0x65:
+		if (m_compatibility)
+			return Chip8::decodeInstructions_F(instruction);
+		instruction.handler = [](Chip8& processor, const Instruction& operands) { static_cast<Schip&>(processor).LD_Vx_II(operands.x); };
 		break;
 
 	default:
-		return Chip8::emulateInstructions_F(nnn, nn, n, x, y);
+		return Chip8::decodeInstructions_F(instruction);
 	}
 	return true;
 }
 
-bool Schip::emulateInstructions_D(int nnn, int nn, int n, int x, int y) {
-	switch (n) {
+bool Schip::decodeInstructions_D(Instruction& instruction) {
+	switch (instruction.n) {
 	case 0:
-		XDRW(x, y);
+		instruction.handler = [](Chip8& processor, const Instruction& operands) { static_cast<Schip&>(processor).XDRW(operands.x, operands.y); };
+		break;
+
+	default:
+		return Chip8::decodeInstructions_D(instruction);
+	}
+	return true;
+}
+
+bool Schip::decodeInstructions_B(Instruction& instruction) {
+	if (configuration().getChip8IndexedJumps())
+		return Chip8::decodeInstructions_B(instruction);
+	instruction.handler = [](Chip8& processor, const Instruction& operands) { static_cast<Schip&>(processor).JP_V0(operands.x, operands.nnn); };
+	return true;
+}
+
+bool Schip::decodeInstructions_8(Instruction& instruction) {
+	if (configuration().getChip8Shifts())
+		return Chip8::decodeInstructions_8(instruction);
+
+	switch (instruction.n) {
+	case 0x6:
+		instruction.handler = [](Chip8& processor, const Instruction& operands) { static_cast<Schip&>(processor).SHR(operands.x); };
+		break;
+
+	case 0xe:
+		instruction.handler = [](Chip8& processor, const Instruction& operands) { static_cast<Schip&>(processor).SHL(operands.x); };
 		break;
 
 	default:
-		return Chip8::emulateInstructions_D(nnn, nn, n, x, y);
+		return Chip8::decodeInstructions_8(instruction);
 	}
 	return true;
 }
 
-bool Schip::emulateInstructions_0(int nnn, int nn, int n, int x, int y) {
-	switch (nn) {
+bool Schip::decodeInstructions_0(Instruction& instruction) {
+	switch (instruction.nn) {
 	case 0xfa:
-		COMPATIBILITY();
+		instruction.handler = [](Chip8& processor, const Instruction&) { static_cast<Schip&>(processor).COMPATIBILITY(); };
 		break;
 
 	case 0xfb:
-		SCRIGHT();
+		instruction.handler = [](Chip8& processor, const Instruction&) { static_cast<Schip&>(processor).SCRIGHT(); };
 		break;
 
 	case 0xfc:
-		SCLEFT();
+		instruction.handler = [](Chip8& processor, const Instruction&) { static_cast<Schip&>(processor).SCLEFT(); };
 		break;
 
 	case 0xfd:
-		EXIT();
+		instruction.handler = [](Chip8& processor, const Instruction&) { static_cast<Schip&>(processor).EXIT(); };
 		break;
 
 	case 0xfe:
-		LOW();
+		instruction.handler = [](Chip8& processor, const Instruction&) { static_cast<Schip&>(processor).LOW(); };
 		break;
 
 	case 0xff:
-		HIGH();
+		instruction.handler = [](Chip8& processor, const Instruction&) { static_cast<Schip&>(processor).HIGH(); };
 		break;
 
 	default:
-		switch (y) {
+		switch (instruction.y) {
 		case 0xc:
-			SCDOWN(n);
+			instruction.handler = [](Chip8& processor, const Instruction& operands) { static_cast<Schip&>(processor).SCDOWN(operands.n); };
 			break;
 
 		default:
-			return Chip8::emulateInstructions_0(nnn, nn, n, x, y);
+			return Chip8::decodeInstructions_0(instruction);
 		}
 		break;
 	}
@@ -97,26 +164,18 @@ bool Schip::emulateInstructions_0(int nnn, int nn, int n, int x, int y) {
 
 // https://github.com/Chromatophore/HP48-Superchip#8xy6--8xye
 // Bit shifts X register by 1, VIP: shifts Y by one and places in X, HP48-SC: ignores Y field, shifts X
-void Schip::SHR(int x, int y) {
-	if (configuration().getChip8Shifts()) {
-		Chip8::SHR(x, y);
-	} else {
-		mnemomicFormat() = "(S) SHR V%4$01X";
-		registers()[0xf] = registers()[x] & 0x1;
-		registers()[x] >>= 1;
-	}
+// (Only decoded when Chip-8 shifts haven't been configured)
+void Schip::SHR(int x) {
+	registers()[0xf] = registers()[x] & 0x1;
+	registers()[x] >>= 1;
 }
 
 // https://github.com/Chromatophore/HP48-Superchip#8xy6--8xye
 // Bit shifts X register by 1, VIP: shifts Y by one and places in X, HP48-SC: ignores Y field, shifts X
-void Schip::SHL(int x, int y) {
-	if (configuration().getChip8Shifts()) {
-		Chip8::SHL(x, y);
-	} else {
-		mnemomicFormat() = "(S) SHL V%4$01X";
-		registers()[0xf] = (registers()[x] & 0x80) == 0 ? 0 : 1;
-		registers()[x] <<= 1;
-	}
+// (Only decoded when Chip-8 shifts haven't been configured)
+void Schip::SHL(int x) {
+	registers()[0xf] = (registers()[x] & 0x80) == 0 ? 0 : 1;
+	registers()[x] <<= 1;
 }
 
 // https://github.com/Chromatophore/HP48-Superchip#bnnn
@@ -124,44 +183,30 @@ void Schip::SHL(int x, int y) {
 //  VIP: correctly jumps based on v0
 //  HP48 -SC: reads highest nibble of address to select
 //      register to apply to address (high nibble pulls double duty)
+// (Only decoded when Chip-8 indexed jumps haven't been configured)
 void Schip::JP_V0(int x, int nnn) {
-	if (configuration().getChip8IndexedJumps()) {
-		Chip8::JP_V0(x, nnn);
-	} else {
-		mnemomicFormat() = "(S) JP V%4$01X,%1$03X";
-		PC() = (uint16_t)(registers()[x] + nnn);
-	}
+	PC() = (uint16_t)(registers()[x] + nnn);
 }
 
 // https://github.com/Chromatophore/HP48-Superchip#fx55--fx65
 // Saves/Loads registers up to X at I pointer - VIP: increases I, HP48-SC: I remains static
+// (Only decoded outside compatibility mode)
 void Schip::LD_Vx_II(int x) {
-	if (m_compatibility) {
-		Chip8::LD_Vx_II(x);
-	} else {
-		mnemomicFormat() = "(S) LD V%4$01X,[I]";
-		std::copy_n(memory().bus().cbegin() + indirector(), x + 1, registers().begin());
-	}
+	memory().get(indirector(), registers().data(), x + 1);
 }
 
 // https://github.com/Chromatophore/HP48-Superchip#fx55--fx65
 // Saves/Loads registers up to X at I pointer - VIP: increases I, HP48-SC: I remains static
+// (Only decoded outside compatibility mode)
 void Schip::LD_II_Vx(int x) {
-	if (m_compatibility) {
-		Chip8::LD_II_Vx(x);
-	} else {
-		mnemomicFormat() = "(S) LD [I],V%4$01X";
-		std::copy_n(registers().cbegin(), x + 1, memory().bus().begin() + indirector());
-	}
+	memory().set(indirector(), registers().data(), x + 1);
 }
 
 void Schip::LD_HF_Vx(int x) {
-	mnemomicFormat() = "(S) LD HF,V%4$01X";
 	indirector() = HighFontOffset + (HighFontSize * registers()[x]);
 }
 
 void Schip::XDRW(int x, int y) {
-	mnemomicFormat() = "(S) XDRW V%4$01X,V%5$01X";
 	draw(x, y, 16, 16);
 }
 
@@ -170,7 +215,6 @@ void Schip::XDRW(int x, int y) {
 // with a successful exit status. [Super-Chip]
 // Code generated: 0x00FD.
 void Schip::EXIT() {
-	mnemomicFormat() = "(S) EXIT";
 	setFinished();
 }
 
@@ -180,7 +224,7 @@ void Schip::EXIT() {
 // (Use the delay timer to pace your games in high resolution mode.)
 // Code generated: 0x00Cn
 void Schip::SCDOWN(int n) {
-	mnemomicFormat() = "(S) SCDOWN %3$01X";
+	CHIP8_PROFILE_SECTION(*this, Scroll);
 	display().scrollDown(n);
 }
 
@@ -190,8 +234,8 @@ void Schip::SCDOWN(int n) {
 // porting of Chip 8 games which rely on this behaviour.
 // Code generated: 0x00FA
 void Schip::COMPATIBILITY() {
-	mnemomicFormat() = "(S) COMPATIBILITY";
 	m_compatibility = true;
+	memory().invalidateInstructions();	// Load and save have to be decoded again
 }
 
 // scright
@@ -200,7 +244,7 @@ void Schip::COMPATIBILITY() {
 // (Use the delay timer to pace your games in high resolution mode.)
 // Code generated: 0x00FB
 void Schip::SCRIGHT() {
-	mnemomicFormat() = "(S) SCRIGHT";
+	CHIP8_PROFILE_SECTION(*this, Scroll);
 	display().scrollRight();
 }
 
@@ -210,7 +254,7 @@ void Schip::SCRIGHT() {
 // (Use the delay timer to pace your games in high resolution mode.)
 // Code generated: 0x00FC
 void Schip::SCLEFT() {
-	mnemomicFormat() = "(S) SCLEFT";
+	CHIP8_PROFILE_SECTION(*this, Scroll);
 	display().scrollLeft();
 }
 
@@ -218,7 +262,6 @@ void Schip::SCLEFT() {
 // Low resolution (6432) graphics mode (this is the default). [Super-Chip]
 // Code generated: 0x00FE
 void Schip::LOW() {
-	mnemomicFormat() = "(S) LOW";
 	onLowResolution();
 }
 
@@ -226,7 +269,6 @@ void Schip::LOW() {
 // High resolution (12864) graphics mode. [Super-Chip]
 // Code generated: 0x00FF
 void Schip::HIGH() {
-	mnemomicFormat() = "(S) HIGH";
 	onHighResolution();
 }
 
@@ -235,7 +277,6 @@ void Schip::HIGH() {
 // HP48 implementation). (X < 8) [Super-Chip]
 // Code generated: 0xFX75
 void Schip::LD_R_Vx(int x) {
-	mnemomicFormat() = "(S) LD R,V%4$01X";
 	std::copy_n(registers().cbegin(), (x & 7) + 1, calculatorRegisters().begin());
 }
 
@@ -244,6 +285,5 @@ void Schip::LD_R_Vx(int x) {
 // HP48 implementation). (X < 8) [Super-Chip]
 // Code generated: 0xFX85
 void Schip::LD_Vx_R(int x) {
-	mnemomicFormat() = "(S) LD V%4$01X,R";
 	std::copy_n(calculatorRegisters().cbegin(), (x & 7) + 1, registers().begin());
 }
@@ -30,22 +30,35 @@ public:
 
 	virtual void initialise();
 
+	virtual Chip8* clone() const;
+
+	virtual void saveSnapshot(Snapshot& snapshot) const;
+	virtual void loadSnapshot(const Snapshot& snapshot);
+
+	bool getCompatibility() const { return m_compatibility; }
+
 	const std::array<uint8_t, 8>& calculatorRegisters() const { return m_r; }
 	std::array<uint8_t, 8>& calculatorRegisters() { return m_r; }
 
 protected:
+	Schip(const Schip& rhs) = default;
+
+	virtual void disconnect();
+
 	void onHighResolution();
 	void onLowResolution();
 
-	virtual bool emulateInstructions_F(int nnn, int nn, int n, int x, int y);
-	virtual bool emulateInstructions_D(int nnn, int nn, int n, int x, int y);
-	virtual bool emulateInstructions_0(int nnn, int nn, int n, int x, int y);
-
-	virtual void SHR(int x, int y);
-	virtual void SHL(int x, int y);
-	virtual void JP_V0(int x, int nnn);
-	virtual void LD_Vx_II(int x);
-	virtual void LD_II_Vx(int x);
+	virtual bool decodeInstructions_F(Instruction& instruction);
+	virtual bool decodeInstructions_D(Instruction& instruction);
+	virtual bool decodeInstructions_B(Instruction& instruction);
+	virtual bool decodeInstructions_8(Instruction& instruction);
+	virtual bool decodeInstructions_0(Instruction& instruction);
+
+	void SHR(int x);
+	void SHL(int x);
+	void JP_V0(int x, int nnn);
+	void LD_Vx_II(int x);
+	void LD_II_Vx(int x);
 
 private:
 	friend class cereal::access;
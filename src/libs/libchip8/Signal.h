@@ -15,6 +15,14 @@ public:
 		delegates.push_back(functor);
 	}
 
+	void clear() {
+		delegates.clear();
+	}
+
+	bool empty() const {
+		return delegates.empty();
+	}
+
 	void fire(const T& e) const {
 		for (auto& delegate : delegates)
 			delegate(e);
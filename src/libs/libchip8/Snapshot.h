@@ -0,0 +1,45 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "Memory.h"
+#include "RandomNumberGenerator.h"
+
+// Everything about a machine that changes as it runs, laid out the same way
+// for every machine of a configuration.  Taking a snapshot into one that has
+// been used before, for the same configuration, allocates nothing.  Memory is
+// held as shared pages, so the machine copies any page it writes to afterwards.
+struct Snapshot final {
+	// Processor
+	std::array<uint8_t, 16> v;
+	std::array<uint16_t, 16> stack;
+	uint16_t i = 0;
+	uint16_t pc = 0;
+	uint16_t sp = 0;
+	uint16_t opcode = 0;
+	uint8_t delayTimer = 0;
+	uint8_t soundTimer = 0;
+	bool finished = false;
+	bool soundPlaying = false;
+	bool waitingForKeyPress = false;
+	int waitingForKeyPressRegister = -1;
+	uint16_t keys = 0;
+	RandomNumberGenerator randomNumberGenerator;
+
+	// Super-Chip
+	std::array<uint8_t, 8> calculatorRegisters;
+	bool compatibility = false;
+
+	// XO-Chip
+	std::array<uint8_t, 16> audioPatternBuffer;
+
+	// Display, packed as by BitmappedGraphics::pack
+	bool highResolution = false;
+	int planeMask = 1;
+	uint64_t dirtyRows = 0;
+	std::vector<uint64_t> display;
+
+	Memory::pages_t memory;
+};
@@ -0,0 +1,175 @@
+#include "stdafx.h"
+#include "Trace.h"
+
+#include <chrono>
+
+#include "Chip8.h"
+#include "Schip.h"
+
+// File layout, all little endian:
+//	"C8TR", version (u16)
+//	processor type, chip8 shifts, chip8 indexed jumps, chip8 load and save (u8 each)
+//	records to the end of the file, TraceRecord::Size bytes each:
+//		PC, instruction, following word, I (u16 each)
+//		V0-VF, SP, DT, ST, flags (u8 each)
+
+namespace {
+
+	const char Magic[4] = { 'C', '8', 'T', 'R' };
+	const uint16_t Version = 1;
+
+	enum {
+		HeaderSize = sizeof(Magic) + 2 + 4,
+		BatchSize = 4096	// Records written at a time
+	};
+
+	void put16(uint8_t*& bytes, const uint16_t value) {
+		*bytes++ = value & 0xff;
+		*bytes++ = value >> 8;
+	}
+
+	uint16_t take16(const uint8_t*& bytes) {
+		const uint16_t value = bytes[0] | (bytes[1] << 8);
+		bytes += 2;
+		return value;
+	}
+}
+
+TraceRecord TraceRecord::capture(const uint16_t programCounter, const uint16_t instruction, const Chip8& processor) {
+	TraceRecord record;
+	record.programCounter = programCounter;
+	record.instruction = instruction;
+	const auto& memory = processor.memory();
+	record.following = (programCounter + 4) <= memory.size() ? memory.getWord(programCounter + 2) : 0;
+	record.indirector = processor.indirector();
+	record.registers = processor.registers();
+	record.stackPointer = (uint8_t)processor.SP();
+	record.delayTimer = processor.delayTimer();
+	record.soundTimer = processor.soundTimer();
+	record.flags = processor.isWaitingForKeyPress() ? WaitingForKeyPress : 0;
+	if ((processor.configuration().getType() >= superChip) && static_cast<const Schip&>(processor).getCompatibility())
+		record.flags |= Compatibility;
+	return record;
+}
+
+void TraceRecord::encode(uint8_t* bytes) const {
+	put16(bytes, programCounter);
+	put16(bytes, instruction);
+	put16(bytes, following);
+	put16(bytes, indirector);
+	bytes = std::copy(registers.begin(), registers.end(), bytes);
+	*bytes++ = stackPointer;
+	*bytes++ = delayTimer;
+	*bytes++ = soundTimer;
+	*bytes++ = flags;
+}
+
+TraceRecord TraceRecord::decode(const uint8_t* bytes) {
+	TraceRecord record;
+	record.programCounter = take16(bytes);
+	record.instruction = take16(bytes);
+	record.following = take16(bytes);
+	record.indirector = take16(bytes);
+	std::copy(bytes, bytes + record.registers.size(), record.registers.begin());
+	bytes += record.registers.size();
+	record.stackPointer = *bytes++;
+	record.delayTimer = *bytes++;
+	record.soundTimer = *bytes++;
+	record.flags = *bytes++;
+	return record;
+}
+
+TraceWriter::TraceWriter(const std::string& path, const Configuration& configuration)
+: m_path(path),
+  m_records(Capacity) {
+
+	m_output.exceptions(std::ios::failbit | std::ios::badbit);
+	m_output.open(path, std::ios::binary);
+
+	uint8_t header[HeaderSize];
+	auto bytes = std::copy(Magic, Magic + sizeof(Magic), header);
+	put16(bytes, Version);
+	*bytes++ = (uint8_t)configuration.getType();
+	*bytes++ = configuration.getChip8Shifts();
+	*bytes++ = configuration.getChip8IndexedJumps();
+	*bytes++ = configuration.getChip8LoadAndSave();
+	m_output.write((const char*)header, sizeof(header));
+
+	m_drain = std::thread(&TraceWriter::drain, this);
+}
+
+TraceWriter::~TraceWriter() {
+	try {
+		close();
+	} catch (...) {
+	}
+}
+
+void TraceWriter::close() {
+	if (!m_drain.joinable())
+		return;
+	m_closing.store(true, std::memory_order_release);
+	m_drain.join();
+	if (m_failed)
+		throw std::runtime_error("Unable to write trace: " + m_path);
+}
+
+void TraceWriter::drain() {
+	std::vector<TraceRecord> records(BatchSize);
+	std::vector<uint8_t> bytes(BatchSize * TraceRecord::Size);
+	for (;;) {
+		// Anything appended before closing was asked for is in the ring by now
+		const auto closing = m_closing.load(std::memory_order_acquire);
+		const auto count = m_records.pop(records.data(), records.size());
+		if (count == 0) {
+			if (closing)
+				break;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			continue;
+		}
+		if (m_failed)
+			continue;	// Keep the ring moving, so that append never waits forever
+		for (size_t i = 0; i < count; ++i)
+			records[i].encode(&bytes[i * TraceRecord::Size]);
+		try {
+			m_output.write((const char*)bytes.data(), count * TraceRecord::Size);
+		} catch (const std::ios::failure&) {
+			m_failed = true;
+		}
+	}
+	try {
+		m_output.close();
+	} catch (const std::ios::failure&) {
+		m_failed = true;
+	}
+}
+
+TraceReader::TraceReader(const std::string& path)
+: m_path(path) {
+
+	m_input.exceptions(std::ios::badbit);
+	m_input.open(path, std::ios::binary);
+
+	uint8_t header[HeaderSize];
+	if (!m_input.read((char*)header, sizeof(header)) || !std::equal(Magic, Magic + sizeof(Magic), header))
+		throw std::runtime_error("Not a trace file: " + path);
+	const uint8_t* bytes = header + sizeof(Magic);
+	if (take16(bytes) != Version)
+		throw std::runtime_error("Unsupported trace version: " + path);
+
+	m_configuration.setType((ProcessorLevel)*bytes++);
+	m_configuration.setChip8Shifts(*bytes++ != 0);
+	m_configuration.setChip8IndexedJumps(*bytes++ != 0);
+	m_configuration.setChip8LoadAndSave(*bytes++ != 0);
+}
+
+bool TraceReader::read(TraceRecord& record) {
+	uint8_t bytes[TraceRecord::Size];
+	m_input.read((char*)bytes, sizeof(bytes));
+	if (m_input.gcount() == 0)
+		return false;
+	if (m_input.gcount() != sizeof(bytes))
+		throw std::runtime_error("Trace ends part way through a record: " + m_path);
+	record = TraceRecord::decode(bytes);
+	return true;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include "Configuration.h"
+#include "RingBuffer.h"
+
+class Chip8;
+
+// An instruction about to be executed, and the state the processor was in
+struct TraceRecord {
+	enum {
+		Size = 28	// Bytes in a trace file
+	};
+
+	enum {
+		Compatibility = 0x1,		// Schip HP48 compatibility was on
+		WaitingForKeyPress = 0x2
+	};
+
+	uint16_t programCounter;
+	uint16_t instruction;
+	uint16_t following;	// The word after the instruction: XO-Chip's long operand
+	uint16_t indirector;
+	std::array<uint8_t, 16> registers;
+	uint8_t stackPointer;
+	uint8_t delayTimer;
+	uint8_t soundTimer;
+	uint8_t flags;
+
+	static TraceRecord capture(uint16_t programCounter, uint16_t instruction, const Chip8& processor);
+
+	void encode(uint8_t* bytes) const;
+	static TraceRecord decode(const uint8_t* bytes);
+};
+
+// Appends records to a trace file.  The emulation thread queues records
+// without waiting on the disk, and a thread of the writer's own drains
+// them; only if that thread falls a whole ring behind does append wait.
+class TraceWriter final {
+public:
+	enum {
+		Capacity = 1 << 16	// Records queued before append waits
+	};
+
+	TraceWriter(const std::string& path, const Configuration& configuration);
+	~TraceWriter();
+
+	void append(const TraceRecord& record) {
+		while (!m_records.push(record))
+			std::this_thread::yield();
+	}
+
+	// Writes out everything appended, throwing if any of it couldn't be
+	void close();
+
+private:
+	std::string m_path;
+	std::ofstream m_output;
+	RingBuffer<TraceRecord> m_records;
+	std::atomic<bool> m_closing { false };
+	bool m_failed = false;	// Written by the drain thread, read once it has finished
+	std::thread m_drain;
+
+	void drain();
+};
+
+class TraceReader final {
+public:
+	TraceReader(const std::string& path);
+
+	// Enough of the traced processor's configuration to disassemble with
+	const Configuration& configuration() const {
+		return m_configuration;
+	}
+
+	// Returns false at the end of the trace
+	bool read(TraceRecord& record);
+
+private:
+	std::string m_path;
+	std::ifstream m_input;
+	Configuration m_configuration;
+};
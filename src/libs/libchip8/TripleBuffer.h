@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+// Lock-free hand over of whole values from one producer thread to one
+// consumer thread.  The producer fills back() and publishes it; the
+// consumer takes the most recently published value into front().
+// Neither side ever waits, and values the consumer misses are simply
+// replaced.
+template<class T> class TripleBuffer final {
+public:
+	// Producer side
+
+	T& back() {
+		return m_buffers[m_back];
+	}
+
+	// Returns true if the value being replaced was never taken, in
+	// which case that value is now back().
+	bool publish() {
+		const auto previous = m_middle.exchange(m_back | Fresh, std::memory_order_acq_rel);
+		m_back = previous & Index;
+		return (previous & Fresh) != 0;
+	}
+
+	// Consumer side
+
+	const T& front() const {
+		return m_buffers[m_front];
+	}
+
+	// Returns false, leaving front() alone, if nothing new has been published
+	bool take() {
+		if ((m_middle.load(std::memory_order_relaxed) & Fresh) == 0)
+			return false;
+		const auto previous = m_middle.exchange(m_front, std::memory_order_acq_rel);
+		m_front = previous & Index;
+		return true;
+	}
+
+private:
+	enum {
+		Index = 0x3,
+		Fresh = 0x4
+	};
+
+	std::array<T, 3> m_buffers;
+	std::atomic<int> m_middle { 1 };
+	int m_back = 0;
+	int m_front = 2;
+};
@@ -0,0 +1,76 @@
+#include "stdafx.h"
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(int threads) {
+	if (threads <= 0)
+		threads = std::max(1U, std::thread::hardware_concurrency());
+	for (int thread = 1; thread < threads; ++thread)
+		m_threads.emplace_back(&WorkerPool::serve, this);
+}
+
+WorkerPool::~WorkerPool() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_started.notify_all();
+	for (auto& thread : m_threads)
+		thread.join();
+}
+
+void WorkerPool::run(const size_t count, const std::function<void(size_t)>& work) {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_work = &work;
+		m_count = count;
+		m_next = 0;
+		m_busy = m_threads.size();
+		m_failure = nullptr;
+		++m_generation;
+	}
+	m_started.notify_all();
+
+	drain();
+
+	std::exception_ptr failure;
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_finished.wait(lock, [this] { return m_busy == 0; });
+		m_work = nullptr;
+		std::swap(failure, m_failure);
+	}
+	if (failure)
+		std::rethrow_exception(failure);
+}
+
+void WorkerPool::serve() {
+	unsigned seen = 0;
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_started.wait(lock, [this, seen] { return m_stopping || (m_generation != seen); });
+			if (m_stopping)
+				return;
+			seen = m_generation;
+		}
+		drain();
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (--m_busy == 0)
+				m_finished.notify_one();
+		}
+	}
+}
+
+void WorkerPool::drain() {
+	for (size_t index; (index = m_next++) < m_count; ) {
+		try {
+			(*m_work)(index);
+		} catch (...) {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!m_failure)
+				m_failure = std::current_exception();
+			m_next = m_count;	// Abandon what's left
+		}
+	}
+}
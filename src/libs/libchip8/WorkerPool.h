@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of threads that share out numbered pieces of work.  run()
+// hands every index in [0, count) to exactly one thread, the calling thread
+// included, and returns once all of them are done.  The threads sleep
+// between runs, so a pool can be kept for the life of its owner.
+class WorkerPool final {
+public:
+	// threads is the total number of threads working, the caller's included
+	// (0: one per hardware thread)
+	explicit WorkerPool(int threads = 0);
+	~WorkerPool();
+
+	size_t size() const {
+		return m_threads.size() + 1;
+	}
+
+	// The first exception thrown by "work" is rethrown here, once every thread has stopped
+	void run(size_t count, const std::function<void(size_t)>& work);
+
+private:
+	std::vector<std::thread> m_threads;
+
+	std::mutex m_mutex;
+	std::condition_variable m_started;
+	std::condition_variable m_finished;
+
+	const std::function<void(size_t)>* m_work = nullptr;
+	size_t m_count = 0;
+	std::atomic<size_t> m_next { 0 };
+	size_t m_busy = 0;
+	unsigned m_generation = 0;
+	bool m_stopping = false;
+	std::exception_ptr m_failure;
+
+	void serve();
+	void drain();
+};
@@ -1,6 +1,8 @@
 #include "stdafx.h"
 #include "XoChip.h"
 
+#include "Profiler.h"
+
 XoChip::XoChip() {
 }
 
@@ -8,52 +10,68 @@ XoChip::XoChip(const Memory& memory, const KeyboardDevice& keyboard, const Bitma
 : Schip(memory, keyboard, display, configuration) {
 }
 
-bool XoChip::emulateInstructions_0(int nnn, int nn, int n, int x, int y) {
-	switch (y) {
+Chip8* XoChip::clone() const {
+	auto copy = new XoChip(*this);
+	copy->disconnect();
+	return copy;
+}
+
+void XoChip::saveSnapshot(Snapshot& snapshot) const {
+	Schip::saveSnapshot(snapshot);
+	snapshot.audioPatternBuffer = m_audoPatternBuffer;
+}
+
+void XoChip::loadSnapshot(const Snapshot& snapshot) {
+	Schip::loadSnapshot(snapshot);
+	m_audoPatternBuffer = snapshot.audioPatternBuffer;
+}
+
+bool XoChip::decodeInstructions_0(Instruction& instruction) {
+	switch (instruction.y) {
 	case 0xd:
-		SCUP(n);
+		instruction.handler = [](Chip8& processor, const Instruction& operands) { static_cast<XoChip&>(processor).SCUP(operands.n); };
 		break;
 
 	default:
-		return Schip::emulateInstructions_0(nnn, nn, n, x, y);
+		return Schip::decodeInstructions_0(instruction);
 	}
 	return true;
 }
 
-bool XoChip::emulateInstructions_5(int nnn, int nn, int n, int x, int y) {
-	switch (n) {
+bool XoChip::decodeInstructions_5(Instruction& instruction) {
+	switch (instruction.n) {
 	case 2:
-		save_vx_to_vy(x, y);
+		instruction.handler = [](Chip8& processor, const Instruction& operands) { static_cast<XoChip&>(processor).save_vx_to_vy(operands.x, operands.y); };
 		break;
 
 	case 3:
-		load_vx_to_vy(x, y);
+		instruction.handler = [](Chip8& processor, const Instruction& operands) { static_cast<XoChip&>(processor).load_vx_to_vy(operands.x, operands.y); };
 		break;
 
 	default:
-		return Schip::emulateInstructions_5(nnn, nn, n, x, y);
+		return Schip::decodeInstructions_5(instruction);
 	}
 	return true;
 }
 
-bool XoChip::emulateInstructions_F(int nnn, int nn, int n, int x, int y) {
-	switch (nnn) {
+bool XoChip::decodeInstructions_F(Instruction& instruction) {
+	switch (instruction.nnn) {
 	case 0:
-		load_i_long();
+		instruction.handler = [](Chip8& processor, const Instruction&) { static_cast<XoChip&>(processor).load_i_long(); };
 		break;
 
 	case 0x002:
-		audio();
+		instruction.handler = [](Chip8& processor, const Instruction&) { static_cast<XoChip&>(processor).audio(); };
 		break;
 
 	default:
-		switch (nn) {
+		switch (instruction.nn) {
 		case 0x01:
-			plane(x);
+			instruction.handler = [](Chip8& processor, const Instruction& operands) { static_cast<XoChip&>(processor).plane(operands.x); };
 			break;
 
 		default:
-			return Schip::emulateInstructions_F(nnn, nn, n, x, y);
+			return Schip::decodeInstructions_F(instruction);
 		}
 		break;
 	}
@@ -62,14 +80,13 @@ bool XoChip::emulateInstructions_F(int nnn, int nn, int n, int x, int y) {
 
 //// scroll-up n (0x00DN) scroll the contents of the display up by 0-15 pixels.
 void XoChip::SCUP(int n) {
-	mnemomicFormat() = "(X) SCUP %3$01X";
+	CHIP8_PROFILE_SECTION(*this, Scroll);
 	display().scrollUp(n);
 }
 
 // save vx - vy (0x5XY2) save an inclusive range of registers to memory starting at i.
 // https://github.com/JohnEarnest/Octo/blob/gh-pages/docs/XO-ChipSpecification.md#memory-access
 void XoChip::save_vx_to_vy(int x, int y) {
-	mnemomicFormat() = "(X) SAVE V%4$01X-V%5$01X";
 	auto step = x > y ? -1 : +1;
 	auto address = indirector();
 	auto ongoing = true;
@@ -84,7 +101,6 @@ void XoChip::save_vx_to_vy(int x, int y) {
 // load vx - vy (0x5XY3) load an inclusive range of registers from memory starting at i.
 // https://github.com/JohnEarnest/Octo/blob/gh-pages/docs/XO-ChipSpecification.md#memory-access
 void XoChip::load_vx_to_vy(int x, int y) {
-	mnemomicFormat() = "(X) LOAD V%4$01X-V%5$01X";
 	auto step = x > y ? -1 : +1;
 	auto address = indirector();
 	auto ongoing = true;
@@ -98,19 +114,16 @@ void XoChip::load_vx_to_vy(int x, int y) {
 // i := long NNNN (0xF000, 0xNNNN) load i with a 16-bit address.
 // https://github.com/JohnEarnest/Octo/blob/gh-pages/docs/XO-ChipSpecification.md#extended-memory
 void XoChip::load_i_long() {
-	mnemomicFormat() = "(X) LD I,%6$04X";
 	indirector() = (uint16_t)memory().getWord(PC());
 	PC() += 2;
 }
 
 ////plane n (0xFN01) select zero or more drawing planes by bitmask (0 <= n <= 3).
 void XoChip::plane(int n) {
-	mnemomicFormat() = "(X) PLANE %3$01X";
 	display().setPlaneMask(n);
 }
 
 ////audio (0xF002) store 16 bytes starting at i in the audio pattern buffer.
 void XoChip::audio() {
-	mnemomicFormat() = "(X) AUDIO";
-	std::copy_n(memory().bus().cbegin() + indirector(), m_audoPatternBuffer.size(), m_audoPatternBuffer.begin());
+	memory().get(indirector(), m_audoPatternBuffer.data(), m_audoPatternBuffer.size());
 }
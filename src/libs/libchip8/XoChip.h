@@ -18,10 +18,17 @@ public:
 	XoChip(const Memory& memory, const KeyboardDevice& keyboard, const BitmappedGraphics& display, const Configuration& configuration);
 	virtual ~XoChip() = default;
 
+	virtual Chip8* clone() const;
+
+	virtual void saveSnapshot(Snapshot& snapshot) const;
+	virtual void loadSnapshot(const Snapshot& snapshot);
+
 protected:
-	bool emulateInstructions_0(int nnn, int nn, int n, int x, int y);
-	bool emulateInstructions_5(int nnn, int nn, int n, int x, int y);
-	bool emulateInstructions_F(int nnn, int nn, int n, int x, int y);
+	XoChip(const XoChip& rhs) = default;
+
+	bool decodeInstructions_0(Instruction& instruction);
+	bool decodeInstructions_5(Instruction& instruction);
+	bool decodeInstructions_F(Instruction& instruction);
 
 private:
 	friend class cereal::access;
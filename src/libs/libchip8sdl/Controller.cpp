@@ -0,0 +1,647 @@
+#include "stdafx.h"
+#include "Controller.h"
+
+#include "Chip8.h"
+#include "Schip.h"
+#include "XoChip.h"
+
+#include <chrono>
+#include <fstream>
+
+#include <cereal/types/polymorphic.hpp>
+#ifdef _DEBUG
+#	include <cereal/archives/json.hpp>
+#else
+#	include <cereal/archives/binary.hpp>
+#endif
+#include <cereal/types/array.hpp>
+#include <cereal/types/vector.hpp>
+#include <cereal/types/unordered_set.hpp>
+
+namespace {
+	const char* const WindowTitle = "Chip-8 Emulator";
+}
+
+Controller::Controller(std::shared_ptr<Chip8> processor, const std::string& game)
+: m_processor(processor),
+  m_game(game),
+  m_colours(m_processor->display().getNumberOfColours()),
+  m_gameController(m_input),
+  m_rewind(m_processor->configuration().getRewindSeconds() * m_processor->configuration().getFramesPerSecond()),
+  m_fps(m_processor->configuration().getFramesPerSecond()) {
+}
+
+Controller::~Controller() {
+	destroyBitmapTexture();
+	destroyPixelFormat();
+	destroyRenderer();
+	destroyWindow();
+	::SDL_Quit();
+}
+
+void Controller::record(const std::string& path) {
+	m_recordingPath = path;
+	m_recording = true;
+}
+
+void Controller::replay(std::shared_ptr<const Movie> movie) {
+	m_replay = movie;
+}
+
+void Controller::trace(const std::string& path) {
+	m_trace.reset(new TraceWriter(path, m_processor->configuration()));
+}
+
+void Controller::measure(const int intervalSeconds, const bool overlay) {
+	m_metrics.reset(new FrameMetrics(m_fps));
+	m_metricsInterval = intervalSeconds;
+	m_overlay = overlay;
+}
+
+// The processor runs on its own thread, paced by the configured frame rate, so
+// that a stalled present can't hold up emulation.  Everything touching SDL stays
+// on this thread: events, sound, and drawing the last frame handed over.
+void Controller::runGameLoop() {
+
+	m_stopping = false;
+	if (m_metrics) {
+		m_metrics.reset(new FrameMetrics(m_fps));	// Timed from here, not from when measuring was asked for
+		m_nextReport = FrameMetrics::clock::now() + std::chrono::seconds(m_metricsInterval > 0 ? m_metricsInterval : 1);
+	}
+	m_emulator = std::thread(&Controller::runEmulation, this);
+
+	try {
+		while (!m_stopping) {
+			const auto started = FrameMetrics::clock::now();
+			handleEvents();
+			m_gameController.check();
+			m_keys = m_input.getKeys();
+			recordStage(FrameMetrics::Input, started);
+			updateSound();
+			draw();
+			if (m_metrics)
+				reportMetrics();
+		}
+	} catch (...) {
+		stop();
+		m_emulator.join();
+		throw;
+	}
+
+	m_emulator.join();
+	if (m_metrics)
+		m_metrics->writeSummary(std::cerr);
+	if (m_failure)
+		std::rethrow_exception(m_failure);
+
+	if (m_trace)
+		m_trace->close();
+
+	if (m_recording) {
+		::SDL_Log("Saving %d frames to %s", m_movie.getFrames(), m_recordingPath.c_str());
+		m_movie.save(m_recordingPath);
+	}
+}
+
+void Controller::runEmulation() {
+
+	typedef std::chrono::steady_clock clock;
+	const auto frameTime = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / m_fps));
+	auto deadline = clock::now();
+
+	try {
+		while (!m_stopping) {
+			bool paced;
+			{
+				std::lock_guard<std::mutex> guard(m_emulating);
+				update();
+				if (m_processor->getFinished())
+					stop();
+				paced = !m_replay;
+			}
+			if (m_metrics && m_emulated)
+				m_metrics->recordFrame(m_emulateTime, m_timersTime, m_cycles, paced && (clock::now() > (deadline + frameTime)));
+			if (!paced) {
+				deadline = clock::now();	// Replays go as fast as they will
+				continue;
+			}
+			deadline += frameTime;
+			std::this_thread::sleep_until(deadline);
+		}
+	} catch (...) {
+		m_failure = std::current_exception();
+		stop();
+	}
+}
+
+void Controller::handleEvents() {
+	::SDL_Event e;
+	while (::SDL_PollEvent(&e)) {
+		switch (e.type) {
+		case SDL_QUIT:
+			stop();
+			break;
+		case SDL_KEYDOWN:
+			handleKeyDown(e.key.keysym.sym);
+			break;
+		case SDL_KEYUP:
+			handleKeyUp(e.key.keysym.sym);
+			break;
+		case SDL_JOYDEVICEADDED:
+			SDL_Log("Joystick device added");
+			m_gameController.open();
+			break;
+		case SDL_JOYDEVICEREMOVED:
+			SDL_Log("Joystick device removed");
+			m_gameController.close();
+			break;
+		}
+	}
+}
+
+// Times from "started" to now as a stage of the render thread
+void Controller::recordStage(const FrameMetrics::Stage stage, const FrameMetrics::clock::time_point started) {
+	if (m_metrics)
+		m_metrics->record(stage, FrameMetrics::clock::now() - started);
+}
+
+// Without an interval, reports still go to the window title every second
+void Controller::reportMetrics() {
+	const auto now = FrameMetrics::clock::now();
+	if (now < m_nextReport)
+		return;
+	m_nextReport = now + std::chrono::seconds(m_metricsInterval > 0 ? m_metricsInterval : 1);
+	const auto line = m_metrics->report();
+	if (m_metricsInterval > 0)
+		std::cerr << line << std::endl;
+	if (m_overlay)
+		::SDL_SetWindowTitle(m_window, (std::string(WindowTitle) + " - " + m_metrics->getHeadline()).c_str());
+}
+
+void Controller::toggleOverlay() {
+	if (!m_metrics)
+		return;
+	m_overlay = !m_overlay;
+	::SDL_SetWindowTitle(m_window, m_overlay ? (std::string(WindowTitle) + " - " + m_metrics->getHeadline()).c_str() : WindowTitle);
+}
+
+void Controller::updateSound() {
+	const bool beeping = m_beeping;
+	if (beeping != m_sounding) {
+		m_sounding = beeping;
+		if (beeping) {
+			m_audio.play();
+			m_gameController.startRumble();
+		} else {
+			m_gameController.stopRumble();
+			m_audio.pause();
+		}
+	}
+}
+
+void Controller::toggleFullscreen() {
+	auto wasFullscreen = ::SDL_GetWindowFlags(m_window) & SDL_WINDOW_FULLSCREEN_DESKTOP;
+	verifySDLCall(::SDL_SetWindowFullscreen(m_window, wasFullscreen ? 0 : SDL_WINDOW_FULLSCREEN_DESKTOP), "Failed to modify the window full screen setting");
+	::SDL_ShowCursor(wasFullscreen ? 1 : 0);
+}
+
+// CHIP-8 Keyboard layout
+//  1   2   3   C
+//  4   5   6   D
+//  7   8   9   E
+//  A   0   B   F
+const std::array<SDL_Keycode, 16> Controller::KeypadMapping = { {
+				SDLK_x,
+
+	SDLK_1,		SDLK_2,		SDLK_3,
+	SDLK_q,     SDLK_w,     SDLK_e,
+	SDLK_a,     SDLK_s,     SDLK_d,
+
+	SDLK_z,                 SDLK_c,
+
+	SDLK_4,
+	SDLK_r,
+	SDLK_f,
+	SDLK_v
+} };
+
+int Controller::mapKey(SDL_Keycode key) {
+	auto found = std::find(KeypadMapping.cbegin(), KeypadMapping.cend(), key);
+	return found == KeypadMapping.cend() ? -1 : (int)(found - KeypadMapping.cbegin());
+}
+
+void Controller::handleKeyDown(SDL_Keycode key) {
+	switch (key) {
+	case SDLK_BACKSPACE:
+		m_rewinding = true;
+		break;
+	case SDLK_F9:
+	case SDLK_F10:
+	case SDLK_F11:
+	case SDLK_F12:
+		// Don't let it get poked.
+		break;
+	default: {
+			auto mapped = mapKey(key);
+			if (mapped != -1)
+				m_input.pokeKey(mapped);
+		}
+		break;
+	}
+}
+
+void Controller::handleKeyUp(SDL_Keycode key) {
+	switch (key) {
+	case SDLK_BACKSPACE:
+		m_rewinding = false;
+		break;
+	case SDLK_F9:
+		toggleOverlay();
+		break;
+	case SDLK_F10: {
+			std::lock_guard<std::mutex> guard(m_emulating);
+			saveState();
+		}
+		break;
+	case SDLK_F11: {
+			std::lock_guard<std::mutex> guard(m_emulating);
+			loadState();
+		}
+		break;
+	case SDLK_F12:
+		toggleFullscreen();
+		break;
+	default: {
+			auto mapped = mapKey(key);
+			if (mapped != -1)
+				m_input.pullKey(mapped);
+		}
+		break;
+	}
+}
+
+void Controller::update() {
+	m_emulated = false;
+	if (m_rewinding && !m_replay) {
+		rewindFrame();
+		return;
+	}
+	m_rewind.record(*m_processor);
+	const uint16_t keys = m_replay ? m_replay->getKeys(m_frame) : m_keys.load();
+	m_processor->keyboard().setKeys(keys);
+	const auto started = FrameMetrics::clock::now();
+	m_cycles = runFrame();
+	const auto ran = FrameMetrics::clock::now();
+	m_processor->updateTimers();
+	m_emulateTime = ran - started;
+	m_timersTime = FrameMetrics::clock::now() - ran;
+	m_emulated = true;
+	if (m_recording)
+		m_movie.record(keys, *m_processor);
+	if (m_replay)
+		checkReplay();
+	++m_frame;
+	if (m_processor->getDrawNeeded())
+		publishFrame();
+}
+
+void Controller::checkReplay() {
+	if (!m_desynchronised && !m_replay->verify(m_frame, *m_processor)) {
+		m_desynchronised = true;
+		::SDL_LogWarn(::SDL_LOG_CATEGORY_APPLICATION, "Replay no longer matches the recording at frame %d", m_frame);
+	}
+	if ((m_frame + 1) >= m_replay->getFrames()) {
+		::SDL_Log("Replay finished after %d frames%s", m_frame + 1, m_desynchronised ? ", out of step" : "");
+		stop();
+	}
+}
+
+// A frame back for every frame forward, so holding the key rewinds in real time
+void Controller::rewindFrame() {
+	m_beeping = false;
+	if (m_rewind.rewind(*m_processor)) {
+		m_movie.truncate(--m_frame);
+		m_processor->setDrawNeeded();
+		publishFrame();
+	}
+}
+
+// Rows damaged in a frame the render thread skipped are carried into the next one
+void Controller::publishFrame() {
+	auto& frame = m_frames.back();
+	const auto unseen = m_unseen ? frame.getDirtyRows() : 0;
+	frame = m_processor->display();
+	frame.setDirtyRows(frame.getDirtyRows() | unseen);
+	m_unseen = m_frames.publish();
+	if (m_unseen && m_metrics)
+		m_metrics->recordDropped();
+	m_processor->setDrawNeeded(false);
+}
+
+int Controller::runFrame() {
+	return m_processor->runFrame();
+}
+
+void Controller::stop() {
+	m_stopping = true;
+}
+
+void Controller::loadContent() {
+
+	verifySDLCall(::SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_GAMECONTROLLER | SDL_INIT_HAPTIC), "Failed to initialise SDL: ");
+
+	m_processor->initialise();
+
+	m_window = ::SDL_CreateWindow(WindowTitle, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, getScreenWidth(), getScreenHeight(), SDL_WINDOW_SHOWN);
+	if (m_window == nullptr) {
+		throwSDLException("Unable to create window: ");
+	}
+
+	::SDL_DisplayMode mode;
+	verifySDLCall(::SDL_GetWindowDisplayMode(m_window, &mode), "Unable to obtain window information");
+
+	const auto& configuration = m_processor->configuration();
+
+	m_vsync = configuration.getVsyncLocked();
+	Uint32 rendererFlags = 0;
+	if (m_vsync) {
+		auto required = configuration.getFramesPerSecond();
+		if (required == mode.refresh_rate) {
+			rendererFlags |= SDL_RENDERER_PRESENTVSYNC;
+			::SDL_Log("Attempting to use SDL_RENDERER_PRESENTVSYNC");
+		} else {
+			m_vsync = false;
+			::SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Display refresh rate is incompatible with required rate (%d)", required);
+		}
+	}
+	m_renderer = ::SDL_CreateRenderer(m_window, -1, rendererFlags);
+	if (m_renderer == nullptr) {
+		throwSDLException("Unable to create renderer: ");
+	}
+
+	::SDL_Log("Available renderers:");
+	dumpRendererInformation();
+
+	::SDL_RendererInfo info;
+	verifySDLCall(::SDL_GetRendererInfo(m_renderer, &info), "Unable to obtain renderer information");
+	::SDL_Log("Using renderer:");
+	dumpRendererInformation(info);
+
+	if (m_vsync) {
+		if ((info.flags & SDL_RENDERER_PRESENTVSYNC) == 0) {
+			::SDL_LogWarn(::SDL_LOG_CATEGORY_APPLICATION, "Renderer does not support VSYNC, reverting to timed delay loop.");
+			m_vsync = false;
+		}
+	}
+
+	m_pixelFormat = ::SDL_AllocFormat(m_pixelType);
+	if (m_pixelFormat == nullptr) {
+		throwSDLException("Unable to allocate pixel format: ");
+	}
+	m_colours.load(m_pixelFormat);
+
+	m_processor->BeepStarting.connect(std::bind(&Controller::Processor_BeepStarting, this));
+	m_processor->BeepStopped.connect(std::bind(&Controller::Processor_BeepStopped, this));
+
+	const auto debugging = m_processor->configuration().isDebugMode();
+	if (debugging || m_trace)
+		m_processor->EmulatingCycle.connect(std::bind(&Controller::Processor_EmulatingCycle, this, std::placeholders::_1));
+	if (debugging)
+		m_processor->EmulatedCycle.connect(std::bind(&Controller::Processor_EmulatedCycle, this, std::placeholders::_1));
+
+	m_gameController.initialise();
+
+	startGame();
+	configureBackground();
+	createBitmapTexture(getDisplayWidth(), getDisplayHeight());
+
+	m_audio.initialise();
+}
+
+void Controller::startGame() {
+	if (m_replay) {
+		m_replay->prepare(*m_processor);
+		return;
+	}
+	m_processor->loadGame(m_game);
+	if (m_recording)
+		m_movie.start(*m_processor);
+}
+
+void Controller::destroyBitmapTexture() {
+	if (m_bitmapTexture != nullptr) {
+		::SDL_DestroyTexture(m_bitmapTexture);
+	}
+}
+
+void Controller::destroyPixelFormat() {
+	if (m_pixelFormat != nullptr) {
+		::SDL_FreeFormat(m_pixelFormat);
+	}
+}
+
+void Controller::destroyRenderer() {
+	if (m_renderer != nullptr) {
+		::SDL_DestroyRenderer(m_renderer);
+	}
+}
+
+void Controller::destroyWindow() {
+	if (m_window != nullptr) {
+		::SDL_DestroyWindow(m_window);
+	}
+}
+
+void Controller::recreateBitmapTexture(const int width, const int height) {
+	destroyBitmapTexture();
+	createBitmapTexture(width, height);
+}
+
+void Controller::createBitmapTexture(const int width, const int height) {
+	m_bitmapTexture = ::SDL_CreateTexture(m_renderer, m_pixelType, SDL_TEXTUREACCESS_STREAMING, width, height);
+	if (m_bitmapTexture == nullptr) {
+		throwSDLException("Unable to create bitmap texture");
+	}
+	m_textureWidth = width;
+	m_textureHeight = height;
+}
+
+void Controller::configureBackground() const {
+	Uint8 r, g, b;
+	::SDL_GetRGB(m_colours.getColour(0), m_pixelFormat, &r, &g, &b);
+	verifySDLCall(::SDL_SetRenderDrawColor(m_renderer, r, g, b, SDL_ALPHA_OPAQUE), "Unable to set render draw colour");
+}
+
+void Controller::draw() {
+	auto drawNeeded = m_frames.take();
+	if (drawNeeded) {
+		const auto started = FrameMetrics::clock::now();
+		drawFrame(m_frames.front());
+		if (m_overlay)
+			drawOverlay();
+		recordStage(FrameMetrics::Draw, started);
+	}
+	if (m_vsync || drawNeeded) {
+		const auto started = FrameMetrics::clock::now();
+		::SDL_RenderPresent(m_renderer);
+		recordStage(FrameMetrics::Present, started);
+	} else {
+		::SDL_Delay(1);
+	}
+}
+
+void Controller::drawFrame(const BitmappedGraphics& display) {
+
+	auto displayWidth = display.getWidth();
+	auto displayHeight = display.getHeight();
+
+	// A new texture starts out empty, so every row of it is drawn
+	const auto recreated = (displayWidth != m_textureWidth) || (displayHeight != m_textureHeight);
+	if (recreated)
+		recreateBitmapTexture(displayWidth, displayHeight);
+
+	const auto damaged = [&display, recreated](int row) {
+		return recreated || display.isRowDirty(row);
+	};
+
+	// Only runs of damaged rows are recomposed and uploaded
+	for (int first = 0; first < displayHeight; ) {
+		if (!damaged(first)) {
+			++first;
+			continue;
+		}
+
+		auto last = first;
+		while (((last + 1) < displayHeight) && damaged(last + 1))
+			++last;
+
+		::SDL_Rect rows = { 0, first, displayWidth, last - first + 1 };
+		drawRows(display, rows);
+
+		first = last + 1;
+	}
+
+	verifySDLCall(::SDL_RenderCopy(m_renderer, m_bitmapTexture, NULL, NULL), "Unable to copy texture to renderer");
+}
+
+// Composes straight into the texture: no copy of the planes, no staging buffer
+void Controller::drawRows(const BitmappedGraphics& display, const SDL_Rect& rows) {
+
+	void* pixels = nullptr;
+	int pitch = 0;
+	verifySDLCall(::SDL_LockTexture(m_bitmapTexture, &rows, &pixels, &pitch), "Unable to lock texture: ");
+
+	const auto palette = &m_colours.getColours()[0];
+
+	auto destination = static_cast<Uint8*>(pixels);
+	for (int y = rows.y; y < (rows.y + rows.h); ++y, destination += pitch)
+		display.composeRow(y, palette, reinterpret_cast<Uint32*>(destination));
+
+	::SDL_UnlockTexture(m_bitmapTexture);
+}
+
+// A bar for each recent emulated frame, as tall as the frame took against a line
+// at the frame's budget, along the bottom of the window.  Late frames are red.
+void Controller::drawOverlay() {
+
+	int width = 0;
+	int height = 0;
+	verifySDLCall(::SDL_GetRendererOutputSize(m_renderer, &width, &height), "Unable to obtain renderer output size: ");
+
+	const auto budgetHeight = height / 4;
+	const auto budget = 1e6 / m_metrics->getFramesPerSecond();	// Microseconds
+	const auto barWidth = std::max(1, width / (int)FrameMetrics::RecentFrames);
+
+	std::array<SDL_Rect, FrameMetrics::RecentFrames> onTime;
+	std::array<SDL_Rect, FrameMetrics::RecentFrames> late;
+	int onTimeCount = 0;
+	int lateCount = 0;
+	const auto recent = m_metrics->getRecent();
+	for (int i = 0; i < (int)recent.size(); ++i) {
+		const auto barHeight = std::min(2 * budgetHeight, (int)(recent[i].microseconds / budget * budgetHeight));
+		if (barHeight == 0)
+			continue;
+		const SDL_Rect bar = { i * barWidth, height - barHeight, std::max(1, barWidth - 1), barHeight };
+		if (recent[i].late)
+			late[lateCount++] = bar;
+		else
+			onTime[onTimeCount++] = bar;
+	}
+
+	verifySDLCall(::SDL_SetRenderDrawColor(m_renderer, 0x40, 0xc0, 0x40, SDL_ALPHA_OPAQUE), "Unable to set render draw colour");
+	verifySDLCall(::SDL_RenderFillRects(m_renderer, onTime.data(), onTimeCount), "Unable to draw overlay: ");
+	verifySDLCall(::SDL_SetRenderDrawColor(m_renderer, 0xe0, 0x40, 0x40, SDL_ALPHA_OPAQUE), "Unable to set render draw colour");
+	verifySDLCall(::SDL_RenderFillRects(m_renderer, late.data(), lateCount), "Unable to draw overlay: ");
+	verifySDLCall(::SDL_SetRenderDrawColor(m_renderer, 0xff, 0xff, 0xff, SDL_ALPHA_OPAQUE), "Unable to set render draw colour");
+	verifySDLCall(::SDL_RenderDrawLine(m_renderer, 0, height - budgetHeight, width - 1, height - budgetHeight), "Unable to draw overlay: ");
+
+	configureBackground();
+}
+
+void Controller::Processor_BeepStarting() {
+	m_beeping = true;
+}
+
+void Controller::Processor_BeepStopped() {
+	m_beeping = false;
+}
+
+void Controller::dumpRendererInformation() {
+	auto count = ::SDL_GetNumRenderDrivers();
+	for (int i = 0; i < count; ++i) {
+		::SDL_RendererInfo info;
+		verifySDLCall(::SDL_GetRenderDriverInfo(i, &info), "Unable to obtain renderer information");
+		dumpRendererInformation(info);
+	}
+}
+
+void Controller::dumpRendererInformation(::SDL_RendererInfo info) {
+	auto name = info.name;
+	auto flags = info.flags;
+	int software = (flags & SDL_RENDERER_SOFTWARE) != 0;
+	int accelerated = (flags & SDL_RENDERER_ACCELERATED) != 0;
+	int vsync = (flags & SDL_RENDERER_PRESENTVSYNC) != 0;
+	int targetTexture = (flags & SDL_RENDERER_TARGETTEXTURE) != 0;
+	::SDL_Log("%s: software=%d, accelerated=%d, vsync=%d, target texture=%d", name, software, accelerated, vsync, targetTexture);
+}
+
+void Controller::saveState() const {
+	::SDL_Log("Saving state");
+#ifdef _DEBUG
+	std::ofstream ofs("state");
+	cereal::JSONOutputArchive archive(ofs);
+#else
+	std::ofstream ofs("state", std::ios::binary);
+	cereal::BinaryOutputArchive archive(ofs);
+#endif
+	archive(*this);
+}
+
+void Controller::loadState() {
+	::SDL_Log("Loading state");
+#ifdef _DEBUG
+	std::ifstream ifs("state");
+	cereal::JSONInputArchive archive(ifs);
+#else
+	std::ifstream ifs("state", std::ios::binary);
+	cereal::BinaryInputArchive archive(ifs);
+#endif
+	archive(*this);
+	m_processor->setDrawNeeded();	// The texture no longer matches the display
+	if (m_recording || m_replay) {
+		::SDL_LogWarn(::SDL_LOG_CATEGORY_APPLICATION, "A loaded state can't be part of a movie: recording and replay have stopped");
+		m_recording = false;
+		m_replay.reset();
+	}
+}
+
+// Only a record is taken here: the binary trace is formatted later, by chip8_tracedecode
+void Controller::Processor_EmulatingCycle(const InstructionEventArgs& cycleEvent) {
+	m_processorState = TraceRecord::capture(cycleEvent.getProgramCounter(), cycleEvent.getInstruction(), *m_processor);
+	if (m_trace)
+		m_trace->append(m_processorState);
+}
+
+void Controller::Processor_EmulatedCycle(const InstructionEventArgs&) {
+	DisassemblyOutput.fire(DisassemblyEventArgs(m_disassembler.trace(m_processorState, m_processor->configuration())));
+}
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <SDL.h>
+
+#include "AudioDevice.h"
+#include "Chip8.h"
+#include "ColourPalette.h"
+#include "Disassembler.h"
+#include "DisassemblyEventArgs.h"
+#include "FrameMetrics.h"
+#include "GameController.h"
+#include "KeyboardDevice.h"
+#include "Movie.h"
+#include "RewindBuffer.h"
+#include "Trace.h"
+#include "TripleBuffer.h"
+
+class InstructionEventArgs;
+
+class Controller final {
+public:
+	enum {
+		DisplayScale = 10
+	};
+
+	static void throwSDLException(const std::string& failure) {
+		throw std::runtime_error(failure + ::SDL_GetError());
+	}
+
+	static void verifySDLCall(int returned, const std::string& failure) {
+		if (returned < 0) {
+			throwSDLException(failure);
+		}
+	}
+
+	Controller(std::shared_ptr<Chip8> processor, const std::string& game);
+	~Controller();
+
+	Signal<DisassemblyEventArgs> DisassemblyOutput;
+
+	// Either of these has to be chosen before loadContent
+	void record(const std::string& path);
+	void replay(std::shared_ptr<const Movie> movie);
+
+	// Writes a binary trace of every instruction executed to the given file
+	void trace(const std::string& path);
+
+	// Times each stage of every frame, writing a summary to standard error at exit.
+	// Given an interval, a line of JSON is also written every that many seconds;
+	// the overlay (toggled by F9) charts recent frame times over the display.
+	void measure(int intervalSeconds, bool overlay);
+
+	virtual void runGameLoop();
+	virtual void loadContent();
+
+	int getDisplayWidth() const {
+		return m_processor->display().getWidth();
+	}
+
+	int getDisplayHeight() const {
+		return m_processor->display().getHeight();
+	}
+
+	int getScreenWidth() const {
+		return getDisplayWidth() * DisplayScale;
+	}
+
+	int getScreenHeight() const {
+		return getDisplayHeight() * DisplayScale;
+	}
+
+protected:
+	// Emulation thread
+	virtual void update();
+	virtual int runFrame();
+
+	// Render thread
+	virtual void draw();
+
+	void stop();
+
+private:
+	friend class cereal::access;
+
+	template<class Archive> void serialize(Archive& archive) {
+		archive(
+			m_processor,
+			m_gameController
+		);
+	}
+
+	std::shared_ptr<Chip8> m_processor;
+	std::string m_game;
+	ColourPalette m_colours;
+
+	// Gathered on the render thread, read by the emulation thread
+	KeyboardDevice m_input;
+	std::atomic<uint16_t> m_keys { 0 };
+
+	GameController m_gameController;
+
+	std::thread m_emulator;
+	std::mutex m_emulating;	// Held while the emulation thread runs a frame
+	std::atomic<bool> m_stopping { false };
+	std::exception_ptr m_failure;
+
+	// Recorded every frame by the emulation thread, which steps back through
+	// it instead while the rewind key is held
+	RewindBuffer m_rewind;
+	std::atomic<bool> m_rewinding { false };
+
+	// Movies are driven from the emulation thread.  A replay runs unpaced,
+	// taking its keys from the movie rather than the keyboard.
+	int m_frame = 0;
+	std::string m_recordingPath;
+	bool m_recording = false;
+	Movie m_movie;
+	std::shared_ptr<const Movie> m_replay;
+	bool m_desynchronised = false;
+
+	TripleBuffer<BitmappedGraphics> m_frames;
+	bool m_unseen = false;	// Whether back() holds rows the render thread never drew
+
+	std::atomic<bool> m_beeping { false };
+	bool m_sounding = false;
+
+	SDL_Window* m_window = nullptr;
+	SDL_Renderer* m_renderer = nullptr;
+
+	SDL_Texture* m_bitmapTexture = nullptr;
+	int m_textureWidth = 0;
+	int m_textureHeight = 0;
+	Uint32 m_pixelType = SDL_PIXELFORMAT_ARGB8888;
+	SDL_PixelFormat* m_pixelFormat = nullptr;
+
+	AudioDevice m_audio;
+
+	int m_fps;
+	bool m_vsync = false;
+
+	Disassembler m_disassembler;
+	TraceRecord m_processorState;
+	std::unique_ptr<TraceWriter> m_trace;
+
+	std::unique_ptr<FrameMetrics> m_metrics;
+	int m_metricsInterval = 0;
+	bool m_overlay = false;
+	FrameMetrics::clock::time_point m_nextReport;
+
+	// The emulation thread's timing of the frame update() just ran, held until
+	// it knows whether the frame was late
+	bool m_emulated = false;
+	int m_cycles = 0;
+	FrameMetrics::clock::duration m_emulateTime;
+	FrameMetrics::clock::duration m_timersTime;
+
+	void runEmulation();
+	void startGame();
+	void rewindFrame();
+	void checkReplay();
+	void publishFrame();
+
+	void handleEvents();
+	void updateSound();
+
+	void recordStage(FrameMetrics::Stage stage, FrameMetrics::clock::time_point started);
+	void reportMetrics();
+	void toggleOverlay();
+	void drawOverlay();
+
+	void configureBackground() const;
+	void drawFrame(const BitmappedGraphics& display);
+	void drawRows(const BitmappedGraphics& display, const SDL_Rect& rows);
+
+	// CHIP-8 key n is read from host key KeypadMapping[n]
+	static const std::array<SDL_Keycode, 16> KeypadMapping;
+	static int mapKey(SDL_Keycode key);
+
+	void handleKeyDown(SDL_Keycode key);
+	void handleKeyUp(SDL_Keycode key);
+
+	void toggleFullscreen();
+
+	void createBitmapTexture(int width, int height);
+	void recreateBitmapTexture(int width, int height);
+
+	void destroyBitmapTexture();
+	void destroyPixelFormat();
+	void destroyRenderer();
+	void destroyWindow();
+
+	void Processor_BeepStarting();
+	void Processor_BeepStopped();
+
+	static void dumpRendererInformation();
+	static void dumpRendererInformation(::SDL_RendererInfo info);
+
+	void saveState() const;
+	void loadState();
+
+	void Processor_EmulatingCycle(const InstructionEventArgs& addressEvent);
+	void Processor_EmulatedCycle(const InstructionEventArgs&);
+};
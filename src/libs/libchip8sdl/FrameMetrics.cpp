@@ -0,0 +1,152 @@
+#include "stdafx.h"
+#include "FrameMetrics.h"
+
+namespace {
+
+	double toMicroseconds(const uint64_t nanoseconds) {
+		return nanoseconds / 1000.0;
+	}
+
+	double toMilliseconds(const uint64_t nanoseconds) {
+		return nanoseconds / 1e6;
+	}
+}
+
+void FrameMetrics::Period::add(const Period& other) {
+	for (size_t stage = 0; stage < stages.size(); ++stage)
+		stages[stage].add(other.stages[stage]);
+	frames += other.frames;
+	instructions += other.instructions;
+	late += other.late;
+	dropped += other.dropped;
+}
+
+void FrameMetrics::Period::reset() {
+	for (auto& stage : stages)
+		stage.reset();
+	frames = instructions = late = dropped = 0;
+}
+
+FrameMetrics::FrameMetrics(const int framesPerSecond)
+: m_framesPerSecond(framesPerSecond),
+  m_started(clock::now()),
+  m_intervalStarted(m_started) {}
+
+void FrameMetrics::recordFrame(const clock::duration emulate, const clock::duration timers, const int instructions, const bool late) {
+	const auto emulateNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(emulate).count();
+	const auto timersNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(timers).count();
+
+	std::lock_guard<std::mutex> guard(m_lock);
+	m_emulation.stages[Emulate].record(emulateNanoseconds);
+	m_emulation.stages[Timers].record(timersNanoseconds);
+	++m_emulation.frames;
+	m_emulation.instructions += instructions;
+	if (late)
+		++m_emulation.late;
+
+	auto& recent = m_recent[m_nextRecent];
+	recent.microseconds = (uint32_t)((emulateNanoseconds + timersNanoseconds) / 1000);
+	recent.late = late;
+	m_nextRecent = (m_nextRecent + 1) % RecentFrames;
+}
+
+void FrameMetrics::recordDropped() {
+	std::lock_guard<std::mutex> guard(m_lock);
+	++m_emulation.dropped;
+}
+
+std::array<FrameMetrics::Recent, FrameMetrics::RecentFrames> FrameMetrics::getRecent() const {
+	std::array<Recent, RecentFrames> recent;
+	std::lock_guard<std::mutex> guard(m_lock);
+	for (int i = 0; i < RecentFrames; ++i)
+		recent[i] = m_recent[(m_nextRecent + i) % RecentFrames];
+	return recent;
+}
+
+FrameMetrics::Period FrameMetrics::takeInterval(double& seconds) {
+	const auto now = clock::now();
+	seconds = std::chrono::duration<double>(now - m_intervalStarted).count();
+	m_intervalStarted = now;
+
+	Period interval;
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		interval = m_emulation;
+		m_emulation.reset();
+	}
+	interval.add(m_render);
+	m_render.reset();
+	m_total.add(interval);
+	return interval;
+}
+
+std::string FrameMetrics::report() {
+
+	double seconds;
+	const auto interval = takeInterval(seconds);
+	const auto perSecond = [seconds](uint64_t count) {
+		return seconds > 0.0 ? count / seconds : 0.0;
+	};
+
+	std::ostringstream line;
+	line
+		<< boost::format("{ \"seconds\": %.3f, \"frames\": %d, \"instructions\": %d, \"instructionsPerSecond\": %.0f, \"late\": %d, \"dropped\": %d, \"stages\": {")
+			% seconds % interval.frames % interval.instructions % perSecond(interval.instructions) % interval.late % interval.dropped;
+	for (int stage = 0; stage < NumberOfStages; ++stage) {
+		const auto& histogram = interval.stages[stage];
+		line
+			<< (stage == 0 ? " " : ", ")
+			<< boost::format("\"%s\": { \"count\": %d, \"p50\": %.1f, \"p99\": %.1f, \"max\": %.1f }")
+				% getName((Stage)stage) % histogram.getCount()
+				% toMicroseconds(histogram.getValueAtPercentile(50)) % toMicroseconds(histogram.getValueAtPercentile(99)) % toMicroseconds(histogram.getMaximum());
+	}
+	line << " } }";
+
+	m_headline = (boost::format("%.0f fps, %.2fM instructions/s, p99 emulate %.2fms draw %.2fms present %.2fms, %d late, %d dropped")
+		% perSecond(interval.frames) % (perSecond(interval.instructions) / 1e6)
+		% toMilliseconds(interval.stages[Emulate].getValueAtPercentile(99))
+		% toMilliseconds(interval.stages[Draw].getValueAtPercentile(99))
+		% toMilliseconds(interval.stages[Present].getValueAtPercentile(99))
+		% interval.late % interval.dropped).str();
+
+	return line.str();
+}
+
+void FrameMetrics::writeSummary(std::ostream& output) {
+
+	double seconds;
+	takeInterval(seconds);
+	seconds = std::chrono::duration<double>(m_intervalStarted - m_started).count();
+	const auto instructionsPerSecond = seconds > 0.0 ? m_total.instructions / seconds : 0.0;
+
+	output
+		<< boost::format("%.1fs: %d frames, %d instructions (%.0f/s), %d late, %d dropped\n")
+			% seconds % m_total.frames % m_total.instructions % instructionsPerSecond % m_total.late % m_total.dropped
+		<< boost::format("%-8s %10s %10s %10s %10s %10s\n") % "Stage" % "Count" % "p50 us" % "p99 us" % "Max us" % "Mean us";
+
+	boost::format row("%-8s %10d %10.1f %10.1f %10.1f %10.1f\n");
+	for (int stage = 0; stage < NumberOfStages; ++stage) {
+		const auto& histogram = m_total.stages[stage];
+		output
+			<< row % getName((Stage)stage) % histogram.getCount()
+				% toMicroseconds(histogram.getValueAtPercentile(50)) % toMicroseconds(histogram.getValueAtPercentile(99))
+				% toMicroseconds(histogram.getMaximum()) % (histogram.getMean() / 1000.0);
+	}
+}
+
+const char* FrameMetrics::getName(const Stage stage) {
+	switch (stage) {
+	case Input:
+		return "input";
+	case Emulate:
+		return "emulate";
+	case Timers:
+		return "timers";
+	case Draw:
+		return "draw";
+	case Present:
+		return "present";
+	default:
+		return "unknown";
+	}
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+#include <Histogram.h>
+
+// Where the controller's time goes, frame by frame: a histogram of each stage
+// of the emulation and render threads, with counts of the instructions run,
+// frames that finished after their deadline and frames the renderer never
+// drew.
+//
+// Each thread records its own stages.  The emulation thread's are kept behind
+// a lock that the render thread takes once a report, so reports come from the
+// render thread (or after the emulation thread has finished).
+class FrameMetrics final {
+public:
+	typedef std::chrono::steady_clock clock;
+
+	enum Stage {
+		Input,		// Render thread: SDL events and the game controller
+		Emulate,	// Emulation thread: the processor's frame
+		Timers,		// Emulation thread
+		Draw,		// Render thread: recomposing damaged rows into the texture
+		Present,	// Render thread: including any wait for vsync
+		NumberOfStages
+	};
+
+	enum {
+		RecentFrames = 128	// Frame times kept for the overlay
+	};
+
+	// A frame on the emulation thread: its busy time, in microseconds, and whether it was late
+	struct Recent {
+		uint32_t microseconds = 0;
+		bool late = false;
+	};
+
+	explicit FrameMetrics(int framesPerSecond);
+
+	// Emulation thread
+
+	void recordFrame(clock::duration emulate, clock::duration timers, int instructions, bool late);
+
+	// A published frame replaced one the render thread never took
+	void recordDropped();
+
+	// Render thread
+
+	void record(Stage stage, clock::duration elapsed) {
+		m_render.stages[stage].record(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+	}
+
+	// Starts a new interval, returning the last one as a line of JSON
+	std::string report();
+
+	// A short summary of the last interval reported, for the window title
+	const std::string& getHeadline() const {
+		return m_headline;
+	}
+
+	// The emulation thread's most recent frames, oldest first
+	std::array<Recent, RecentFrames> getRecent() const;
+
+	int getFramesPerSecond() const {
+		return m_framesPerSecond;
+	}
+
+	// Everything reported, and anything since
+	void writeSummary(std::ostream& output);
+
+	static const char* getName(Stage stage);
+
+private:
+	struct Period {
+		std::array<Histogram, NumberOfStages> stages;
+		uint64_t frames = 0;
+		uint64_t instructions = 0;
+		uint64_t late = 0;
+		uint64_t dropped = 0;
+
+		void add(const Period& other);
+		void reset();
+	};
+
+	int m_framesPerSecond;
+
+	mutable std::mutex m_lock;	// Guards the emulation thread's period and recent frames
+	Period m_emulation;
+	std::array<Recent, RecentFrames> m_recent;
+	int m_nextRecent = 0;
+
+	Period m_render;
+	Period m_total;
+	clock::time_point m_started;
+	clock::time_point m_intervalStarted;
+	std::string m_headline;
+
+	Period takeInterval(double& seconds);
+};
@@ -24,9 +24,9 @@ void GameController::checkButton(SDL_GameControllerButton button, int mapping) {
 	auto activated = ::SDL_GameControllerGetButton(m_gameController, button);
 	if (activated != m_controllerButtons[mapping]) {
 		if (activated) {
-			m_keyboard.pokeKey(m_keyboard.getMapping()[mapping]);
+			m_keyboard.pokeKey(mapping);
 		} else {
-			m_keyboard.pullKey(m_keyboard.getMapping()[mapping]);
+			m_keyboard.pullKey(mapping);
 		}
 		m_controllerButtons[mapping] = activated;
 	}
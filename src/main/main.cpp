@@ -1,9 +1,13 @@
 #include "stdafx.h"
 
 #include <Controller.h>
+#include <ProcessorFactory.h>
 #include <Configuration.h>
 #include <Chip8.h>
+#include <Movie.h>
+#include <Profiler.h>
 
+#include <fstream>
 #include <iostream>
 #include <boost/program_options.hpp>
 
@@ -23,10 +27,20 @@ static po::variables_map processCommandLine(int argc, char* argv[]) {
 		("debug",						po::value<bool>()->default_value(DefaultDebugMode),		"debug mode")
 		("processor-type",				po::value<std::string>()->default_value("schip"),		"Processor type.  Can be one of chip, schip or xochip")
 		("allow-misaligned-opcodes",	po::value<bool>(),										"Allow instuctions to be loaded from odd addresses")
-		("rom",							po::value<std::string>()->required(),					"ROM to use")
+		("translate-blocks",			po::value<bool>(),										"Translate straight-line runs of instructions into blocks")
+		("rom",							po::value<std::string>(),								"ROM to use")
+		("record",						po::value<std::string>(),								"Record the keys pressed to a movie file")
+		("replay",						po::value<std::string>(),								"Replay a movie file as fast as possible, in place of a ROM")
+		("trace",						po::value<std::string>(),								"Write a binary trace of every instruction to a file (see chip8_tracedecode)")
+		("metrics",						po::value<bool>()->default_value(false),				"Time each stage of every frame, writing a summary to standard error at exit")
+		("metrics-interval",			po::value<int>()->default_value(0),					"Also write frame metrics to standard error as a line of JSON every this many seconds (0: never)")
+		("metrics-overlay",				po::value<bool>()->default_value(false),				"Also chart recent frame times over the display, and show the metrics in the title (F9 toggles)")
+		("profile",						po::value<std::string>(),								"Count instructions by opcode and address, writing them to a JSON file and a table to standard output at exit (needs make profile)")
 		("graphics-count-row-hits",		po::value<bool>(),										"Graphics: count row hits")
 		("graphics-count-exceeded-rows",po::value<bool>(),										"Graphics: count exceeded rows")
 		("cycles-per-frame",			po::value<int>(),										"cycles per frame")
+		("seed",						po::value<uint32_t>(),									"Seed for RND (0: a different one each run)")
+		("rewind-seconds",				po::value<int>(),										"Seconds of play that can be rewound by holding backspace (0: off)")
 		("graphics-clip",				po::value<bool>()->default_value(true),					"Graphics: clip")
 		("chip8-shifts",				po::value<bool>()->default_value(false),				"use chip8 shifts (uses VY)")
 		("chip8-load-save",				po::value<bool>()->default_value(false),				"use chip8 load and save (modifies I)")
@@ -80,6 +94,11 @@ int main(int argc, char* argv[]) {
 		configuration.setAllowMisalignedOpcodes(allowMisalignedOpCodesOption.as<bool>());
 	}
 
+	auto translateBlocksOption = options["translate-blocks"];
+	if (!translateBlocksOption.empty()) {
+		configuration.setTranslateBlocks(translateBlocksOption.as<bool>());
+	}
+
 	auto graphicsCountRowHitsOption = options["graphics-count-row-hits"];
 	if (!graphicsCountRowHitsOption.empty()) {
 		configuration.setGraphicsCountRowHits(graphicsCountRowHitsOption.as<bool>());
@@ -95,28 +114,105 @@ int main(int argc, char* argv[]) {
 		configuration.setCyclesPerFrame(cyclesPerFrameOption.as<int>());
 	}
 
+	auto seedOption = options["seed"];
+	if (!seedOption.empty()) {
+		configuration.setRandomSeed(seedOption.as<uint32_t>());
+	}
+
+	auto rewindSecondsOption = options["rewind-seconds"];
+	if (!rewindSecondsOption.empty()) {
+		configuration.setRewindSeconds(rewindSecondsOption.as<int>());
+	}
+
 	configuration.setGraphicsClip(options["graphics-clip"].as<bool>());
 
 	configuration.setChip8Shifts(options["chip8-shifts"].as<bool>());
 	configuration.setChip8LoadAndSave(options["chip8-load-save"].as<bool>());
 	configuration.setChip8IndexedJumps(options["chip8-indexed-jumps"].as<bool>());
 
-	std::shared_ptr<Chip8> processor(Controller::buildProcessor(configuration));
+	// A replay runs as recorded, whatever the command line says
+	auto replayOption = options["replay"];
+	std::shared_ptr<Movie> movie;
+	if (!replayOption.empty()) {
+		movie = std::make_shared<Movie>();
+		try {
+			movie->load(replayOption.as<std::string>());
+		} catch (std::exception& error) {
+			::SDL_LogError(::SDL_LOG_CATEGORY_APPLICATION, "%s", error.what());
+			return 1;
+		}
+		auto recorded = movie->configuration();
+		recorded.setDebugMode(configuration.isDebugMode());
+		recorded.setRewindSeconds(configuration.getRewindSeconds());
+		configuration = recorded;
+	}
 
-	// Because this option is required, we don't need to check whether it's there or not.
-	auto game = options["rom"].as<std::string>();
+	auto romOption = options["rom"];
+	auto recordOption = options["record"];
+	if (movie ? !recordOption.empty() : romOption.empty()) {
+		::SDL_LogError(::SDL_LOG_CATEGORY_APPLICATION, "Either a ROM (which may be recorded) or a movie to replay is needed");
+		return 1;
+	}
+
+	std::shared_ptr<Chip8> processor(ProcessorFactory::buildProcessor(configuration));
+
+	auto game = romOption.empty() ? std::string() : romOption.as<std::string>();
 	Controller controller(processor, game);
 
+	if (movie)
+		controller.replay(movie);
+	else if (!recordOption.empty())
+		controller.record(recordOption.as<std::string>());
+
+	auto traceOption = options["trace"];
+	if (!traceOption.empty()) {
+		try {
+			controller.trace(traceOption.as<std::string>());
+		} catch (std::exception& error) {
+			::SDL_LogError(::SDL_LOG_CATEGORY_APPLICATION, "%s", error.what());
+			return 1;
+		}
+	}
+
+	const auto metricsInterval = options["metrics-interval"].as<int>();
+	const auto metricsOverlay = options["metrics-overlay"].as<bool>();
+	if (options["metrics"].as<bool>() || (metricsInterval > 0) || metricsOverlay)
+		controller.measure(metricsInterval, metricsOverlay);
+
+	auto profileOption = options["profile"];
+	std::unique_ptr<Profiler> profiler;
+	if (!profileOption.empty()) {
+		if (!Profiler::isCompiledIn()) {
+			::SDL_LogError(::SDL_LOG_CATEGORY_APPLICATION, "This build can't profile: build with \"make profile\"");
+			return 1;
+		}
+		profiler.reset(new Profiler());
+		processor->setProfiler(profiler.get());
+	}
+
 	if (configuration.isDebugMode())
 		controller.DisassemblyOutput.connect(std::bind(&Processor_DisassemblyOutput, std::placeholders::_1));
 
+	auto result = 0;
 	try {
 		controller.loadContent();
 		controller.runGameLoop();
 	} catch (std::exception& error) {
 		::SDL_LogError(::SDL_LOG_CATEGORY_APPLICATION, "%s", error.what());
-		return 2;
+		result = 2;
+	}
+
+	// However the run ended, what was counted is worth having
+	if (profiler) {
+		processor->setProfiler(nullptr);
+		std::ofstream json(profileOption.as<std::string>());
+		profiler->writeJson(json);
+		if (!json) {
+			::SDL_LogError(::SDL_LOG_CATEGORY_APPLICATION, "Unable to write %s", profileOption.as<std::string>().c_str());
+			result = 2;
+		}
+		profiler->writeTable(std::cout);
 	}
 
-	return 0;
+	return result;
 }
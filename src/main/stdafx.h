@@ -7,5 +7,6 @@
 #include <boost/program_options.hpp>
 
 #include <Controller.h>
+#include <ProcessorFactory.h>
 #include <Configuration.h>
 #include <Chip8.h>
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <Configuration.h>
+
+// The configurations the interpreter scenarios are run against: each processor
+// level from "lowest" up, as it is built by default and then with each of the
+// Chip-8 quirks switched on alone.  Pass the result to GENERATE(from_range(...)).
+
+inline Configuration buildConfiguration(const ProcessorLevel level) {
+	switch (level) {
+	case superChip:
+		return Configuration::buildSuperChipConfiguration();
+	case xoChip:
+		return Configuration::buildXoChipConfiguration();
+	default:
+		return Configuration();
+	}
+}
+
+inline std::vector<Configuration> buildVariants(const ProcessorLevel lowest = chip8) {
+	std::vector<Configuration> variants;
+	for (auto level = (int)lowest; level <= (int)xoChip; ++level) {
+		const auto configuration = buildConfiguration((ProcessorLevel)level);
+		variants.push_back(configuration);
+
+		auto shifts = configuration;
+		shifts.setChip8Shifts(true);
+		variants.push_back(shifts);
+
+		auto loadAndSave = configuration;
+		loadAndSave.setChip8LoadAndSave(true);
+		variants.push_back(loadAndSave);
+
+		auto indexedJumps = configuration;
+		indexedJumps.setChip8IndexedJumps(true);
+		variants.push_back(indexedJumps);
+	}
+	return variants;
+}
+
+// Names the variant in the GIVEN clause, so that a failure says which one it was
+inline std::string describeVariant(const Configuration& configuration) {
+	std::string description;
+	switch (configuration.getType()) {
+	case superChip:
+		description = "Schip";
+		break;
+	case xoChip:
+		description = "XoChip";
+		break;
+	default:
+		description = "Chip8";
+		break;
+	}
+	if (configuration.getChip8Shifts())
+		description += " (Chip-8 shifts)";
+	if (configuration.getChip8LoadAndSave())
+		description += " (Chip-8 load and save)";
+	if (configuration.getChip8IndexedJumps())
+		description += " (Chip-8 indexed jumps)";
+	return description;
+}
+
+// How a variant runs the instructions that the quirks change: the Chip-8
+// interpreter always runs them as the Cosmac VIP did, the others only when asked to.
+
+inline bool shiftsVy(const Configuration& configuration) {
+	return (configuration.getType() == chip8) || configuration.getChip8Shifts();
+}
+
+inline bool loadAndSaveMoveI(const Configuration& configuration) {
+	return (configuration.getType() == chip8) || configuration.getChip8LoadAndSave();
+}
+
+inline bool jumpsIndexedByV0(const Configuration& configuration) {
+	return (configuration.getType() == chip8) || configuration.getChip8IndexedJumps();
+}
@@ -1,19 +1,60 @@
 #include "stdafx.h"
 
 #include <Configuration.h>
-#include <Controller.h>
+#include <ControlFlowGraph.h>
+#include <Disassembler.h>
+#include <Environment.h>
+#include <EnvironmentBatch.h>
+#include <Histogram.h>
+#include <MachinePool.h>
+#include <Memory.h>
+#include <Movie.h>
+#include <ProcessorFactory.h>
+#include <Profiler.h>
+#include <RandomNumberGenerator.h>
+#include <RewindBuffer.h>
+#include <RingBuffer.h>
+#include <Trace.h>
+#include <TripleBuffer.h>
+#include <WorkerPool.h>
+
+#include "Variants.h"
 
 #include <memory>
 #include <algorithm>
 #include <bitset>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <sstream>
+
+// Every allocation in the test executable passes through here, so
+// that tests can show a path leaves the heap alone.
+namespace {
+	size_t allocations = 0;
+}
+
+void* operator new(std::size_t size) {
+	++allocations;
+	if (auto memory = std::malloc(size == 0 ? 1 : size))
+		return memory;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+	std::free(memory);
+}
 
 SCENARIO("The Chip-8 interpreter can execute all valid Chip-8 instructions", "[Chip8]") {
 
-	GIVEN("An initialised Chip8 instance") {
+	const auto configuration = GENERATE(from_range(buildVariants()));
+
+	GIVEN("An initialised " + describeVariant(configuration) + " instance") {
 
-		const Configuration configuration;
 		const auto startAddress = configuration.getStartAddress();
-		std::shared_ptr<Chip8> processor(Controller::buildProcessor(configuration));
+		std::shared_ptr<Chip8> processor(ProcessorFactory::buildProcessor(configuration));
 		processor->initialise();
 
 		WHEN("the screen is cleared (CLS: 0x00E0)") {
@@ -21,17 +62,17 @@ SCENARIO("The Chip-8 interpreter can execute all valid Chip-8 instructions", "[C
 			auto& display = processor->display();
 			auto& planes = display.planes();
 			auto& plane = planes[0];
-			auto& bitmap = plane.graphics();
+			auto& bitmap = plane.rows();
 
 			// The equivalent of a fully filled screen
-			std::fill(bitmap.begin(), bitmap.end(), 1);
+			std::fill(bitmap.begin(), bitmap.end(), GraphicsPlane::row_t{ { ~0ULL, ~0ULL } });
 
 			auto& memory = processor->memory();
 			memory.setWord(startAddress, 0x00E0);	// CLS
 			processor->step();
 
 			THEN("all bits in the display are set to zero") {
-				REQUIRE(std::all_of(bitmap.cbegin(), bitmap.cend(), [](int bit) { return bit == 0; }));
+				REQUIRE(std::all_of(bitmap.cbegin(), bitmap.cend(), [](const GraphicsPlane::row_t& row) { return row[0] == 0 && row[1] == 0; }));
 			}
 		}
 
@@ -318,41 +359,45 @@ SCENARIO("The Chip-8 interpreter can execute all valid Chip-8 instructions", "[C
 			}
 		}
 
-		WHEN("a register is shifted right by one bit generating carry (SHR VX,VY: 0x8XY6)") {
+		// Shifts of VX alone are covered by the SuperChip scenarios
+		if (shiftsVy(configuration)) {
 
-			auto& registers = processor->registers();
-			registers[0] = 0xff;
-			registers[1] = 3;
+			WHEN("a register is shifted right by one bit generating carry (SHR VX,VY: 0x8XY6)") {
 
-			auto& memory = processor->memory();
-			memory.setWord(startAddress, 0x8016);	// SHR VX,VY
-			processor->step();
+				auto& registers = processor->registers();
+				registers[0] = 0xff;
+				registers[1] = 3;
 
-			THEN("the Y register is shifted right by one") {
-				REQUIRE(registers[1] == 1);
-			} AND_THEN("the X and Y registers are equal") {
-				REQUIRE(registers[0] == registers[1]);
-			} AND_THEN("carry has been generated") {
-				REQUIRE(registers[0xf] == 1);
+				auto& memory = processor->memory();
+				memory.setWord(startAddress, 0x8016);	// SHR VX,VY
+				processor->step();
+
+				THEN("the Y register is shifted right by one") {
+					REQUIRE(registers[1] == 1);
+				} AND_THEN("the X and Y registers are equal") {
+					REQUIRE(registers[0] == registers[1]);
+				} AND_THEN("carry has been generated") {
+					REQUIRE(registers[0xf] == 1);
+				}
 			}
-		}
 
-		WHEN("a register is shifted right by one bit without generating carry (SHR VX,VY: 0x8XY6)") {
+			WHEN("a register is shifted right by one bit without generating carry (SHR VX,VY: 0x8XY6)") {
 
-			auto& registers = processor->registers();
-			registers[0] = 0xff;
-			registers[1] = 2;
+				auto& registers = processor->registers();
+				registers[0] = 0xff;
+				registers[1] = 2;
 
-			auto& memory = processor->memory();
-			memory.setWord(startAddress, 0x8016);	// SHR VX,VY
-			processor->step();
+				auto& memory = processor->memory();
+				memory.setWord(startAddress, 0x8016);	// SHR VX,VY
+				processor->step();
 
-			THEN("the Y register is shifted right by one bit") {
-				REQUIRE(registers[1] == 1);
-			} AND_THEN("the X and Y registers are equal") {
-				REQUIRE(registers[0] == registers[1]);
-			} AND_THEN("carry has not been generated") {
-				REQUIRE(registers[0xf] == 0);
+				THEN("the Y register is shifted right by one bit") {
+					REQUIRE(registers[1] == 1);
+				} AND_THEN("the X and Y registers are equal") {
+					REQUIRE(registers[0] == registers[1]);
+				} AND_THEN("carry has not been generated") {
+					REQUIRE(registers[0xf] == 0);
+				}
 			}
 		}
 
@@ -390,41 +435,45 @@ SCENARIO("The Chip-8 interpreter can execute all valid Chip-8 instructions", "[C
 			}
 		}
 
-		WHEN("a register is shifted left by one bit generating carry (SHL VX,VY: 0x8XYE)") {
+		// Shifts of VX alone are covered by the SuperChip scenarios
+		if (shiftsVy(configuration)) {
 
-			auto& registers = processor->registers();
-			registers[0] = 0xff;
-			registers[1] = 0x81;
+			WHEN("a register is shifted left by one bit generating carry (SHL VX,VY: 0x8XYE)") {
 
-			auto& memory = processor->memory();
-			memory.setWord(startAddress, 0x801E);	// SHL VX,VY
-			processor->step();
+				auto& registers = processor->registers();
+				registers[0] = 0xff;
+				registers[1] = 0x81;
 
-			THEN("the Y register is shifted left by one") {
-				REQUIRE(registers[1] == 2);
-			} AND_THEN("the X and Y registers are equal") {
-				REQUIRE(registers[0] == registers[1]);
-			} AND_THEN("carry has been generated") {
-				REQUIRE(registers[0xf] == 1);
+				auto& memory = processor->memory();
+				memory.setWord(startAddress, 0x801E);	// SHL VX,VY
+				processor->step();
+
+				THEN("the Y register is shifted left by one") {
+					REQUIRE(registers[1] == 2);
+				} AND_THEN("the X and Y registers are equal") {
+					REQUIRE(registers[0] == registers[1]);
+				} AND_THEN("carry has been generated") {
+					REQUIRE(registers[0xf] == 1);
+				}
 			}
-		}
 
-		WHEN("a register is shifted left by one bit without generating carry (SHL VX,VY: 0x8XYE)") {
+			WHEN("a register is shifted left by one bit without generating carry (SHL VX,VY: 0x8XYE)") {
 
-			auto& registers = processor->registers();
-			registers[0] = 0xff;
-			registers[1] = 1;
+				auto& registers = processor->registers();
+				registers[0] = 0xff;
+				registers[1] = 1;
 
-			auto& memory = processor->memory();
-			memory.setWord(startAddress, 0x801E);	// SHL VX,VY
-			processor->step();
+				auto& memory = processor->memory();
+				memory.setWord(startAddress, 0x801E);	// SHL VX,VY
+				processor->step();
 
-			THEN("the Y register is shifted left by one bit") {
-				REQUIRE(registers[1] == 2);
-			} AND_THEN("the X and Y registers are equal") {
-				REQUIRE(registers[0] == registers[1]);
-			} AND_THEN("carry has not been generated") {
-				REQUIRE(registers[0xf] == 0);
+				THEN("the Y register is shifted left by one bit") {
+					REQUIRE(registers[1] == 2);
+				} AND_THEN("the X and Y registers are equal") {
+					REQUIRE(registers[0] == registers[1]);
+				} AND_THEN("carry has not been generated") {
+					REQUIRE(registers[0xf] == 0);
+				}
 			}
 		}
 
@@ -473,13 +522,20 @@ SCENARIO("The Chip-8 interpreter can execute all valid Chip-8 instructions", "[C
 
 			auto& registers = processor->registers();
 			registers[0] = 0x10;
+			registers[1] = 0x20;
 
 			auto& memory = processor->memory();
 			memory.setWord(startAddress, 0xB100);	// JP V0,100
 			processor->step();
 
-			THEN("the program counter is set to the address plus V0") {
-				REQUIRE(processor->PC() == 0x110);
+			if (jumpsIndexedByV0(configuration)) {
+				THEN("the program counter is set to the address plus V0") {
+					REQUIRE(processor->PC() == 0x110);
+				}
+			} else {
+				THEN("the program counter is set to the address plus VX") {
+					REQUIRE(processor->PC() == 0x120);
+				}
 			}
 		}
 
@@ -520,11 +576,10 @@ SCENARIO("The Chip-8 interpreter can execute all valid Chip-8 instructions", "[C
 				auto& display = processor->display();
 				auto& planes = display.planes();
 				auto& plane = planes[0];
-				auto& bitmap = plane.graphics();
 				for (int y = 0; y < 4; ++y) {
 					std::bitset<8> displayRow;
 					for (int x = 0; x < 8; ++x) {
-						auto on = bitmap[x + y * display.getWidth()];
+						auto on = plane.getPixel(x, y);
 						displayRow[7 - x] = on ? true : false;
 					}
 					std::bitset<8> spriteRow(memory.get(sprite + y));
@@ -535,6 +590,81 @@ SCENARIO("The Chip-8 interpreter can execute all valid Chip-8 instructions", "[C
 			}
 		}
 
+		WHEN("a draw command is executed across the right edge of the screen (DRW VX,VY,N: 0xDXYN)") {
+
+			auto& registers = processor->registers();
+			registers[0] = 60;
+			registers[1] = 0;
+
+			auto& memory = processor->memory();
+
+			const uint16_t sprite = 0x400U;
+			memory.set(sprite, 0b11000011);
+
+			processor->indirector() = sprite;
+
+			memory.setWord(startAddress, 0xD011);	// DRW V0,V1,1
+			processor->step();
+
+			THEN("the pixels past the right edge wrap around to the left") {
+				const auto& plane = processor->display().planes()[0];
+				REQUIRE(plane.getPixel(60, 0) == 1);
+				REQUIRE(plane.getPixel(61, 0) == 1);
+				REQUIRE(plane.getPixel(62, 0) == 0);
+				REQUIRE(plane.getPixel(63, 0) == 0);
+				REQUIRE(plane.getPixel(0, 0) == 0);
+				REQUIRE(plane.getPixel(1, 0) == 0);
+				REQUIRE(plane.getPixel(2, 0) == 1);
+				REQUIRE(plane.getPixel(3, 0) == 1);
+			}
+		}
+
+		WHEN("a draw command is executed on a clean display (DRW VX,VY,N: 0xDXYN)") {
+
+			auto& registers = processor->registers();
+			registers[0] = 8;
+			registers[1] = 5;
+
+			auto& memory = processor->memory();
+
+			const uint16_t sprite = 0x400U;
+			memory.set(sprite, 0b11111111);
+			memory.set(sprite + 1, 0b10000001);
+			memory.set(sprite + 2, 0b11111111);
+
+			processor->indirector() = sprite;
+
+			memory.setWord(startAddress, 0xD013);	// DRW V0,V1,3
+			processor->setDrawNeeded(false);
+			processor->step();
+
+			THEN("only the rows covered by the sprite are marked for redrawing") {
+				const auto& display = processor->display();
+				REQUIRE(display.getDirty());
+				REQUIRE(display.getDirtyRows() == 0xe0);
+				REQUIRE(!display.isRowDirty(4));
+				REQUIRE(display.isRowDirty(5));
+				REQUIRE(display.isRowDirty(7));
+				REQUIRE(!display.isRowDirty(8));
+			}
+		}
+
+		WHEN("a sprite with no rows is drawn on a clean display (DRW VX,VY,0: 0xDXY0)") {
+
+			auto& registers = processor->registers();
+			registers[0] = 8;
+			registers[1] = 5;
+
+			processor->memory().setWord(startAddress, 0xD010);	// DRW V0,V1,0
+			processor->setDrawNeeded(false);
+			processor->step();
+
+			THEN("a draw is still needed, as for any other sprite") {
+				REQUIRE(processor->getDrawNeeded());
+				REQUIRE(processor->display().isRowDirty(5));
+			}
+		}
+
 		WHEN("a draw command is executed with complete hits (DRW VX,VY,N: 0xDXYN)") {
 
 			auto& registers = processor->registers();
@@ -560,10 +690,10 @@ SCENARIO("The Chip-8 interpreter can execute all valid Chip-8 instructions", "[C
 				auto& display = processor->display();
 				auto& planes = display.planes();
 				auto& plane = planes[0];
-				auto& bitmap = plane.graphics();
-				REQUIRE(std::all_of(bitmap.cbegin(), bitmap.cend(), [](int bit) { return bit == 0; }));
-			} AND_THEN("there have been hits") {
-				REQUIRE(registers[0xf] == 1);
+				auto& bitmap = plane.rows();
+				REQUIRE(std::all_of(bitmap.cbegin(), bitmap.cend(), [](const GraphicsPlane::row_t& row) { return row[0] == 0 && row[1] == 0; }));
+			} AND_THEN("there have been hits, counted by row if the variant counts them") {
+				REQUIRE(registers[0xf] == (configuration.getGraphicsCountRowHits() ? 4 : 1));
 			}
 		}
 
@@ -573,7 +703,7 @@ SCENARIO("The Chip-8 interpreter can execute all valid Chip-8 instructions", "[C
 			registers[0] = 0xA;
 
 			auto& keyboard = processor->keyboard();
-			keyboard.pokeKey(SDLK_z);	// Mapped Z -> A on Chip-8
+			keyboard.pokeKey(0xA);
 
 			auto& memory = processor->memory();
 			memory.setWord(startAddress, 0xE09E);	// SKP V0
@@ -590,7 +720,7 @@ SCENARIO("The Chip-8 interpreter can execute all valid Chip-8 instructions", "[C
 			registers[0] = 0xB;
 
 			auto& keyboard = processor->keyboard();
-			keyboard.pokeKey(SDLK_z);	// Mapped Z -> A on Chip-8
+			keyboard.pokeKey(0xA);
 
 			auto& memory = processor->memory();
 			memory.setWord(startAddress, 0xE09E);	// SKP V0
@@ -607,7 +737,7 @@ SCENARIO("The Chip-8 interpreter can execute all valid Chip-8 instructions", "[C
 			registers[0] = 0xB;
 
 			auto& keyboard = processor->keyboard();
-			keyboard.pokeKey(SDLK_z);	// Mapped Z -> A on Chip-8
+			keyboard.pokeKey(0xA);
 
 			auto& memory = processor->memory();
 			memory.setWord(startAddress, 0xE0A1);	// SKNP V0
@@ -624,7 +754,7 @@ SCENARIO("The Chip-8 interpreter can execute all valid Chip-8 instructions", "[C
 			registers[0] = 0xA;
 
 			auto& keyboard = processor->keyboard();
-			keyboard.pokeKey(SDLK_z);	// Mapped Z -> A on Chip-8
+			keyboard.pokeKey(0xA);
 
 			auto& memory = processor->memory();
 			memory.setWord(startAddress, 0xE0A1);	// SKNP V0
@@ -656,7 +786,7 @@ SCENARIO("The Chip-8 interpreter can execute all valid Chip-8 instructions", "[C
 			processor->step();
 
 			auto& keyboard = processor->keyboard();
-			keyboard.pokeKey(SDLK_z);
+			keyboard.pokeKey(0xA);
 
 			processor->step();
 
@@ -794,8 +924,15 @@ SCENARIO("The Chip-8 interpreter can execute all valid Chip-8 instructions", "[C
 				REQUIRE(memory.get(0x402) == 3);
 			} AND_THEN("the contents of the fourth location should be 0 (i.e. unchanged)") {
 				REQUIRE(memory.get(0x403) == 0);
-			} AND_THEN("the value of the indirector should be the base location plus the number of registers saved") {
-				REQUIRE(processor->indirector() == 0x403);
+			}
+			if (loadAndSaveMoveI(configuration)) {
+				AND_THEN("the value of the indirector should be the base location plus the number of registers saved") {
+					REQUIRE(processor->indirector() == 0x403);
+				}
+			} else {
+				AND_THEN("the value of the indirector should be unchanged") {
+					REQUIRE(processor->indirector() == 0x400);
+				}
 			}
 		}
 
@@ -827,8 +964,15 @@ SCENARIO("The Chip-8 interpreter can execute all valid Chip-8 instructions", "[C
 				REQUIRE(registers[2] == 3);
 			} AND_THEN("the contents of V3 should be 0 (i.e. unchanged)") {
 				REQUIRE(registers[3] == 0);
-			} AND_THEN("the value of the indirector should be the base location plus the number of registers saved") {
-				REQUIRE(processor->indirector() == 0x403);
+			}
+			if (loadAndSaveMoveI(configuration)) {
+				AND_THEN("the value of the indirector should be the base location plus the number of registers loaded") {
+					REQUIRE(processor->indirector() == 0x403);
+				}
+			} else {
+				AND_THEN("the value of the indirector should be unchanged") {
+					REQUIRE(processor->indirector() == 0x400);
+				}
 			}
 		}
 	}
@@ -836,11 +980,13 @@ SCENARIO("The Chip-8 interpreter can execute all valid Chip-8 instructions", "[C
 
 SCENARIO("The Chip-8 interpreter rejects invalid instructions", "[Chip8][!throws])") {
 
-	GIVEN("An initialised Chip8 instance") {
+	const auto variant = GENERATE(from_range(buildVariants()));
 
-		const Configuration configuration;
+	GIVEN("An initialised " + describeVariant(variant) + " instance") {
+
+		const auto& configuration = variant;
 		const auto startAddress = configuration.getStartAddress();
-		std::shared_ptr<Chip8> processor(Controller::buildProcessor(configuration));
+		std::shared_ptr<Chip8> processor(ProcessorFactory::buildProcessor(configuration));
 		processor->initialise();
 
 		WHEN("an unknown instruction from 0 is interpreted") {
@@ -911,20 +1057,24 @@ SCENARIO("The Chip-8 interpreter rejects invalid instructions", "[Chip8][!throws
 			}
 		}
 
-		WHEN("an unknown instruction from F is interpreted") {
+		// XO-Chip reads it as "i := long"
+		if (configuration.getType() != xoChip) {
 
-			auto& memory = processor->memory();
-			memory.setWord(startAddress, 0xF000);	// ??? Unknown instruction
+			WHEN("an unknown instruction from F is interpreted") {
 
-			bool runtimeErrorThrown = false;
-			try {
-				processor->step();
-			} catch (const std::runtime_error&) {
-				runtimeErrorThrown = true;
-			}
+				auto& memory = processor->memory();
+				memory.setWord(startAddress, 0xF000);	// ??? Unknown instruction
 
-			THEN("a runtime error is thrown") {
-				REQUIRE(runtimeErrorThrown);
+				bool runtimeErrorThrown = false;
+				try {
+					processor->step();
+				} catch (const std::runtime_error&) {
+					runtimeErrorThrown = true;
+				}
+
+				THEN("a runtime error is thrown") {
+					REQUIRE(runtimeErrorThrown);
+				}
 			}
 		}
 	}
@@ -932,13 +1082,15 @@ SCENARIO("The Chip-8 interpreter rejects invalid instructions", "[Chip8][!throws
 
 SCENARIO("The Chip-8 interpreter handles instructions on even or odd boundaries", "[Chip8][!throws])") {
 
-	GIVEN("An initialised Chip8 instance that does not allow misaligned instructions") {
+	const auto variant = GENERATE(from_range(buildVariants()));
 
-		const Configuration configuration;
+	GIVEN("An initialised " + describeVariant(variant) + " instance that does not allow misaligned instructions") {
+
+		const auto& configuration = variant;
 		REQUIRE(!configuration.getAllowMisalignedOpcodes());
 
 		const auto startAddress = configuration.getStartAddress();
-		std::shared_ptr<Chip8> processor(Controller::buildProcessor(configuration));
+		std::shared_ptr<Chip8> processor(ProcessorFactory::buildProcessor(configuration));
 		processor->initialise();
 
 		WHEN("an aligned instruction is interpreted") {
@@ -979,14 +1131,14 @@ SCENARIO("The Chip-8 interpreter handles instructions on even or odd boundaries"
 		}
 	}
 
-	GIVEN("An initialised Chip8 instance that allows misaligned instructions") {
+	GIVEN("An initialised " + describeVariant(variant) + " instance that allows misaligned instructions") {
 
-		Configuration configuration;
+		auto configuration = variant;
 		configuration.setAllowMisalignedOpcodes(true);
 		REQUIRE(configuration.getAllowMisalignedOpcodes());
 
 		const auto startAddress = configuration.getStartAddress();
-		std::shared_ptr<Chip8> processor(Controller::buildProcessor(configuration));
+		std::shared_ptr<Chip8> processor(ProcessorFactory::buildProcessor(configuration));
 		processor->initialise();
 
 		WHEN("an aligned instruction is interpreted") {
@@ -1025,5 +1177,1793 @@ SCENARIO("The Chip-8 interpreter handles instructions on even or odd boundaries"
 				REQUIRE(!runtimeErrorThrown);
 			}
 		}
+
+		WHEN("two different misaligned instructions are interpreted in turn") {
+
+			auto& memory = processor->memory();
+			memory.setWord(startAddress, 0x1301);	// JP 301
+			memory.setWord(0x301, 0x610B);	// LD V1,0B
+			memory.setWord(0x303, 0x1401);	// JP 401
+			memory.setWord(0x401, 0x6207);	// LD V2,07
+
+			for (int i = 0; i < 4; ++i)
+				processor->step();
+
+			THEN("each is executed as itself") {
+				REQUIRE(processor->registers()[1] == 0x0B);
+				REQUIRE(processor->registers()[2] == 0x07);
+				REQUIRE(processor->PC() == 0x403);
+			}
+		}
+	}
+}
+
+SCENARIO("The Chip-8 interpreter handles self-modifying code", "[Chip8]") {
+
+	const auto variant = GENERATE(from_range(buildVariants()));
+
+	GIVEN("An initialised " + describeVariant(variant) + " instance") {
+
+		const auto& configuration = variant;
+		const auto startAddress = configuration.getStartAddress();
+		std::shared_ptr<Chip8> processor(ProcessorFactory::buildProcessor(configuration));
+		processor->initialise();
+
+		WHEN("an instruction is replaced after it has been executed") {
+
+			auto& memory = processor->memory();
+			memory.setWord(startAddress, 0x6001);	// LD V0,01
+			processor->step();
+
+			memory.setWord(startAddress, 0x6002);	// LD V0,02
+			processor->PC() = startAddress;
+			processor->step();
+
+			THEN("the replacement instruction is executed") {
+				const auto& registers = processor->registers();
+				REQUIRE(registers[0] == 0x02);
+			}
+		}
+
+		WHEN("a program overwrites an instruction it has already executed (LD [I],VX: 0xFX55)") {
+
+			auto& registers = processor->registers();
+			registers[0] = 0x62;	// LD V2,..
+			registers[1] = 0x23;	// ..23
+
+			auto& memory = processor->memory();
+			memory.setWord(startAddress, 0x6200);	// LD V2,00
+			memory.setWord(startAddress + 2, 0xA200);	// LD I,200
+			memory.setWord(startAddress + 4, 0xF155);	// LD [I],V1
+			memory.setWord(startAddress + 6, 0x1200);	// JP 200
+			for (int i = 0; i < 5; ++i)
+				processor->step();
+
+			THEN("the rewritten instruction is executed on the next pass") {
+				REQUIRE(registers[2] == 0x23);
+			} AND_THEN("the program counter has moved past the rewritten instruction") {
+				REQUIRE(processor->PC() == (startAddress + 2));
+			}
+		}
+	}
+}
+
+SCENARIO("The Chip-8 interpreter can run translated blocks of instructions", "[Chip8]") {
+
+	const auto variant = GENERATE(from_range(buildVariants()));
+
+	GIVEN("An initialised " + describeVariant(variant) + " instance that translates blocks") {
+
+		auto configuration = variant;
+		configuration.setTranslateBlocks(true);
+		const auto startAddress = configuration.getStartAddress();
+		std::shared_ptr<Chip8> processor(ProcessorFactory::buildProcessor(configuration));
+		processor->initialise();
+
+		WHEN("a straight-line run of instructions ending in a jump is executed") {
+
+			auto& memory = processor->memory();
+			memory.setWord(startAddress, 0x6001);	// LD V0,01
+			memory.setWord(startAddress + 2, 0x7002);	// ADD V0,02
+			memory.setWord(startAddress + 4, 0xA300);	// LD I,300
+			memory.setWord(startAddress + 6, 0x1200);	// JP 200
+			memory.setWord(startAddress + 8, 0x6005);	// LD V0,05
+
+			const auto executed = processor->runBlock(100);
+
+			THEN("the block stops at the jump") {
+				REQUIRE(executed == 4);
+				REQUIRE(processor->PC() == startAddress);
+			} AND_THEN("the instructions in the block have been executed") {
+				REQUIRE(processor->registers()[0] == 3);
+				REQUIRE(processor->indirector() == 0x300);
+			}
+		}
+
+		WHEN("a block is run with a limit shorter than the block") {
+
+			auto& memory = processor->memory();
+			memory.setWord(startAddress, 0x6001);	// LD V0,01
+			memory.setWord(startAddress + 2, 0x7002);	// ADD V0,02
+			memory.setWord(startAddress + 4, 0x1200);	// JP 200
+
+			const auto executed = processor->runBlock(2);
+
+			THEN("only the limited number of instructions are executed") {
+				REQUIRE(executed == 2);
+				REQUIRE(processor->PC() == (startAddress + 4));
+			}
+		}
+
+		WHEN("a block modifies an instruction later in the same block") {
+
+			auto& registers = processor->registers();
+
+			auto& memory = processor->memory();
+			memory.setWord(startAddress, 0x6062);	// LD V0,62
+			memory.setWord(startAddress + 2, 0x6125);	// LD V1,25
+			memory.setWord(startAddress + 4, 0xA208);	// LD I,208
+			memory.setWord(startAddress + 6, 0xF155);	// LD [I],V1
+			memory.setWord(startAddress + 8, 0x6200);	// LD V2,00 (to become LD V2,25)
+			memory.setWord(startAddress + 10, 0x120A);	// JP 20A
+
+			const auto first = processor->runBlock(100);
+			const auto second = processor->runBlock(100);
+
+			THEN("the block is abandoned after the write") {
+				REQUIRE(first == 4);
+			} AND_THEN("the rewritten instruction is executed") {
+				REQUIRE(second == 2);
+				REQUIRE(registers[2] == 0x25);
+			}
+		}
+
+		WHEN("a straight-line run of instructions crosses into the next page of memory") {
+
+			auto& memory = processor->memory();
+			memory.setWord(0x2FC, 0x6001);	// LD V0,01
+			memory.setWord(0x2FE, 0x7002);	// ADD V0,02
+			memory.setWord(0x300, 0x7004);	// ADD V0,04
+			memory.setWord(0x302, 0x1300);	// JP 300
+
+			processor->PC() = 0x2FC;
+			const auto first = processor->runBlock(100);
+			const auto second = processor->runBlock(100);
+
+			THEN("the block stops at the end of the page") {
+				REQUIRE(first == 2);
+			} AND_THEN("the next block carries on from the start of the next page") {
+				REQUIRE(second == 2);
+				REQUIRE(processor->registers()[0] == 7);
+				REQUIRE(processor->PC() == 0x300);
+			}
+		}
+
+		WHEN("a block rewrites an instruction in another page that has already been translated") {
+
+			auto& registers = processor->registers();
+
+			auto& memory = processor->memory();
+			memory.setWord(startAddress, 0x6062);	// LD V0,62
+			memory.setWord(startAddress + 2, 0x6125);	// LD V1,25
+			memory.setWord(startAddress + 4, 0xA300);	// LD I,300
+			memory.setWord(startAddress + 6, 0xF155);	// LD [I],V1
+			memory.setWord(startAddress + 8, 0x1300);	// JP 300
+			memory.setWord(0x300, 0x6200);	// LD V2,00 (to become LD V2,25)
+			memory.setWord(0x302, 0x1200);	// JP 200
+
+			processor->PC() = 0x300;
+			processor->runBlock(100);
+			const auto rewriting = processor->runBlock(100);
+			const auto jump = processor->runBlock(100);
+			const auto rewritten = processor->runBlock(100);
+
+			THEN("the rewriting block is abandoned after the write") {
+				REQUIRE(rewriting == 4);
+				REQUIRE(jump == 1);
+			} AND_THEN("the rewritten instruction is executed") {
+				REQUIRE(rewritten == 2);
+				REQUIRE(registers[2] == 0x25);
+			}
+		}
+	}
+}
+
+SCENARIO("The Chip-8 interpreter only reports instructions to connected listeners", "[Chip8]") {
+
+	const auto variant = GENERATE(from_range(buildVariants()));
+
+	GIVEN("An initialised " + describeVariant(variant) + " instance") {
+
+		const auto& configuration = variant;
+		const auto startAddress = configuration.getStartAddress();
+		std::shared_ptr<Chip8> processor(ProcessorFactory::buildProcessor(configuration));
+		processor->initialise();
+
+		WHEN("an instruction is executed with a listener connected") {
+
+			Disassembler disassembler;
+			std::string disassembly;
+			processor->EmulatedCycle.connect([&](const InstructionEventArgs& event) {
+				disassembly = disassembler.disassemble(event, processor.get());
+			});
+
+			auto& memory = processor->memory();
+			memory.setWord(startAddress, 0x6A2F);	// LD VA,2F
+			processor->step();
+
+			THEN("the listener can disassemble the instruction") {
+				REQUIRE(disassembly == "LD VA,2F");
+			}
+		}
+
+		WHEN("an instruction's mnemomic is looked up") {
+
+			const auto format = Disassembler::getMnemomicFormat(0x8016, *processor);	// SHR V0,V1
+
+			if (shiftsVy(configuration)) {
+				THEN("the Chip-8 form of the instruction is found") {
+					REQUIRE(std::string(format) == "SHR V%4$01X,V%5$01X");
+				}
+			} else {
+				THEN("the SuperChip form of the instruction is found") {
+					REQUIRE(std::string(format) == "(S) SHR V%4$01X");
+				}
+			}
+		}
+
+		WHEN("a SuperChip instruction's mnemomic is looked up") {
+
+			const auto format = Disassembler::getMnemomicFormat(0x00FF, *processor);	// SuperChip HIGH
+
+			if (configuration.getType() == chip8) {
+				THEN("no format is found") {
+					REQUIRE(format == nullptr);
+				}
+			} else {
+				THEN("the SuperChip instruction is found") {
+					REQUIRE(std::string(format) == "(S) HIGH");
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("The interpreters draw sprites without allocating memory", "[Chip8][Schip]") {
+
+	const auto variant = GENERATE(from_range(buildVariants()));
+
+	GIVEN("An initialised " + describeVariant(variant) + " instance") {
+
+		const auto& configuration = variant;
+		const auto startAddress = configuration.getStartAddress();
+		std::shared_ptr<Chip8> processor(ProcessorFactory::buildProcessor(configuration));
+		processor->initialise();
+
+		WHEN("a sprite is drawn (DRW VX,VY,N: 0xDXYN)") {
+
+			auto& memory = processor->memory();
+			memory.setWord(startAddress, 0xA000 + Chip8::StandardFontOffset);	// LD I,font
+			memory.setWord(startAddress + 2, 0xD01F);	// DRW V0,V1,F
+			processor->step();	// Also sets up the page's decoded instructions
+
+			const auto before = allocations;
+			processor->step();
+			const auto allocated = allocations - before;
+
+			THEN("no memory has been allocated") {
+				REQUIRE(allocated == 0);
+			}
+		}
+	}
+
+	GIVEN("An initialised XO-Chip instance drawing to both planes") {
+
+		const auto configuration = Configuration::buildXoChipConfiguration();
+		const auto startAddress = configuration.getStartAddress();
+		std::shared_ptr<Chip8> processor(ProcessorFactory::buildProcessor(configuration));
+		processor->initialise();
+
+		auto& memory = processor->memory();
+		memory.setWord(startAddress, 0x00FF);	// HIGH
+		memory.setWord(startAddress + 2, 0xF301);	// PLANE 3
+		memory.setWord(startAddress + 4, 0xD010);	// XDRW V0,V1
+		processor->indirector() = 0x1000;
+		processor->registers()[0] = 120;	// Runs off the right edge
+		processor->step();
+		processor->step();
+
+		WHEN("a large sprite is drawn (XDRW VX,VY: 0xDXY0)") {
+
+			const auto before = allocations;
+			processor->step();
+			const auto allocated = allocations - before;
+
+			THEN("no memory has been allocated") {
+				REQUIRE(allocated == 0);
+			}
+		}
+	}
+}
+
+SCENARIO("The display composes its planes into palette colours", "[Chip8][Schip]") {
+
+	GIVEN("An initialised XO-Chip instance in high resolution") {
+
+		const auto configuration = Configuration::buildXoChipConfiguration();
+		std::shared_ptr<Chip8> processor(ProcessorFactory::buildProcessor(configuration));
+		processor->initialise();
+
+		auto& display = processor->display();
+		display.setHighResolution(true);
+
+		auto& planes = display.planes();
+		planes[0].setPixel(0, 3, true);
+		planes[1].setPixel(1, 3, true);
+		planes[0].setPixel(127, 3, true);
+		planes[1].setPixel(127, 3, true);
+		planes[0].setPixel(70, 3, true);
+
+		const uint32_t palette[] = { 10, 11, 12, 13 };
+		std::vector<uint32_t> row(GraphicsPlane::ScreenWidthHigh + 1, 99);
+
+		WHEN("a row is composed") {
+
+			display.composeRow(3, palette, &row[0]);
+
+			THEN("each pixel takes the colour selected by its plane bits") {
+				REQUIRE(row[0] == 11);
+				REQUIRE(row[1] == 12);
+				REQUIRE(row[2] == 10);
+				REQUIRE(row[70] == 11);
+				REQUIRE(row[127] == 13);
+			} AND_THEN("nothing is written past the end of the row") {
+				REQUIRE(row[128] == 99);
+			}
+		}
+	}
+}
+
+SCENARIO("Frames are handed between threads through a triple buffer", "[Chip8]") {
+
+	GIVEN("An empty triple buffer") {
+
+		TripleBuffer<int> frames;
+
+		WHEN("nothing has been published") {
+
+			const auto taken = frames.take();
+
+			THEN("there is nothing to take") {
+				REQUIRE(!taken);
+			}
+		}
+
+		WHEN("a value is published and taken") {
+
+			frames.back() = 1;
+			const auto skipped = frames.publish();
+			const auto taken = frames.take();
+
+			THEN("the consumer sees the value") {
+				REQUIRE(!skipped);
+				REQUIRE(taken);
+				REQUIRE(frames.front() == 1);
+			} AND_THEN("it can't be taken twice") {
+				REQUIRE(!frames.take());
+			}
+		}
+
+		WHEN("two values are published before the consumer looks") {
+
+			frames.back() = 1;
+			frames.publish();
+			frames.back() = 2;
+			const auto skipped = frames.publish();
+			const auto taken = frames.take();
+
+			THEN("the producer is told the first was never seen, and gets it back") {
+				REQUIRE(skipped);
+				REQUIRE(frames.back() == 1);
+			} AND_THEN("the consumer sees only the latest") {
+				REQUIRE(taken);
+				REQUIRE(frames.front() == 2);
+			}
+		}
+	}
+}
+
+SCENARIO("The keyboard state can be exchanged as a bitmask", "[Chip8]") {
+
+	GIVEN("A keyboard") {
+
+		KeyboardDevice keyboard;
+
+		WHEN("keys are set from a mask") {
+
+			keyboard.setKeys(0x8021);
+
+			THEN("exactly those keys are pressed") {
+				REQUIRE(keyboard.isKeyPressed(0x0));
+				REQUIRE(keyboard.isKeyPressed(0x5));
+				REQUIRE(keyboard.isKeyPressed(0xf));
+				REQUIRE(!keyboard.isKeyPressed(0x1));
+				REQUIRE(keyboard.getKeys() == 0x8021);
+			}
+		}
+
+		WHEN("a mask releases keys") {
+
+			keyboard.setKeys(0x00ff);
+			keyboard.setKeys(0x0003);
+
+			THEN("the released keys are no longer pressed") {
+				REQUIRE(keyboard.getKeys() == 0x0003);
+			}
+		}
+
+		WHEN("several keys are poked and one pulled") {
+
+			keyboard.pokeKey(0xc);
+			keyboard.pokeKey(0x7);
+			keyboard.pokeKey(0x3);
+			keyboard.pullKey(0x3);
+
+			int key = -1;
+			const auto pressed = keyboard.checkKeyPress(key);
+
+			THEN("the lowest key still held is reported") {
+				REQUIRE(pressed);
+				REQUIRE(key == 0x7);
+				REQUIRE(keyboard.getKeys() == 0x1080);
+			}
+		}
+
+		WHEN("no key is held") {
+
+			int key = 0;
+			const auto pressed = keyboard.checkKeyPress(key);
+
+			THEN("no key press is reported") {
+				REQUIRE(!pressed);
+				REQUIRE(key == -1);
+			}
+		}
+	}
+}
+
+SCENARIO("The Chip-8 interpreter can run a frame at a time", "[Chip8]") {
+
+	const auto variant = GENERATE(from_range(buildVariants()));
+
+	GIVEN("An initialised " + describeVariant(variant) + " instance") {
+
+		const auto& configuration = variant;
+		const auto startAddress = configuration.getStartAddress();
+		std::shared_ptr<Chip8> processor(ProcessorFactory::buildProcessor(configuration));
+		processor->initialise();
+		processor->setDrawNeeded(false);
+
+		const auto blank = processor->display().hash();
+
+		auto& memory = processor->memory();
+		memory.setWord(startAddress, 0x6001);	// LD V0,1
+		memory.setWord(startAddress + 2, 0xD015);	// DRW V0,V1,5
+		memory.setWord(startAddress + 4, 0x1204);	// JP 204
+		processor->indirector() = Chip8::StandardFontOffset;
+
+		WHEN("a frame is run in low resolution") {
+
+			const auto cycles = processor->runFrame();
+
+			THEN("it stops as soon as the display needs drawing") {
+				REQUIRE(cycles == 2);
+				REQUIRE(processor->PC() == startAddress + 4);
+			} AND_THEN("the display hash has changed") {
+				REQUIRE(processor->display().hash() != blank);
+			}
+		}
+
+		WHEN("a frame is run after the display has been drawn") {
+
+			processor->runFrame();
+			processor->setDrawNeeded(false);
+			const auto cycles = processor->runFrame();
+
+			THEN("it runs for the whole frame") {
+				REQUIRE(cycles == configuration.getCyclesPerFrame() + 1);
+			}
+		}
+	}
+}
+
+namespace {
+	// Writes a program out as a ROM file, removing it again when done with
+	class RomFile final {
+	public:
+		RomFile(const std::string& path, const std::vector<uint16_t>& program)
+		: m_path(path) {
+			std::ofstream file(m_path, std::ios::binary);
+			for (const auto word : program)
+				file.put((char)(word >> 8)).put((char)(word & 0xff));
+		}
+
+		~RomFile() {
+			std::remove(m_path.c_str());
+		}
+
+		const std::string& path() const {
+			return m_path;
+		}
+
+	private:
+		std::string m_path;
+	};
+
+	// Rolls a random number into 0x300 and, while key 1 is held, counts up in 0x301
+	const std::vector<uint16_t> ScoringProgram = {
+		0xA300,	// LD I,300
+		0xC0FF,	// RND V0,FF
+		0x6301,	// LD V3,1
+		0xE39E,	// SKP V3
+		0x120C,	// JP 20C
+		0x7101,	// ADD V1,1
+		0xF155,	// LD [I],V1
+		0x1200,	// JP 200
+	};
+
+	// Calls 0x210 for V3, then writes over the code there and calls it again
+	const std::vector<uint16_t> SelfModifyingProgram = {
+		0x2210,	// CALL 210
+		0x8320,	// LD V3,V2
+		0xA210,	// LD I,210
+		0x6062,	// LD V0,62
+		0x6109,	// LD V1,9
+		0xF155,	// LD [I],V1: 210 becomes LD V2,9
+		0x2210,	// CALL 210
+		0x120E,	// JP 20E
+		0x6205,	// LD V2,5
+		0x00EE,	// RET
+	};
+}
+
+SCENARIO("An environment steps a ROM a number of frames at a time", "[Chip8]") {
+
+	GIVEN("An environment scoring from 0x301 with a budget of ten frames") {
+
+		const RomFile rom("environment_test.ch8", ScoringProgram);
+
+		const Configuration configuration;
+		Environment environment(configuration, 0x301, 10);
+		environment.reset(rom.path(), 1234);
+
+		WHEN("no keys are held") {
+
+			const auto reward = environment.step(0x0000, 2);
+
+			THEN("there is no reward") {
+				REQUIRE(reward == 0);
+			} AND_THEN("the frames have run") {
+				REQUIRE(environment.getFrames() == 2);
+				REQUIRE_FALSE(environment.getDone());
+			}
+		}
+
+		WHEN("key 1 is held") {
+
+			const auto first = environment.step(0x0002, 2);
+			const auto second = environment.step(0x0002, 2);
+
+			THEN("the rewards add up to the score") {
+				REQUIRE(first > 0);
+				REQUIRE(first + second == environment.processor().memory().get(0x301));
+			}
+		}
+
+		WHEN("the frame budget is used up") {
+
+			environment.step(0x0002, 1);
+			const auto random = environment.processor().memory().get(0x300);
+			environment.step(0x0002, 8);
+			REQUIRE_FALSE(environment.getDone());
+			environment.step(0x0002, 8);
+
+			THEN("the episode is done, after exactly the budget") {
+				REQUIRE(environment.getDone());
+				REQUIRE(environment.getFrames() == 10);
+			} AND_THEN("further steps do nothing") {
+				REQUIRE(environment.step(0x0002, 1) == 0);
+				REQUIRE(environment.getFrames() == 10);
+			} AND_WHEN("the environment is reset with the same seed") {
+
+				environment.reset(rom.path(), 1234);
+				environment.step(0x0000, 1);
+
+				THEN("the episode starts over and repeats itself") {
+					REQUIRE_FALSE(environment.getDone());
+					REQUIRE(environment.getFrames() == 1);
+					REQUIRE(environment.processor().memory().get(0x301) == 0);
+					REQUIRE(environment.processor().memory().get(0x300) == random);
+				}
+			}
+		}
+	}
+
+	GIVEN("A Super-Chip environment whose ROM exits") {
+
+		const RomFile rom("environment_exit_test.ch8", { 0x00FD });	// EXIT
+
+		Environment environment(Configuration::buildSuperChipConfiguration());
+		environment.reset(rom.path(), 0);
+
+		WHEN("it is stepped") {
+
+			environment.step(0x0000, 5);
+
+			THEN("the episode is done on the first frame") {
+				REQUIRE(environment.getDone());
+				REQUIRE(environment.getFrames() == 1);
+			}
+		}
+	}
+
+	GIVEN("An environment translating blocks, whose ROM writes over its own code") {
+
+		const RomFile rom("environment_self_modifying_test.ch8", SelfModifyingProgram);
+
+		Configuration configuration;
+		configuration.setTranslateBlocks(true);
+		Environment environment(configuration);
+		environment.reset(rom.path(), 0);
+		environment.step(0x0000, 2);
+		REQUIRE(environment.processor().registers()[3] == 5);
+
+		WHEN("it is reset and stepped again") {
+
+			environment.reset(rom.path(), 0);
+			environment.step(0x0000, 2);
+
+			THEN("the code is translated afresh from the ROM") {
+				REQUIRE(environment.processor().registers()[3] == 5);
+			}
+		}
+	}
+}
+
+SCENARIO("A worker pool hands out every piece of work once", "[Chip8]") {
+
+	GIVEN("A pool of four threads") {
+
+		WorkerPool workers(4);
+		REQUIRE(workers.size() == 4);
+
+		WHEN("it is run over a thousand indices") {
+
+			std::vector<int> counts(1000);
+			workers.run(counts.size(), [&](size_t index) { ++counts[index]; });
+
+			THEN("each index was worked on exactly once") {
+				REQUIRE(std::all_of(counts.begin(), counts.end(), [](int count) { return count == 1; }));
+			}
+		}
+
+		WHEN("a piece of work throws") {
+
+			THEN("the exception reaches the caller") {
+				REQUIRE_THROWS_AS(workers.run(100, [](size_t index) { if (index == 50) throw std::runtime_error("fifty"); }), std::runtime_error);
+			} AND_THEN("the pool can still be used") {
+				std::atomic<int> total(0);
+				workers.run(10, [&](size_t) { ++total; });
+				REQUIRE(total == 10);
+			}
+		}
+	}
+}
+
+SCENARIO("A batch of environments steps like the same environments stepped one at a time", "[Chip8]") {
+
+	GIVEN("A batch of three environments and three separate ones") {
+
+		const RomFile rom("environment_batch_test.ch8", ScoringProgram);
+
+		const Configuration configuration;
+		EnvironmentBatch batch(configuration, 3, 0x301, 0, 2);
+		batch.reset(rom.path(), 99);
+
+		std::vector<Environment> separate;
+		for (size_t index = 0; index < batch.size(); ++index) {
+			separate.emplace_back(configuration, 0x301);
+			separate.back().reset(rom.path(), 99 + (uint32_t)index);
+		}
+
+		WHEN("both are stepped with the same actions") {
+
+			const std::vector<uint16_t> actions = { 0x0000, 0x0002, 0x0002 };
+			std::vector<int> rewards(actions.size());
+			for (int step = 0; step < 3; ++step) {
+				batch.step(actions, 4);
+				for (size_t index = 0; index < separate.size(); ++index)
+					rewards[index] = separate[index].step(actions[index], 4);
+			}
+
+			THEN("every environment ends in the same state") {
+				for (size_t index = 0; index < separate.size(); ++index) {
+					const auto& batched = batch.environment(index).processor();
+					const auto& alone = separate[index].processor();
+					REQUIRE(batched.PC() == alone.PC());
+					REQUIRE(batched.registers() == alone.registers());
+					REQUIRE(batch.rewards()[index] == rewards[index]);
+					REQUIRE(batch.dones()[index] == 0);
+				}
+			} AND_THEN("environments seeded differently have diverged") {
+				REQUIRE(batch.environment(1).processor().memory().get(0x300) != batch.environment(2).processor().memory().get(0x300));
+			} AND_THEN("only environments holding key 1 are rewarded") {
+				REQUIRE(batch.rewards()[0] == 0);
+				REQUIRE(batch.rewards()[1] > 0);
+			} AND_THEN("the observations hold each environment's display") {
+				const auto words = batch.getObservationWords();
+				std::vector<uint64_t> observation(words);
+				for (size_t index = 0; index < separate.size(); ++index) {
+					separate[index].observe(observation.data());
+					REQUIRE(std::equal(observation.begin(), observation.end(), batch.observations().begin() + index * words));
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("A machine pool runs like the same machines run one at a time", "[Chip8][Schip]") {
+
+	const auto level = GENERATE(chip8, superChip, xoChip);
+	const auto translate = GENERATE(false, true);
+	auto configuration = buildConfiguration(level);
+	configuration.setTranslateBlocks(translate);
+
+	GIVEN("A pool of three " + describeVariant(configuration) + (translate ? " (translating blocks)" : "") + " machines and three separate ones, running a program that reacts to key 5") {
+
+		const RomFile rom("machine_pool_test.ch8", {
+			0xA2F0,	// LD I,2F0
+			0xC0FF,	// RND V0,FF
+			0xF055,	// LD [I],V0: alongside the code, differently on each machine
+			0xF015,	// LD DT,V0
+			0x6205,	// LD V2,5
+			0xE29E,	// SKP V2
+			0x1212,	// JP 212
+			0x7101,	// ADD V1,1
+			0xF129,	// LD F,V1
+			0xD345,	// DRW V3,V4,5
+			0x7305,	// ADD V3,5
+			0x1200,	// JP 200
+		});
+
+		MachinePool pool(configuration, 3);
+		pool.reset(rom.path(), 7);
+
+		std::vector<std::shared_ptr<Chip8>> separate;
+		for (size_t index = 0; index < pool.size(); ++index) {
+			separate.emplace_back(ProcessorFactory::buildProcessor(configuration));
+			separate.back()->initialise();
+			separate.back()->loadGame(rom.path());
+			separate.back()->seedRandomNumbers(7 + (uint32_t)index);
+			separate.back()->setDrawNeeded(false);	// As the pool does
+		}
+
+		WHEN("both run the same frames with the same keys") {
+
+			const std::vector<uint16_t> keys = { 0x0000, 0x0020, 0x0021 };
+			long long cycles = 0;
+			long long separateCycles = 0;
+			for (int frame = 0; frame < 10; ++frame) {
+				pool.keys() = keys;
+				cycles += pool.runFrame();
+				for (size_t index = 0; index < separate.size(); ++index) {
+					auto& processor = *separate[index];
+					processor.keyboard().setKeys(keys[index]);
+					separateCycles += processor.runFrame();
+					processor.updateTimers();
+					processor.setDrawNeeded(false);
+				}
+			}
+
+			THEN("every machine ends in exactly the same state") {
+				REQUIRE(cycles == separateCycles);
+				for (size_t index = 0; index < separate.size(); ++index) {
+					Snapshot pooled;
+					Snapshot alone;
+					pool.saveSnapshot(index, pooled);
+					separate[index]->saveSnapshot(alone);
+					REQUIRE(pooled.v == alone.v);
+					REQUIRE(pooled.stack == alone.stack);
+					REQUIRE(pooled.i == alone.i);
+					REQUIRE(pooled.pc == alone.pc);
+					REQUIRE(pooled.sp == alone.sp);
+					REQUIRE(pooled.delayTimer == alone.delayTimer);
+					REQUIRE(pooled.soundTimer == alone.soundTimer);
+					REQUIRE(pooled.finished == alone.finished);
+					REQUIRE(pooled.randomNumberGenerator.next() == alone.randomNumberGenerator.next());
+					REQUIRE(pooled.highResolution == alone.highResolution);
+					REQUIRE(pooled.dirtyRows == alone.dirtyRows);
+					REQUIRE(pooled.display == alone.display);
+					REQUIRE(pooled.memory.size() == alone.memory.size());
+					for (size_t page = 0; page < alone.memory.size(); ++page)
+						REQUIRE(*pooled.memory[page] == *alone.memory[page]);
+				}
+			} AND_THEN("the columns hold each machine's registers") {
+				for (size_t index = 0; index < separate.size(); ++index) {
+					const auto& alone = *separate[index];
+					for (int x = 0; x < 16; ++x)
+						REQUIRE(pool.registers(x)[index] == alone.registers()[x]);
+					REQUIRE(pool.indirectors()[index] == alone.indirector());
+					REQUIRE(pool.programCounters()[index] == alone.PC());
+				}
+			} AND_THEN("machines seeded differently or given different keys have diverged") {
+				REQUIRE(pool.registers(0)[0] != pool.registers(0)[1]);
+				REQUIRE(pool.registers(1)[0] == 0);
+				REQUIRE(pool.registers(1)[1] > 0);
+			} AND_THEN("the framebuffers hold each machine's display") {
+				const auto words = pool.getFramebufferWords();
+				std::vector<uint64_t> packed(words);
+				for (size_t index = 0; index < separate.size(); ++index) {
+					separate[index]->display().pack(packed.data());
+					REQUIRE(std::equal(packed.begin(), packed.end(), pool.framebuffers().begin() + index * words));
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("A machine can be snapshotted, restored and cloned", "[Chip8][Schip]") {
+
+	GIVEN("An XO-Chip machine drawing random digits in high resolution") {
+
+		const auto configuration = Configuration::buildXoChipConfiguration();
+		const auto startAddress = configuration.getStartAddress();
+		std::shared_ptr<Chip8> processor(ProcessorFactory::buildProcessor(configuration));
+		processor->initialise();
+		processor->seedRandomNumbers(42);
+
+		const std::vector<uint16_t> program = {
+			0x00FF,	// HIGH
+			0xC0FF,	// RND V0,FF
+			0xF029,	// LD F,V0
+			0xD015,	// DRW V0,V1,5
+			0x7101,	// ADD V1,1
+			0x1202,	// JP 202
+		};
+		for (size_t word = 0; word < program.size(); ++word)
+			processor->memory().setWord(startAddress + 2 * word, program[word]);
+
+		const auto run = [](Chip8& machine, int frames) {
+			for (int frame = 0; frame < frames; ++frame) {
+				machine.setDrawNeeded(false);	// As if presented
+				machine.runFrame();
+				machine.updateTimers();
+			}
+		};
+		run(*processor, 3);
+
+		Snapshot snapshot;
+		processor->saveSnapshot(snapshot);
+
+		run(*processor, 5);
+		const auto pc = processor->PC();
+		const auto registers = processor->registers();
+		const auto hash = processor->display().hash();
+
+		WHEN("the snapshot is restored and the same frames run again") {
+
+			processor->loadSnapshot(snapshot);
+			run(*processor, 5);
+
+			THEN("the machine ends where it did the first time") {
+				REQUIRE(processor->PC() == pc);
+				REQUIRE(processor->registers() == registers);
+				REQUIRE(processor->display().hash() == hash);
+			}
+		}
+
+		WHEN("the program is changed before the snapshot is restored") {
+
+			processor->memory().setWord(startAddress + 8, 0x7102);	// ADD V1,2
+			run(*processor, 5);
+			processor->loadSnapshot(snapshot);
+			run(*processor, 5);
+
+			THEN("the original program runs again") {
+				REQUIRE(processor->memory().getWord(startAddress + 8) == 0x7101);
+				REQUIRE(processor->registers() == registers);
+				REQUIRE(processor->display().hash() == hash);
+			}
+		}
+
+		WHEN("snapshots are taken and restored again") {
+
+			const auto before = allocations;
+			processor->saveSnapshot(snapshot);
+			processor->loadSnapshot(snapshot);
+			const auto allocated = allocations - before;
+
+			THEN("no memory has been allocated") {
+				REQUIRE(allocated == 0);
+			}
+		}
+
+		WHEN("a restored machine is cloned and both run on") {
+
+			processor->loadSnapshot(snapshot);
+			auto connected = false;
+			processor->EmulatingCycle.connect([&](const InstructionEventArgs&) { connected = true; });
+
+			std::shared_ptr<Chip8> clone(processor->clone());
+			run(*clone, 5);
+
+			THEN("the clone runs as the original did") {
+				REQUIRE(clone->PC() == pc);
+				REQUIRE(clone->registers() == registers);
+				REQUIRE(clone->display().hash() == hash);
+			} AND_THEN("the clone shares the memory it hasn't written to") {
+				REQUIRE(clone->memory().pages() == processor->memory().pages());
+			} AND_THEN("the clone has no listeners") {
+				REQUIRE_FALSE(connected);
+			} AND_THEN("the original is untouched") {
+				REQUIRE(processor->display().hash() != hash);
+			}
+		}
+	}
+
+	GIVEN("A SuperChip machine snapshotted before it enters compatibility mode") {
+
+		const auto configuration = Configuration::buildSuperChipConfiguration();
+		const auto startAddress = configuration.getStartAddress();
+		std::shared_ptr<Chip8> processor(ProcessorFactory::buildProcessor(configuration));
+		processor->initialise();
+
+		const std::vector<uint16_t> program = {
+			0xA300,	// LD I,300
+			0xF055,	// LD [I],V0
+			0x00FA,	// COMPATIBILITY
+			0x1200,	// JP 200
+		};
+		for (size_t word = 0; word < program.size(); ++word)
+			processor->memory().setWord(startAddress + 2 * word, program[word]);
+
+		processor->step();
+		Snapshot snapshot;
+		processor->saveSnapshot(snapshot);
+		std::shared_ptr<Chip8> clone(processor->clone());
+
+		WHEN("the snapshot is restored after the save has been decoded in compatibility mode") {
+
+			for (int step = 0; step < 5; ++step)
+				processor->step();
+			processor->loadSnapshot(snapshot);
+			processor->step();
+			clone->step();
+
+			THEN("the save runs as it did when the snapshot was taken, leaving I alone") {
+				REQUIRE(processor->indirector() == 0x300);
+				REQUIRE(processor->indirector() == clone->indirector());
+			}
+		}
+	}
+}
+
+SCENARIO("Copies of memory share pages until they are written to", "[Chip8]") {
+
+	GIVEN("A memory with a program loaded and a copy of it") {
+
+		Memory original(4096);
+		original.setWord(0x200, 0x1234);
+		original.setWord(0x2FF, 0xABCD);	// Straddles a page boundary
+
+		Memory copy = original;
+
+		THEN("every page is shared") {
+			REQUIRE(copy.pages() == original.pages());
+		}
+
+		WHEN("the copy is written to") {
+
+			copy.set(0x2FF, 0x55);
+
+			THEN("only the written page has been copied") {
+				for (size_t page = 0; page < copy.pages().size(); ++page)
+					REQUIRE((copy.pages()[page] == original.pages()[page]) == (page != 2));
+			} AND_THEN("the original is unchanged") {
+				REQUIRE(original.getWord(0x2FF) == 0xABCD);
+				REQUIRE(copy.getWord(0x2FF) == 0x55CD);
+			}
+		}
+
+		WHEN("bytes are read across a page boundary") {
+
+			std::array<uint8_t, 4> bytes;
+			copy.get(0x2FE, bytes.data(), bytes.size());
+
+			THEN("they come from both pages") {
+				REQUIRE(bytes == (std::array<uint8_t, 4>{ { 0, 0xAB, 0xCD, 0 } }));
+			}
+		}
+
+		WHEN("the copy is restored from the original's pages after a change") {
+
+			copy.setWord(0x200, 0x00E0);
+			copy.restore(original.pages());
+
+			THEN("the pages are shared again") {
+				REQUIRE(copy.pages() == original.pages());
+				REQUIRE(copy.getWord(0x200) == 0x1234);
+			}
+		}
+
+		WHEN("a memory with a decoded instruction is copied") {
+
+			auto& decoded = original.instruction(0x200);
+			decoded.decode(original.getWord(0x200));
+			decoded.handler = [](Chip8&, const Instruction&) {};
+
+			Memory another = original;
+
+			THEN("the copy has to decode the instruction for itself") {
+				REQUIRE(original.instruction(0x200).isDecoded());
+				REQUIRE(!another.instruction(0x200).isDecoded());
+			}
+		}
+	}
+}
+
+SCENARIO("A rewind buffer steps a machine back through the frames it recorded", "[Chip8]") {
+
+	GIVEN("A machine drawing random digits, recorded every frame") {
+
+		const Configuration configuration;
+		const auto startAddress = configuration.getStartAddress();
+		std::shared_ptr<Chip8> processor(ProcessorFactory::buildProcessor(configuration));
+		processor->initialise();
+		processor->seedRandomNumbers(7);
+
+		const std::vector<uint16_t> program = {
+			0xC0FF,	// RND V0,FF
+			0xF029,	// LD F,V0
+			0xD015,	// DRW V0,V1,5
+			0x7101,	// ADD V1,1
+			0xA300,	// LD I,300
+			0xF155,	// LD [I],V1
+			0x1200,	// JP 200
+		};
+		for (size_t word = 0; word < program.size(); ++word)
+			processor->memory().setWord(startAddress + 2 * word, program[word]);
+
+		struct state_t {
+			uint16_t pc;
+			std::array<uint8_t, 16> registers;
+			uint64_t display;
+		};
+		const auto capture = [&] {
+			return state_t { processor->PC(), processor->registers(), processor->display().hash() };
+		};
+		const auto same = [](const state_t& lhs, const state_t& rhs) {
+			return (lhs.pc == rhs.pc) && (lhs.registers == rhs.registers) && (lhs.display == rhs.display);
+		};
+
+		const auto record = [&](RewindBuffer& rewind, int frames) {
+			std::vector<state_t> states;
+			for (int frame = 0; frame < frames; ++frame) {
+				states.push_back(capture());
+				rewind.record(*processor);
+				processor->setDrawNeeded(false);	// As if presented
+				processor->runFrame();
+				processor->updateTimers();
+			}
+			return states;
+		};
+
+		WHEN("ten frames are recorded with a keyframe every four, then rewound") {
+
+			RewindBuffer rewind(100, 4);
+			const auto states = record(rewind, 10);
+			REQUIRE(rewind.size() == 10);
+
+			std::vector<state_t> rewound;
+			while (rewind.rewind(*processor))
+				rewound.push_back(capture());
+
+			THEN("every frame comes back, newest first") {
+				REQUIRE(rewound.size() == states.size());
+				for (size_t frame = 0; frame < states.size(); ++frame)
+					REQUIRE(same(rewound[frame], states[states.size() - 1 - frame]));
+			} AND_THEN("the buffer is left empty") {
+				REQUIRE(rewind.empty());
+			}
+		}
+
+		WHEN("more frames are recorded than the buffer holds") {
+
+			RewindBuffer rewind(6, 4);
+			const auto states = record(rewind, 10);
+
+			std::vector<state_t> rewound;
+			while (rewind.rewind(*processor))
+				rewound.push_back(capture());
+
+			THEN("only the newest frames are kept") {
+				REQUIRE(rewound.size() <= 6);
+				REQUIRE_FALSE(rewound.empty());
+				for (size_t frame = 0; frame < rewound.size(); ++frame)
+					REQUIRE(same(rewound[frame], states[states.size() - 1 - frame]));
+			}
+		}
+
+		WHEN("a minute of play is recorded") {
+
+			RewindBuffer rewind(60 * 60);
+			record(rewind, 60 * 60);
+
+			THEN("it takes a small fraction of the full states' size") {
+				REQUIRE(rewind.getBytes() < 60 * 60 * 4096 / 20);
+			}
+		}
+	}
+}
+
+SCENARIO("A movie replays a recorded run exactly", "[Chip8]") {
+
+	GIVEN("A recording of a program steered by key 5 and random numbers") {
+
+		const auto configuration = Configuration::buildSuperChipConfiguration();
+		const auto startAddress = configuration.getStartAddress();
+
+		const std::vector<uint16_t> program = {
+			0xC0FF,	// RND V0,FF
+			0xF029,	// LD F,V0
+			0x6305,	// LD V3,5
+			0xE3A1,	// SKNP V3
+			0x7104,	// ADD V1,4
+			0xD125,	// DRW V1,V2,5
+			0x7201,	// ADD V2,1
+			0x1200,	// JP 200
+		};
+
+		const auto frame = [](Chip8& processor, uint16_t keys) {
+			processor.keyboard().setKeys(keys);
+			processor.runFrame();
+			processor.updateTimers();
+		};
+		const auto presented = [](Chip8& processor) {
+			processor.setDrawNeeded(false);
+		};
+
+		std::shared_ptr<Chip8> recorded(ProcessorFactory::buildProcessor(configuration));
+		recorded->initialise();
+		for (size_t word = 0; word < program.size(); ++word)
+			recorded->memory().setWord(startAddress + 2 * word, program[word]);
+		recorded->seedRandomNumbers(0x1234);
+
+		Movie movie;
+		movie.start(*recorded);
+		for (int count = 0; count < 150; ++count) {
+			const uint16_t keys = (count / 20) % 2 ? 0x0020 : 0x0000;
+			frame(*recorded, keys);
+			movie.record(keys, *recorded);
+			presented(*recorded);
+		}
+
+		const std::string path = "movie_test.c8m";
+		movie.save(path);
+
+		WHEN("it is saved, loaded and replayed on a fresh machine") {
+
+			Movie loaded;
+			loaded.load(path);
+			std::remove(path.c_str());
+
+			std::shared_ptr<Chip8> replayed(ProcessorFactory::buildProcessor(loaded.configuration()));
+			loaded.prepare(*replayed);
+
+			auto verified = true;
+			for (int count = 0; count < loaded.getFrames(); ++count) {
+				frame(*replayed, loaded.getKeys(count));
+				verified = verified && loaded.verify(count, *replayed);
+				presented(*replayed);
+			}
+
+			THEN("every checkpoint matches") {
+				REQUIRE(loaded.getFrames() == 150);
+				REQUIRE(loaded.getSeed() == 0x1234);
+				REQUIRE(verified);
+			} AND_THEN("the machine ends as the recording did") {
+				REQUIRE(replayed->PC() == recorded->PC());
+				REQUIRE(replayed->registers() == recorded->registers());
+				REQUIRE(replayed->display().hash() == recorded->display().hash());
+			}
+		}
+
+		WHEN("it is replayed with a different key held") {
+
+			std::remove(path.c_str());
+
+			std::shared_ptr<Chip8> replayed(ProcessorFactory::buildProcessor(movie.configuration()));
+			movie.prepare(*replayed);
+
+			auto outOfStep = -1;
+			for (int count = 0; count < movie.getFrames(); ++count) {
+				frame(*replayed, count == 25 ? 0x0000 : movie.getKeys(count));
+				if ((outOfStep < 0) && !movie.verify(count, *replayed))
+					outOfStep = count;
+				presented(*replayed);
+			}
+
+			THEN("the first checkpoint after the change catches it") {
+				REQUIRE(outOfStep == 59);
+			}
+		}
+	}
+
+	GIVEN("A recording stopped before any frame ran") {
+
+		std::shared_ptr<Chip8> recorded(ProcessorFactory::buildProcessor(Configuration()));
+		recorded->initialise();
+
+		Movie movie;
+		movie.start(*recorded);
+
+		const std::string path = "movie_empty_test.c8m";
+		movie.save(path);
+
+		WHEN("it is loaded") {
+
+			Movie loaded;
+
+			THEN("it is refused, as there is nothing to replay") {
+				REQUIRE_THROWS_AS(loaded.load(path), std::runtime_error);
+			}
+			std::remove(path.c_str());
+		}
+	}
+}
+
+SCENARIO("RND draws from a small generator seeded by the configuration", "[Chip8]") {
+
+	GIVEN("Two machines configured with the same seed") {
+
+		Configuration configuration;
+		configuration.setRandomSeed(77);
+
+		std::shared_ptr<Chip8> first(ProcessorFactory::buildProcessor(configuration));
+		std::shared_ptr<Chip8> second(ProcessorFactory::buildProcessor(configuration));
+		first->initialise();
+		second->initialise();
+
+		const auto roll = [&](Chip8& processor) {
+			processor.memory().setWord(configuration.getStartAddress(), 0xC0FF);	// RND V0,FF
+			std::vector<uint8_t> rolls;
+			for (int count = 0; count < 16; ++count) {
+				processor.PC() = configuration.getStartAddress();
+				processor.step();
+				rolls.push_back(processor.registers()[0]);
+			}
+			return rolls;
+		};
+
+		WHEN("both roll the dice") {
+
+			const auto firstRolls = roll(*first);
+			const auto secondRolls = roll(*second);
+
+			THEN("they roll the same numbers") {
+				REQUIRE(first->getRandomSeed() == 77);
+				REQUIRE(firstRolls == secondRolls);
+			} AND_THEN("the numbers vary") {
+				REQUIRE(std::count(firstRolls.begin(), firstRolls.end(), firstRolls[0]) < 16);
+			}
+		}
+	}
+
+	GIVEN("Two machines left to choose their own seeds") {
+
+		const Configuration configuration;
+		std::shared_ptr<Chip8> first(ProcessorFactory::buildProcessor(configuration));
+		std::shared_ptr<Chip8> second(ProcessorFactory::buildProcessor(configuration));
+		first->initialise();
+		second->initialise();
+
+		THEN("they choose different ones") {
+			REQUIRE(first->getRandomSeed() != second->getRandomSeed());
+		}
+	}
+
+	GIVEN("A generator") {
+
+		RandomNumberGenerator generator;
+		generator.seed(1);
+
+		WHEN("it produces a few thousand bytes") {
+
+			std::bitset<256> seen;
+			for (int count = 0; count < 4096; ++count)
+				seen.set(generator.nextByte());
+
+			THEN("every byte value turns up") {
+				REQUIRE(seen.all());
+			}
+		}
+
+		WHEN("it is copied") {
+
+			auto copy = generator;
+			generator.next();
+
+			THEN("the copy carries on from where the original was") {
+				REQUIRE(copy != generator);
+				copy.next();
+				REQUIRE(copy == generator);
+			}
+		}
+	}
+}
+
+SCENARIO("Values pass between threads through a ring buffer in order", "[Chip8]") {
+
+	GIVEN("A ring buffer of four values") {
+
+		RingBuffer<int> ring(3);
+		std::array<int, 8> taken;
+
+		WHEN("it is filled") {
+
+			auto pushed = 0;
+			while (ring.push(pushed))
+				++pushed;
+
+			THEN("it holds its capacity, rounded up to a power of two") {
+				REQUIRE(ring.capacity() == 4);
+				REQUIRE(pushed == 4);
+			} AND_THEN("the values come out in the order they went in") {
+				REQUIRE(ring.pop(taken.data(), taken.size()) == 4);
+				REQUIRE(taken[0] == 0);
+				REQUIRE(taken[3] == 3);
+			} AND_THEN("taking some makes room for more") {
+				REQUIRE(ring.pop(taken.data(), 1) == 1);
+				REQUIRE(ring.push(4));
+				REQUIRE(!ring.push(5));
+			}
+		}
+
+		WHEN("a producer thread pushes more values than fit") {
+
+			const int count = 100000;
+			std::thread producer([&] {
+				for (int value = 0; value < count; ++value)
+					while (!ring.push(value))
+						std::this_thread::yield();
+			});
+
+			auto ordered = true;
+			for (int expected = 0; expected < count; ) {
+				const auto popped = ring.pop(taken.data(), taken.size());
+				for (size_t i = 0; i < popped; ++i)
+					ordered = ordered && (taken[i] == expected++);
+			}
+			producer.join();
+
+			THEN("the consumer sees every one, in order") {
+				REQUIRE(ordered);
+			}
+		}
+	}
+}
+
+SCENARIO("A binary trace decodes to the text the debug mode prints", "[Chip8][Schip]") {
+
+	GIVEN("An XO-Chip program traced to a file") {
+
+		const auto configuration = Configuration::buildXoChipConfiguration();
+		const auto startAddress = configuration.getStartAddress();
+		std::shared_ptr<Chip8> processor(ProcessorFactory::buildProcessor(configuration));
+		processor->initialise();
+
+		const std::vector<uint16_t> program = {
+			0x6A2F,			// LD VA,2F
+			0xF000, 0x0300,	// (X) LD I,0300
+			0xFA55,			// (S) LD [I],VA
+			0x00FA,			// (S) COMPATIBILITY
+			0xFA55,			// LD [I],VA
+			0x7A01,			// ADD VA,1
+			0x1200,			// JP 200
+		};
+		for (size_t word = 0; word < program.size(); ++word)
+			processor->memory().setWord(startAddress + 2 * word, program[word]);
+
+		// The text as the debug mode used to build it, state taken before each instruction
+		Disassembler disassembler;
+		std::string state;
+		std::vector<std::string> lines;
+		processor->EmulatingCycle.connect([&](const InstructionEventArgs& event) {
+			state = disassembler.generateState(event, processor.get());
+		});
+		processor->EmulatedCycle.connect([&](const InstructionEventArgs& event) {
+			const auto disassembly = disassembler.disassemble(event, processor.get());
+			char raw[5];
+			std::snprintf(raw, sizeof(raw), "%04X", event.getInstruction());
+			lines.push_back(state + "\t" + raw + "\t" + disassembly);
+		});
+
+		const std::string path = "trace_test.c8t";
+		{
+			TraceWriter writer(path, configuration);
+			processor->EmulatingCycle.connect([&](const InstructionEventArgs& event) {
+				writer.append(TraceRecord::capture(event.getProgramCounter(), event.getInstruction(), *processor));
+			});
+			for (int count = 0; count < 20; ++count)
+				processor->step();
+			writer.close();
+		}
+
+		WHEN("it is read back and decoded") {
+
+			TraceReader reader(path);
+			std::vector<std::string> decoded;
+			TraceRecord record;
+			while (reader.read(record))
+				decoded.push_back(disassembler.trace(record, reader.configuration()));
+			std::remove(path.c_str());
+
+			THEN("every instruction executed is there, as the debug mode would print it") {
+				REQUIRE(decoded.size() == 20);
+				REQUIRE(decoded == lines);
+			} AND_THEN("the disassembly follows the machine's state") {
+				REQUIRE(decoded[0] == "PC=0200 V=00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00  SP=0 I=0000\t6A2F\tLD VA,2F");
+				REQUIRE(decoded[1].substr(decoded[1].find('\t')) == "\tF000\t(X) LD I,0300");
+				REQUIRE(decoded[2].substr(decoded[2].find('\t')) == "\tFA55\t(S) LD [I],VA");
+				REQUIRE(decoded[4].substr(decoded[4].find('\t')) == "\tFA55\tLD [I],VA");
+			}
+		}
+	}
+}
+
+SCENARIO("The disassembler writes into a caller's buffer without allocating memory", "[Chip8][Schip]") {
+
+	GIVEN("An XO-Chip instance about to load I from the word after the instruction") {
+
+		const auto configuration = Configuration::buildXoChipConfiguration();
+		const auto startAddress = configuration.getStartAddress();
+		std::shared_ptr<Chip8> processor(ProcessorFactory::buildProcessor(configuration));
+		processor->initialise();
+
+		processor->memory().setWord(startAddress, 0xF000);	// (X) LD I,0300
+		processor->memory().setWord(startAddress + 2, 0x0300);
+		processor->registers()[0xB] = 0xC4;
+		processor->SP() = 0x10;
+		const auto record = TraceRecord::capture(startAddress, 0xF000, *processor);
+
+		Disassembler disassembler;
+
+		WHEN("its line of the trace is written into a buffer") {
+
+			char buffer[Disassembler::BufferSize];
+			const auto before = allocations;
+			const auto length = disassembler.trace(record, configuration, buffer);
+			const auto allocated = allocations - before;
+
+			THEN("no memory has been allocated") {
+				REQUIRE(allocated == 0);
+			} AND_THEN("the line is null terminated, and the same as the one returned as a string") {
+				REQUIRE(length == std::strlen(buffer));
+				REQUIRE(std::string(buffer) == disassembler.trace(record, configuration));
+				REQUIRE(std::string(buffer) == "PC=0200 V=00 00 00 00 00 00 00 00 00 00 00 C4 00 00 00 00  SP=10 I=0000\tF000\t(X) LD I,0300");
+			}
+		}
+
+		WHEN("an instruction it doesn't have is disassembled") {
+
+			auto unknown = record;
+			unknown.instruction = 0x00FF;	// SuperChip HIGH, as a Chip-8
+
+			THEN("it is refused") {
+				char buffer[Disassembler::BufferSize];
+				REQUIRE_THROWS(disassembler.disassemble(unknown, Configuration(), buffer));
+			}
+		}
+	}
+}
+
+SCENARIO("A control flow graph finds the code a ROM can reach", "[Chip8]") {
+
+	GIVEN("A Chip-8 program with a subroutine, a skip, a jump table and a store into its own code") {
+
+		const auto configuration = Configuration();
+		std::shared_ptr<Chip8> processor(ProcessorFactory::buildProcessor(configuration));
+		processor->initialise();
+
+		const std::vector<uint16_t> program = {
+			0x2214,	// 200: CALL 214
+			0xC002,	// 202: RND V0,02
+			0xB20A,	// 204: JP V0,20A
+			0x0000,	// 206: data
+			0x0000,	// 208: data
+			0x1210,	// 20A: JP 210
+			0x1200,	// 20C: JP 200
+			0x0000,	// 20E: data, ending the table
+			0x3001,	// 210: SE V0,01
+			0x1200,	// 212: JP 200
+			0xA212,	// 214: LD I,212
+			0xF055,	// 216: LD [I],V0
+			0x00EE,	// 218: RET
+		};
+		for (size_t word = 0; word < program.size(); ++word)
+			processor->memory().setWord(0x200 + 2 * word, program[word]);
+
+		WHEN("its graph is built") {
+
+			const ControlFlowGraph graph(*processor);
+			const auto& blocks = graph.blocks();
+
+			auto hasEdge = [&](uint16_t from, uint16_t to, ControlFlowGraph::EdgeKind kind) {
+				const auto& successors = blocks.at(from).successors;
+				return std::any_of(successors.begin(), successors.end(), [&](const ControlFlowGraph::Edge& edge) {
+					return (edge.target == to) && (edge.kind == kind);
+				});
+			};
+
+			THEN("the program splits into the blocks control can enter") {
+				std::vector<uint16_t> starts;
+				for (const auto& entry : blocks)
+					starts.push_back(entry.first);
+				REQUIRE(starts == std::vector<uint16_t>({ 0x200, 0x202, 0x20A, 0x20C, 0x210, 0x212, 0x214 }));
+				REQUIRE(graph.getInstructionCount() == 10);
+				REQUIRE(graph.isInstruction(0x216));
+				REQUIRE_FALSE(graph.isCode(0x206));
+				REQUIRE_FALSE(graph.isCode(0x20E));
+			} AND_THEN("the call resumes after itself, and the subroutine returns there") {
+				REQUIRE(hasEdge(0x200, 0x214, ControlFlowGraph::Call));
+				REQUIRE(hasEdge(0x200, 0x202, ControlFlowGraph::Resume));
+				REQUIRE(hasEdge(0x214, 0x202, ControlFlowGraph::Return));
+				const auto& subroutine = graph.subroutines().at(0x214);
+				REQUIRE(subroutine.calls == std::vector<uint16_t>({ 0x200 }));
+				REQUIRE(subroutine.returns == std::vector<uint16_t>({ 0x218 }));
+			} AND_THEN("the skip can go either way") {
+				REQUIRE(hasEdge(0x210, 0x212, ControlFlowGraph::Next));
+				REQUIRE(hasEdge(0x210, 0x214, ControlFlowGraph::Skip));
+				REQUIRE(blocks.at(0x214).predecessors == std::vector<uint16_t>({ 0x200, 0x210 }));
+			} AND_THEN("the indexed jump goes to each jump in the table") {
+				REQUIRE(blocks.at(0x202).ending == ControlFlowGraph::Transfers);
+				REQUIRE(hasEdge(0x202, 0x20A, ControlFlowGraph::Table));
+				REQUIRE(hasEdge(0x202, 0x20C, ControlFlowGraph::Table));
+				REQUIRE(blocks.at(0x202).successors.size() == 2);
+			} AND_THEN("the store is found to write over code") {
+				REQUIRE(graph.stores().size() == 1);
+				const auto& store = graph.stores().front();
+				REQUIRE(store.address == 0x216);
+				REQUIRE(store.known);
+				REQUIRE(store.target == 0x212);
+				REQUIRE(store.length == 1);
+				REQUIRE(store.writesCode);
+				REQUIRE(graph.getSelfModification() == ControlFlowGraph::Yes);
+			}
+		}
+
+		WHEN("the indexed jump's register is loaded with a constant instead") {
+
+			processor->memory().setWord(0x202, 0x6002);	// LD V0,02
+			const ControlFlowGraph graph(*processor);
+
+			THEN("it goes to the one entry it can reach") {
+				const auto& successors = graph.blocks().at(0x202).successors;
+				REQUIRE(successors.size() == 1);
+				REQUIRE(successors.front().target == 0x20C);
+				REQUIRE(successors.front().kind == ControlFlowGraph::Table);
+				REQUIRE_FALSE(graph.isCode(0x20A));
+			}
+		}
+	}
+}
+
+SCENARIO("A profiler counts instructions by opcode class and address", "[Chip8]") {
+
+	GIVEN("Opcodes from each family") {
+
+		THEN("they are named for the class they belong to") {
+			REQUIRE(Profiler::getClass(0x8124) == "8XY4");
+			REQUIRE(Profiler::getClass(0xD125) == "DXYN");
+			REQUIRE(Profiler::getClass(0xF333) == "FX33");
+			REQUIRE(Profiler::getClass(0x00C3) == "00CN");
+			REQUIRE(Profiler::getClass(0x00EE) == "00EE");
+			REQUIRE(Profiler::getClass(0x0123) == "0NNN");
+			REQUIRE(Profiler::getClass(0x5122) == "5XY2");
+			REQUIRE(Profiler::getClass(0xE19E) == "EX9E");
+			REQUIRE(Profiler::getClass(0xF201) == "FN01");
+			REQUIRE(Profiler::getClass(0xF000) == "F000");
+		}
+	}
+
+	GIVEN("A Chip8 instance running a loop, with a profiler attached") {
+
+		Configuration configuration;
+		configuration.setTranslateBlocks(true);
+		std::shared_ptr<Chip8> processor(ProcessorFactory::buildProcessor(configuration));
+		processor->initialise();
+
+		auto& memory = processor->memory();
+		memory.setWord(0x200, 0x6005);	// LD V0,05
+		memory.setWord(0x202, 0xD015);	// DRW V0,V1,5
+		memory.setWord(0x204, 0x7001);	// ADD V0,01
+		memory.setWord(0x206, 0x8014);	// ADD V0,V1
+		memory.setWord(0x208, 0x1204);	// JP 204
+
+		Profiler profiler;
+		processor->setProfiler(&profiler);
+
+		auto requireCounted = [&]() {
+			if (!Profiler::isCompiledIn()) {
+				REQUIRE(profiler.getInstructions() == 0);
+				return;
+			}
+			REQUIRE(profiler.getInstructions() == 8);
+			const std::vector<std::pair<std::string, uint64_t>> classes = { { "1NNN", 2 }, { "7XNN", 2 }, { "8XY4", 2 }, { "6XNN", 1 }, { "DXYN", 1 } };
+			REQUIRE(profiler.opcodeClasses() == classes);
+			const std::vector<std::pair<uint16_t, uint64_t>> addresses = { { 0x204, 2 }, { 0x206, 2 }, { 0x208, 2 }, { 0x200, 1 }, { 0x202, 1 } };
+			REQUIRE(profiler.addresses() == addresses);
+			REQUIRE(profiler.timing(Profiler::Draw).calls == 1);
+			REQUIRE(profiler.timing(Profiler::Timers).calls == 1);
+			REQUIRE(profiler.timing(Profiler::Scroll).calls == 0);
+		};
+
+		WHEN("it is stepped through the loop") {
+
+			for (int i = 0; i < 8; ++i)
+				processor->step();
+			processor->updateTimers();
+
+			THEN("each instruction is counted once, as is the draw and the timer update") {
+				requireCounted();
+			}
+		}
+
+		WHEN("it is run as translated blocks") {
+
+			REQUIRE(processor->runBlock(100) == 2);	// A draw ends a block
+			REQUIRE(processor->runBlock(100) == 3);
+			REQUIRE(processor->runBlock(100) == 3);
+			processor->updateTimers();
+
+			THEN("the counts are the same as when stepped") {
+				requireCounted();
+			}
+		}
+
+		WHEN("it is cloned") {
+
+			const std::unique_ptr<Chip8> clone(processor->clone());
+			clone->step();
+
+			THEN("the clone doesn't count into the original's profiler") {
+				REQUIRE(clone->profiler() == nullptr);
+				REQUIRE(profiler.getInstructions() == 0);
+			}
+		}
+
+		WHEN("the report is written") {
+
+			for (int i = 0; i < 8; ++i)
+				processor->step();
+			std::ostringstream json;
+			profiler.writeJson(json);
+			std::ostringstream table;
+			profiler.writeTable(table, 2);
+
+			THEN("both describe what was counted") {
+				if (Profiler::isCompiledIn()) {
+					REQUIRE(json.str().find("\"instructions\": 8,") != std::string::npos);
+					REQUIRE(json.str().find("{ \"class\": \"1NNN\", \"count\": 2 }") != std::string::npos);
+					REQUIRE(json.str().find("{ \"address\": 516, \"count\": 2 }") != std::string::npos);
+					REQUIRE(table.str().find("8 instructions") == 0);
+					REQUIRE(table.str().find("(3 more)") != std::string::npos);
+				}
+				REQUIRE(json.str().find("\"draw\": { \"calls\": ") != std::string::npos);
+			}
+		}
+	}
+}
+
+SCENARIO("A histogram reports percentiles to within a fixed share of the value", "[Chip8]") {
+
+	GIVEN("An empty histogram") {
+
+		Histogram histogram;
+
+		THEN("it reports nothing") {
+			REQUIRE(histogram.getCount() == 0);
+			REQUIRE(histogram.getMaximum() == 0);
+			REQUIRE(histogram.getValueAtPercentile(50) == 0);
+		}
+
+		WHEN("small values are recorded") {
+
+			for (uint64_t value = 0; value < 64; ++value)
+				histogram.record(value);
+
+			THEN("they are held exactly") {
+				REQUIRE(histogram.getValueAtPercentile(50) == 31);
+				REQUIRE(histogram.getValueAtPercentile(100) == 63);
+				REQUIRE(histogram.getValueAtPercentile(0) == 0);
+			}
+		}
+
+		WHEN("a thousand times from one to a thousand microseconds are recorded") {
+
+			for (uint64_t microseconds = 1; microseconds <= 1000; ++microseconds)
+				histogram.record(microseconds * 1000);
+
+			THEN("each percentile is no less than the value there, and no more than a thirty-second over it") {
+				for (const auto percentile : { 1.0, 50.0, 90.0, 99.0, 99.9 }) {
+					const auto exact = (uint64_t)std::ceil(percentile * 10) * 1000;
+					const auto reported = histogram.getValueAtPercentile(percentile);
+					REQUIRE(reported >= exact);
+					REQUIRE(reported <= exact + exact / 32);
+				}
+			} AND_THEN("the count, maximum and mean are exact") {
+				REQUIRE(histogram.getCount() == 1000);
+				REQUIRE(histogram.getMaximum() == 1000000);
+				REQUIRE(histogram.getMean() == Approx(500500.0));
+				REQUIRE(histogram.getValueAtPercentile(100) == 1000000);
+			}
+		}
+
+		WHEN("values either side of each power of two are recorded alongside the largest") {
+
+			THEN("each is reported to within a thirty-second over it") {
+				for (int bit = Histogram::SubBucketBits; bit < Histogram::ValueBits; ++bit) {
+					for (const auto value : { (uint64_t(1) << bit) - 1, uint64_t(1) << bit }) {
+						Histogram powers;
+						powers.record(value);
+						powers.record(Histogram::MaximumValue);
+						const auto reported = powers.getValueAtPercentile(50);
+						REQUIRE(reported >= value);
+						REQUIRE(reported <= value + value / 32);
+					}
+				}
+			}
+		}
+
+		WHEN("a value beyond the largest it can hold is recorded") {
+
+			histogram.record(Histogram::MaximumValue + 12345);
+
+			THEN("it counts as the largest") {
+				REQUIRE(histogram.getMaximum() == Histogram::MaximumValue);
+				REQUIRE(histogram.getValueAtPercentile(50) == Histogram::MaximumValue);
+			}
+		}
+	}
+
+	GIVEN("Two histograms") {
+
+		Histogram first;
+		Histogram second;
+		first.record(100);
+		first.record(200);
+		second.record(5000);
+
+		WHEN("one is added to the other") {
+
+			first.add(second);
+
+			THEN("it holds both sets of values") {
+				REQUIRE(first.getCount() == 3);
+				REQUIRE(first.getMaximum() == 5000);
+				REQUIRE(first.getValueAtPercentile(50) >= 200);
+				REQUIRE(first.getValueAtPercentile(50) < 5000);
+			}
+
+			AND_WHEN("it is reset") {
+
+				first.reset();
+
+				THEN("it is empty again") {
+					REQUIRE(first.getCount() == 0);
+					REQUIRE(first.getValueAtPercentile(99) == 0);
+				}
+			}
+		}
 	}
 }
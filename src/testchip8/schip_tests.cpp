@@ -1,20 +1,24 @@
 #include "stdafx.h"
 
 #include <Configuration.h>
-#include <Controller.h>
+#include <ProcessorFactory.h>
 #include <Schip.h>
+#include <Snapshot.h>
 
 #include <memory>
 #include <algorithm>
 #include <bitset>
 
+#include "Variants.h"
+
 SCENARIO("The SuperChip interpreter interprets SuperChip only instructions correctly", "[Schip][Chip8]") {
 
-	GIVEN("An initialised Schip instance") {
+	const auto configuration = GENERATE(from_range(buildVariants(superChip)));
+
+	GIVEN("An initialised " + describeVariant(configuration) + " instance") {
 
-		auto configuration = Configuration::buildSuperChipConfiguration();
 		const auto startAddress = configuration.getStartAddress();
-		std::shared_ptr<Chip8> processor(Controller::buildProcessor(configuration));
+		std::shared_ptr<Chip8> processor(ProcessorFactory::buildProcessor(configuration));
 		processor->initialise();
 
 		WHEN("the instruction to save X (where X < 8) registers to the calculator is executed (LD_R_Vx: 0xFX75)") {
@@ -161,13 +165,94 @@ SCENARIO("The SuperChip interpreter interprets SuperChip only instructions corre
 			}
 		}
 
-		// SCLEFT
+		WHEN("a frame changes resolution without drawing anything") {
+
+			auto& memory = processor->memory();
+			memory.setWord(startAddress, 0x00FF);	// HIGH
+			memory.setWord(startAddress + 2, 0x00FE);	// LOW
+			memory.setWord(startAddress + 4, 0x1202);	// JP 202
+			const auto cycles = processor->runFrame();
+
+			THEN("the frame runs its full count of instructions") {
+				REQUIRE(cycles == (configuration.getCyclesPerFrame() + 1));
+			} AND_THEN("no draw is needed") {
+				REQUIRE(!processor->getDrawNeeded());
+			}
+		}
+
+		WHEN("the instruction to scroll left is executed in high resolution (SCLEFT: 0x00FC)") {
+
+			auto& plane = processor->display().planes()[0];
+
+			auto& memory = processor->memory();
+			memory.setWord(startAddress, 0x00FF);	// HIGH
+			memory.setWord(startAddress + 2, 0x00FC);	// SCLEFT
+			processor->step();
+			plane.setPixel(66, 5, true);
+			plane.setPixel(1, 5, true);
+			processor->step();
+
+			THEN("the pixels move four columns to the left") {
+				REQUIRE(plane.getPixel(62, 5) == 1);
+				REQUIRE(plane.getPixel(66, 5) == 0);
+			} AND_THEN("the pixels scrolled past the left edge are lost") {
+				REQUIRE(std::all_of(plane.rows().cbegin(), plane.rows().cend(), [](const GraphicsPlane::row_t& row) { return (row[1] & 0xf) == 0; }));
+				REQUIRE(plane.getPixel(1, 5) == 0);
+			}
+		}
+
+		WHEN("the instruction to scroll right is executed in high resolution (SCRIGHT: 0x00FB)") {
 
-		// SCRIGHT
+			auto& plane = processor->display().planes()[0];
 
-		// SCUP
+			auto& memory = processor->memory();
+			memory.setWord(startAddress, 0x00FF);	// HIGH
+			memory.setWord(startAddress + 2, 0x00FB);	// SCRIGHT
+			processor->step();
+			plane.setPixel(62, 5, true);
+			plane.setPixel(126, 5, true);
+			processor->step();
 
-		// SCDOWN
+			THEN("the pixels move four columns to the right") {
+				REQUIRE(plane.getPixel(66, 5) == 1);
+				REQUIRE(plane.getPixel(62, 5) == 0);
+			} AND_THEN("the pixels scrolled past the right edge are lost") {
+				REQUIRE(plane.getPixel(2, 5) == 0);
+				REQUIRE(plane.getPixel(126, 5) == 0);
+			}
+		}
+
+		WHEN("the instruction to scroll right is executed in low resolution (SCRIGHT: 0x00FB)") {
+
+			auto& plane = processor->display().planes()[0];
+			plane.setPixel(62, 5, true);
+
+			auto& memory = processor->memory();
+			memory.setWord(startAddress, 0x00FB);	// SCRIGHT
+			processor->step();
+
+			THEN("the pixels scrolled past the right edge are lost") {
+				REQUIRE(std::all_of(plane.rows().cbegin(), plane.rows().cend(), [](const GraphicsPlane::row_t& row) { return row[0] == 0 && row[1] == 0; }));
+			}
+		}
+
+		WHEN("the instruction to scroll down is executed (SCDOWN N: 0x00CN)") {
+
+			auto& plane = processor->display().planes()[0];
+			plane.setPixel(10, 0, true);
+			plane.setPixel(10, 30, true);
+
+			auto& memory = processor->memory();
+			memory.setWord(startAddress, 0x00C3);	// SCDOWN 3
+			processor->step();
+
+			THEN("the pixels move down by N rows") {
+				REQUIRE(plane.getPixel(10, 3) == 1);
+				REQUIRE(plane.getPixel(10, 0) == 0);
+			} AND_THEN("the pixels scrolled past the bottom edge are lost") {
+				REQUIRE(plane.getPixel(10, 1) == 0);
+			}
+		}
 
 		WHEN("the instruction to exit is executed, the processor indicates it is finished (EXIT: 0x00FD)") {
 
@@ -198,88 +283,177 @@ SCENARIO("The SuperChip interpreter interprets SuperChip only instructions corre
 
 SCENARIO("The SuperChip interpreter executes some Chip8 instructions differently", "[Schip][Chip8]") {
 
-	GIVEN("An initialised Schip instance") {
+	const auto configuration = GENERATE(from_range(buildVariants(superChip)));
+
+	GIVEN("An initialised " + describeVariant(configuration) + " instance") {
 
-		auto configuration = Configuration::buildSuperChipConfiguration();
 		const auto startAddress = configuration.getStartAddress();
-		std::shared_ptr<Chip8> processor(Controller::buildProcessor(configuration));
+		std::shared_ptr<Chip8> processor(ProcessorFactory::buildProcessor(configuration));
 		processor->initialise();
 
-		WHEN("a register is shifted right by one bit generating carry (SHR VX: 0x8X06)") {
+		// Unless configured to shift VY, as Chip-8 does
+		if (!shiftsVy(configuration)) {
 
-			auto& registers = processor->registers();
-			registers[0] = 3;
+			WHEN("a register is shifted right by one bit generating carry (SHR VX: 0x8X06)") {
 
-			auto& memory = processor->memory();
-			memory.setWord(startAddress, 0x8006);	// SHR V0
-			processor->step();
+				auto& registers = processor->registers();
+				registers[0] = 3;
 
-			THEN("the X register is shifted right by one") {
-				REQUIRE(registers[0] == 1);
-			} AND_THEN("carry has been generated") {
-				REQUIRE(registers[0xf] == 1);
+				auto& memory = processor->memory();
+				memory.setWord(startAddress, 0x8006);	// SHR V0
+				processor->step();
+
+				THEN("the X register is shifted right by one") {
+					REQUIRE(registers[0] == 1);
+				} AND_THEN("carry has been generated") {
+					REQUIRE(registers[0xf] == 1);
+				}
+			}
+
+			WHEN("a register is shifted right by one bit without generating carry (SHR VX: 0x8X06)") {
+
+				auto& registers = processor->registers();
+				registers[0] = 2;
+
+				auto& memory = processor->memory();
+				memory.setWord(startAddress, 0x8016);	// SHR V0
+				processor->step();
+
+				THEN("the X register is shifted right by one bit") {
+					REQUIRE(registers[0] == 1);
+				} AND_THEN("carry has not been generated") {
+					REQUIRE(registers[0xf] == 0);
+				}
+			}
+
+			WHEN("a register is shifted left by one bit generating carry (SHL VX: 0x8X0E)") {
+
+				auto& registers = processor->registers();
+				registers[0] = 0x81;
+
+				auto& memory = processor->memory();
+				memory.setWord(startAddress, 0x800E);	// SHL V0
+				processor->step();
+
+				THEN("the X register is shifted left by one") {
+					REQUIRE(registers[0] == 2);
+				} AND_THEN("carry has been generated") {
+					REQUIRE(registers[0xf] == 1);
+				}
+			}
+
+			WHEN("a register is shifted left by one bit without generating carry (SHL VX: 0x8X0E)") {
+
+				auto& registers = processor->registers();
+				registers[0] = 1;
+
+				auto& memory = processor->memory();
+				memory.setWord(startAddress, 0x800E);	// SHL V0
+				processor->step();
+
+				THEN("the X register is shifted left by one bit") {
+					REQUIRE(registers[0] == 2);
+				} AND_THEN("carry has not been generated") {
+					REQUIRE(registers[0xf] == 0);
+				}
 			}
 		}
 
-		WHEN("a register is shifted right by one bit without generating carry (SHR VX: 0x8X06)") {
+		// Unless configured to index jumps by V0, as Chip-8 does
+		if (!jumpsIndexedByV0(configuration)) {
+
+			WHEN("an indexed jump is executed (JP VX,NNN: 0xBNNN)") {
+
+				auto& registers = processor->registers();
+				registers[1] = 0x10;
+
+				auto& memory = processor->memory();
+				memory.setWord(startAddress, 0xB100);	// JP V1,100
+				processor->step();
+
+				THEN("the program counter is set to the address plus VX") {
+					REQUIRE(processor->PC() == 0x110);
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("The SuperChip interpreter can be configured to execute some instructions as Chip8 does", "[Schip][Chip8]") {
+
+	const auto level = GENERATE(superChip, xoChip);
+
+	GIVEN("An initialised " + describeVariant(buildConfiguration(level)) + " instance configured with Chip8 shifts, indexed jumps and load and save") {
+
+		auto configuration = buildConfiguration(level);
+		configuration.setChip8Shifts(true);
+		configuration.setChip8IndexedJumps(true);
+		configuration.setChip8LoadAndSave(true);
+		const auto startAddress = configuration.getStartAddress();
+		std::shared_ptr<Chip8> processor(ProcessorFactory::buildProcessor(configuration));
+		processor->initialise();
+
+		WHEN("a register is shifted right by one bit (SHR VX,VY: 0x8XY6)") {
 
 			auto& registers = processor->registers();
-			registers[0] = 2;
+			registers[0] = 0;
+			registers[1] = 3;
 
 			auto& memory = processor->memory();
-			memory.setWord(startAddress, 0x8016);	// SHR V0
+			memory.setWord(startAddress, 0x8016);	// SHR V0,V1
 			processor->step();
 
-			THEN("the X register is shifted right by one bit") {
+			THEN("the Y register is shifted right by one and placed in the X register") {
 				REQUIRE(registers[0] == 1);
-			} AND_THEN("carry has not been generated") {
-				REQUIRE(registers[0xf] == 0);
+				REQUIRE(registers[1] == 1);
+			} AND_THEN("carry has been generated") {
+				REQUIRE(registers[0xf] == 1);
 			}
 		}
 
-		WHEN("a register is shifted left by one bit generating carry (SHL VX: 0x8X0E)") {
+		WHEN("a register is shifted left by one bit (SHL VX,VY: 0x8XYE)") {
 
 			auto& registers = processor->registers();
-			registers[0] = 0x81;
+			registers[0] = 0;
+			registers[1] = 0x81;
 
 			auto& memory = processor->memory();
-			memory.setWord(startAddress, 0x800E);	// SHL V0
+			memory.setWord(startAddress, 0x801E);	// SHL V0,V1
 			processor->step();
 
-			THEN("the X register is shifted left by one") {
+			THEN("the Y register is shifted left by one and placed in the X register") {
 				REQUIRE(registers[0] == 2);
+				REQUIRE(registers[1] == 2);
 			} AND_THEN("carry has been generated") {
 				REQUIRE(registers[0xf] == 1);
 			}
 		}
 
-		WHEN("a register is shifted left by one bit without generating carry (SHL VX: 0x8X0E)") {
+		WHEN("an indexed jump is executed (JP V0,NNN: 0xBNNN)") {
 
 			auto& registers = processor->registers();
-			registers[0] = 1;
+			registers[0] = 0x20;
+			registers[1] = 0x10;
 
 			auto& memory = processor->memory();
-			memory.setWord(startAddress, 0x800E);	// SHL V0
+			memory.setWord(startAddress, 0xB100);	// JP V0,100
 			processor->step();
 
-			THEN("the X register is shifted left by one bit") {
-				REQUIRE(registers[0] == 2);
-			} AND_THEN("carry has not been generated") {
-				REQUIRE(registers[0xf] == 0);
+			THEN("the program counter is set to the address plus V0") {
+				REQUIRE(processor->PC() == 0x120);
 			}
 		}
 
-		WHEN("an indexed jump is executed (JP VX,NNN: 0xBNNN)") {
+		WHEN("the instruction to save X registers is executed (LD [I],VX: 0xFX55)") {
 
-			auto& registers = processor->registers();
-			registers[1] = 0x10;
+			processor->indirector() = 0x400;
 
 			auto& memory = processor->memory();
-			memory.setWord(startAddress, 0xB100);	// JP V1,100
+			memory.setWord(startAddress, 0xF255);	// LD [I],V2
 			processor->step();
 
-			THEN("the program counter is set to the address plus VX") {
-				REQUIRE(processor->PC() == 0x110);
+			THEN("the value of the indirector should be the base location plus the number of registers saved") {
+				REQUIRE(processor->indirector() == 0x403);
 			}
 		}
 	}
@@ -287,11 +461,12 @@ SCENARIO("The SuperChip interpreter executes some Chip8 instructions differently
 
 SCENARIO("The SuperChip interpreter can execute some Chip8 instructions in compatibility mode", "[Schip][Chip8]") {
 
-	GIVEN("An initialised Schip instance") {
+	const auto configuration = GENERATE(from_range(buildVariants(superChip)));
+
+	GIVEN("An initialised " + describeVariant(configuration) + " instance") {
 
-		auto configuration = Configuration::buildSuperChipConfiguration();
 		const auto startAddress = configuration.getStartAddress();
-		std::shared_ptr<Chip8> processor(Controller::buildProcessor(configuration));
+		std::shared_ptr<Chip8> processor(ProcessorFactory::buildProcessor(configuration));
 		processor->initialise();
 
 		WHEN("the instruction to save X registers is executed (LD [I],VX: 0xFX55)") {
@@ -368,77 +543,219 @@ SCENARIO("The SuperChip interpreter can execute some Chip8 instructions in compa
 
 SCENARIO("The SuperChip interpreter executes some Chip8 instructions differently when not in compatibility mode", "[Schip][Chip8]") {
 
-	GIVEN("An initialised Schip instance") {
+	const auto configuration = GENERATE(from_range(buildVariants(superChip)));
+
+	GIVEN("An initialised " + describeVariant(configuration) + " instance") {
 
-		auto configuration = Configuration::buildSuperChipConfiguration();
 		const auto startAddress = configuration.getStartAddress();
-		std::shared_ptr<Chip8> processor(Controller::buildProcessor(configuration));
+		std::shared_ptr<Chip8> processor(ProcessorFactory::buildProcessor(configuration));
 		processor->initialise();
 
-		WHEN("the instruction to save X registers is executed (LD [I],VX: 0xFX55)") {
+		// Configuring Chip-8 load and save starts the interpreter in compatibility mode
+		if (!loadAndSaveMoveI(configuration)) {
 
-			processor->indirector() = 0x400;
+			WHEN("the instruction to save X registers is executed (LD [I],VX: 0xFX55)") {
 
-			auto& registers = processor->registers();
-			registers[0] = 0x1;
-			registers[1] = 0x2;
-			registers[2] = 0x3;
-			registers[3] = 0x4;
+				processor->indirector() = 0x400;
+
+				auto& registers = processor->registers();
+				registers[0] = 0x1;
+				registers[1] = 0x2;
+				registers[2] = 0x3;
+				registers[3] = 0x4;
+
+				auto& memory = processor->memory();
+
+				memory.set(0x400, 0);
+				memory.set(0x401, 0);
+				memory.set(0x402, 0);
+				memory.set(0x403, 0);
+
+				memory.setWord(startAddress, 0xF255);	// LD [I],V2
+				processor->step();
+
+				THEN("the contents of the first location should be 1") {
+					REQUIRE(memory.get(0x400) == 1);
+				} AND_THEN("the contents of the second location should be 2") {
+					REQUIRE(memory.get(0x401) == 2);
+				} AND_THEN("the contents of the third location should be 3") {
+					REQUIRE(memory.get(0x402) == 3);
+				} AND_THEN("the contents of the fourth location should be 0 (i.e. unchanged)") {
+					REQUIRE(memory.get(0x403) == 0);
+				} AND_THEN("the value of the indirector should be unchanged") {
+					REQUIRE(processor->indirector() == 0x400);
+				}
+			}
+
+			WHEN("the instruction to load X registers is executed (LD VX,[I]: 0xFX65)") {
+
+				processor->indirector() = 0x400;
+
+				auto& registers = processor->registers();
+				registers[0] = 0x0;
+				registers[1] = 0x0;
+				registers[2] = 0x0;
+				registers[3] = 0x0;
+
+				auto& memory = processor->memory();
+
+				memory.set(0x400, 1);
+				memory.set(0x401, 2);
+				memory.set(0x402, 3);
+				memory.set(0x403, 4);
+
+				memory.setWord(startAddress, 0xF265);	// LD V2,[I]
+				processor->step();
+
+				THEN("the contents of V0 should be 1") {
+					REQUIRE(registers[0] == 1);
+				} AND_THEN("the contents of V1 should be 2") {
+					REQUIRE(registers[1] == 2);
+				} AND_THEN("the contents of V2 should be 3") {
+					REQUIRE(registers[2] == 3);
+				} AND_THEN("the contents of V3 should be 0 (i.e. unchanged)") {
+					REQUIRE(registers[3] == 0);
+				} AND_THEN("the value of the indirector should be unchanged") {
+					REQUIRE(processor->indirector() == 0x400);
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("The XO-Chip interpreter interprets XO-Chip only instructions correctly", "[XoChip][Schip]") {
+
+	const auto configuration = GENERATE(from_range(buildVariants(xoChip)));
+
+	GIVEN("An initialised " + describeVariant(configuration) + " instance") {
+
+		const auto startAddress = configuration.getStartAddress();
+		std::shared_ptr<Chip8> processor(ProcessorFactory::buildProcessor(configuration));
+		processor->initialise();
+
+		WHEN("the contents of the display are scrolled up (SCUP N: 0x00DN)") {
+
+			auto& plane = processor->display().planes()[0];
+			plane.setPixel(0, 5, true);
 
 			auto& memory = processor->memory();
+			memory.setWord(startAddress, 0x00D2);	// SCUP 2
+			processor->step();
 
-			memory.set(0x400, 0);
-			memory.set(0x401, 0);
-			memory.set(0x402, 0);
-			memory.set(0x403, 0);
+			THEN("the pixel has moved up by two rows") {
+				REQUIRE(plane.getPixel(0, 3) == 1);
+				REQUIRE(plane.getPixel(0, 5) == 0);
+			}
+		}
 
-			memory.setWord(startAddress, 0xF255);	// LD [I],V2
+		WHEN("a range of registers is saved (SAVE VX-VY: 0x5XY2)") {
+
+			processor->indirector() = 0x400;
+
+			auto& registers = processor->registers();
+			registers[1] = 0x1;
+			registers[2] = 0x2;
+			registers[3] = 0x3;
+
+			auto& memory = processor->memory();
+			memory.setWord(startAddress, 0x5132);	// SAVE V1-V3
 			processor->step();
 
-			THEN("the contents of the first location should be 1") {
+			THEN("the registers have been saved in order") {
 				REQUIRE(memory.get(0x400) == 1);
-			} AND_THEN("the contents of the second location should be 2") {
 				REQUIRE(memory.get(0x401) == 2);
-			} AND_THEN("the contents of the third location should be 3") {
 				REQUIRE(memory.get(0x402) == 3);
-			} AND_THEN("the contents of the fourth location should be 0 (i.e. unchanged)") {
-				REQUIRE(memory.get(0x403) == 0);
-			} AND_THEN("the value of the indirector should be unchanged") {
+			} AND_THEN("the value of the indirector is unchanged") {
 				REQUIRE(processor->indirector() == 0x400);
 			}
 		}
 
-		WHEN("the instruction to load X registers is executed (LD VX,[I]: 0xFX65)") {
+		WHEN("a descending range of registers is saved (SAVE VX-VY: 0x5XY2)") {
 
 			processor->indirector() = 0x400;
 
 			auto& registers = processor->registers();
-			registers[0] = 0x0;
-			registers[1] = 0x0;
-			registers[2] = 0x0;
-			registers[3] = 0x0;
+			registers[1] = 0x1;
+			registers[2] = 0x2;
+			registers[3] = 0x3;
 
 			auto& memory = processor->memory();
+			memory.setWord(startAddress, 0x5312);	// SAVE V3-V1
+			processor->step();
 
-			memory.set(0x400, 1);
-			memory.set(0x401, 2);
-			memory.set(0x402, 3);
-			memory.set(0x403, 4);
+			THEN("the registers have been saved in reverse order") {
+				REQUIRE(memory.get(0x400) == 3);
+				REQUIRE(memory.get(0x401) == 2);
+				REQUIRE(memory.get(0x402) == 1);
+			}
+		}
+
+		WHEN("a range of registers is loaded (LOAD VX-VY: 0x5XY3)") {
+
+			processor->indirector() = 0x400;
+
+			auto& memory = processor->memory();
+			memory.set(0x400, 4);
+			memory.set(0x401, 5);
+			memory.set(0x402, 6);
 
-			memory.setWord(startAddress, 0xF265);	// LD V2,[I]
+			memory.setWord(startAddress, 0x5133);	// LOAD V1-V3
 			processor->step();
 
-			THEN("the contents of V0 should be 1") {
-				REQUIRE(registers[0] == 1);
-			} AND_THEN("the contents of V1 should be 2") {
-				REQUIRE(registers[1] == 2);
-			} AND_THEN("the contents of V2 should be 3") {
-				REQUIRE(registers[2] == 3);
-			} AND_THEN("the contents of V3 should be 0 (i.e. unchanged)") {
-				REQUIRE(registers[3] == 0);
-			} AND_THEN("the value of the indirector should be unchanged") {
+			auto& registers = processor->registers();
+			THEN("the registers have been loaded in order") {
+				REQUIRE(registers[0] == 0);
+				REQUIRE(registers[1] == 4);
+				REQUIRE(registers[2] == 5);
+				REQUIRE(registers[3] == 6);
+			} AND_THEN("the value of the indirector is unchanged") {
 				REQUIRE(processor->indirector() == 0x400);
 			}
 		}
+
+		WHEN("I is loaded with a long address (LD I,NNNN: 0xF000 0xNNNN)") {
+
+			auto& memory = processor->memory();
+			memory.setWord(startAddress, 0xF000);	// LD I,NNNN
+			memory.setWord(startAddress + 2, 0xE123);
+			processor->step();
+
+			THEN("the I register holds the whole address") {
+				REQUIRE(processor->indirector() == 0xE123);
+			} AND_THEN("the program counter has moved past the address") {
+				REQUIRE(processor->PC() == (startAddress + 4));
+			}
+		}
+
+		WHEN("drawing planes are selected (PLANE N: 0xFN01)") {
+
+			auto& memory = processor->memory();
+			memory.setWord(startAddress, 0xF201);	// PLANE 2
+			processor->step();
+
+			THEN("only the second plane is selected") {
+				REQUIRE(processor->display().getPlaneMask() == 2);
+			}
+		}
+
+		WHEN("an audio pattern is loaded (AUDIO: 0xF002)") {
+
+			processor->indirector() = 0x400;
+
+			auto& memory = processor->memory();
+			for (int i = 0; i < 16; ++i)
+				memory.set(0x400 + i, (uint8_t)(0xF0 + i));
+
+			memory.setWord(startAddress, 0xF002);	// AUDIO
+			processor->step();
+
+			Snapshot snapshot;
+			processor->saveSnapshot(snapshot);
+
+			THEN("the pattern buffer holds the sixteen bytes from I") {
+				for (int i = 0; i < 16; ++i)
+					REQUIRE(snapshot.audioPatternBuffer[i] == (0xF0 + i));
+			}
+		}
 	}
 }
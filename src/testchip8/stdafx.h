@@ -9,5 +9,5 @@
 #include <catch.hpp>
 
 #include <Configuration.h>
-#include <Controller.h>
+#include <ProcessorFactory.h>
 #include <Schip.h>
@@ -0,0 +1,110 @@
+#include "stdafx.h"
+
+// Turns a binary trace, as written by chip8 --trace, into the text the
+// debug mode prints: one line per instruction executed.
+
+namespace po = boost::program_options;
+
+static po::variables_map processCommandLine(int argc, char* argv[]) {
+
+	po::options_description poOptionsDescription("Allowed options");
+
+	poOptionsDescription.add_options()
+		("trace",		po::value<std::string>()->required(),	"Binary trace to decode")
+		("output",		po::value<std::string>(),				"Text file to write (default: standard output)")
+		("benchmark",	po::value<int>(),						"Decode the trace this many times without writing it, reporting instructions per second")
+	;
+
+	po::positional_options_description poPositionalOptions;
+	poPositionalOptions.add("trace", 1);
+
+	po::command_line_parser poCommandLineParser(argc, argv);
+
+	po::variables_map options;
+	try {
+		po::store(poCommandLineParser.options(poOptionsDescription).positional(poPositionalOptions).run(), options);
+		po::notify(options);
+	} catch (std::exception& error) {
+		std::cerr << error.what() << std::endl;
+		options.clear();
+	}
+
+	return options;
+}
+
+// Disassembly alone, from records already in memory
+static int benchmark(const std::string& path, const int rounds) {
+
+	TraceReader reader(path);
+	std::vector<TraceRecord> records;
+	for (TraceRecord record; reader.read(record); )
+		records.push_back(record);
+
+	Disassembler disassembler;
+	char buffer[Disassembler::BufferSize];
+	size_t characters = 0;
+	const auto started = std::chrono::steady_clock::now();
+	for (int round = 0; round < rounds; ++round) {
+		for (const auto& record : records)
+			characters += disassembler.trace(record, reader.configuration(), buffer);
+	}
+	const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+	const auto instructions = (double)records.size() * rounds;
+	std::cout
+		<< boost::format("%.0f instructions (%d characters) in %.3fs: %.0f instructions/s")
+			% instructions % characters % seconds % (instructions / std::max(seconds, 1e-9))
+		<< std::endl;
+	return 0;
+}
+
+int main(int argc, char* argv[]) {
+
+	auto options = processCommandLine(argc, argv);
+	if (options.empty()) {
+		return 1;
+	}
+
+	auto benchmarkOption = options["benchmark"];
+	if (!benchmarkOption.empty()) {
+		try {
+			return benchmark(options["trace"].as<std::string>(), benchmarkOption.as<int>());
+		} catch (std::exception& error) {
+			std::cerr << error.what() << std::endl;
+			return 2;
+		}
+	}
+
+	std::ofstream file;
+	auto outputOption = options["output"];
+	if (!outputOption.empty()) {
+		file.open(outputOption.as<std::string>());
+		if (!file) {
+			std::cerr << "Unable to open " << outputOption.as<std::string>() << std::endl;
+			return 1;
+		}
+	}
+	auto& output = outputOption.empty() ? std::cout : file;
+
+	long long records = 0;
+	try {
+		TraceReader reader(options["trace"].as<std::string>());
+		const auto& configuration = reader.configuration();
+		Disassembler disassembler;
+		char buffer[Disassembler::BufferSize];
+		TraceRecord record;
+		while (reader.read(record)) {
+			const auto length = disassembler.trace(record, configuration, buffer);
+			buffer[length] = '\n';
+			output.write(buffer, length + 1);
+			++records;
+		}
+	} catch (std::exception& error) {
+		output.flush();
+		std::cerr << boost::format("After %d records: %s") % records % error.what() << std::endl;
+		return 2;
+	}
+
+	output.flush();
+	return output ? 0 : 2;
+}
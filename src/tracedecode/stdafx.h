@@ -0,0 +1,18 @@
+#ifdef _MSC_VER
+#pragma once
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/format.hpp>
+#include <boost/program_options.hpp>
+
+#include <Configuration.h>
+#include <Disassembler.h>
+#include <Trace.h>